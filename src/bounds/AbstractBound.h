@@ -28,6 +28,7 @@
 #include <vector>
 
 #include "MDPCache.h"
+#include "SolverCheckpoint.h"
 
 using namespace sla;
 
@@ -37,6 +38,35 @@ namespace zmdp {
 #define ZMDP_S_NUM_ENTRIES         (1)
 #define ZMDP_S_NUM_ELTS_TABULAR    (2)
 #define ZMDP_S_NUM_ENTRIES_TABULAR (3)
+// memory footprint of the tabular part of the bound (the search graph
+// node cache), in kilobytes
+#define ZMDP_S_NUM_KBYTES_TABULAR  (4)
+
+// cumulative statistics on pruning of a bound representation
+struct BoundPruneStats {
+  int numPasses;
+  int numPruned;
+  double pruneSeconds;
+  // the most recent pass
+  int lastNumPruned;
+  double lastPruneSeconds;
+
+  BoundPruneStats(void) :
+    numPasses(0),
+    numPruned(0),
+    pruneSeconds(0.0),
+    lastNumPruned(0),
+    lastPruneSeconds(0.0)
+  {}
+
+  void addPass(int _numPruned, double seconds) {
+    numPasses++;
+    numPruned += _numPruned;
+    pruneSeconds += seconds;
+    lastNumPruned = _numPruned;
+    lastPruneSeconds = seconds;
+  }
+};
 
 struct AbstractBound {
   virtual ~AbstractBound(void) {}
@@ -54,6 +84,27 @@ struct AbstractBound {
   // tracking storage -- it's only implemented for the bounds
   // representations we really care about.
   virtual int getStorage(int whichMetric) const { return 0; }
+
+  // fills in stats and returns true if the representation prunes
+  // itself; returns false otherwise.
+  virtual bool getPruneStats(BoundPruneStats& stats) const { return false; }
+
+  // prints statistics on getValue() queries, for representations that
+  // keep them
+  virtual void printQueryStats(std::ostream& out) const {}
+
+  // saves the bound to a solver checkpoint, or restores it in place of
+  // initialize().  the search graph is restored first, so
+  // readCheckpoint() can fill in the boundsData of its nodes.  the
+  // defaults suit bounds that keep no state outside the node values.
+  virtual void writeCheckpoint(SolverCheckpointWriter& out) {
+    out.beginSection("BOUND");
+  }
+  virtual void readCheckpoint(SolverCheckpointReader& in,
+			      double targetPrecision) {
+    in.expectSection("BOUND");
+    initialize(targetPrecision);
+  }
 };
 
 }; // namespace zmdp
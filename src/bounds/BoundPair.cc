@@ -36,6 +36,8 @@
 #include "AbstractBound.h"
 #include "BoundPair.h"
 #include "MaxPlanesLowerBound.h"
+#include "SawtoothUpperBound.h"
+#include "PolicyLog.h"
 
 #define BP_INITIALIZATION_PRECISION_FACTOR (1e-2)
 
@@ -59,6 +61,14 @@ BoundPair::BoundPair(bool _maintainLowerBound,
   dualPointBounds(_dualPointBounds)
 {}
 
+BoundPair::~BoundPair(void)
+{
+  delete lookup;
+  delete nodeStore;
+  delete lowerBound;
+  delete upperBound;
+}
+
 void BoundPair::updateDualPointBounds(MDPNode& cn, int* maxUBActionP)
 {
   double lbVal, ubVal;
@@ -104,9 +114,7 @@ void BoundPair::updateDualPointBounds(MDPNode& cn, int* maxUBActionP)
 void BoundPair::initialize(MDP* _problem,
 			   const ZMDPConfig* _config)
 {
-  problem = _problem;
-  config = _config;
-  targetPrecision = config->getDouble("terminateRegretBound");
+  initGraph(_problem, _config);
 
   if (maintainLowerBound) {
     lowerBound->initialize(BP_INITIALIZATION_PRECISION_FACTOR * targetPrecision);
@@ -114,8 +122,18 @@ void BoundPair::initialize(MDP* _problem,
   if (maintainUpperBound) {
     upperBound->initialize(BP_INITIALIZATION_PRECISION_FACTOR * targetPrecision);
   }
+}
+
+// sets up an empty search graph
+void BoundPair::initGraph(MDP* _problem,
+			  const ZMDPConfig* _config)
+{
+  problem = _problem;
+  config = _config;
+  targetPrecision = config->getDouble("terminateRegretBound");
 
   lookup = new MDPHash();
+  nodeStore = new MDPNodeStore();
   root = NULL;
 
   numStatesTouched = 0;
@@ -133,43 +151,86 @@ MDPNode* BoundPair::getRootNode(void)
 
 MDPNode* BoundPair::getNode(const state_vector& s)
 {
-  string hs = hashable(s);
+  StateKey hs;
+  getStateKey(hs, s);
+  if (useConcurrentUpdates) {
+    return getNodeConcurrent(s, hs);
+  }
   MDPHash::iterator pr = lookup->find(hs);
   if (lookup->end() == pr) {
-    // create a new fringe node
-    MDPNode& cn = *(new MDPNode);
-    cn.s = s;
-    cn.isTerminal = problem->getIsTerminalState(s);
-    cn.searchData = NULL;
-    cn.boundsData = NULL;
+    return createNode(s, hs);
+  } else {
+    // return existing node
+    return pr->second;
+  }
+}
 
-    if (maintainUpperBound) {
-      upperBound->initNodeBound(cn);
-    } else {
-      cn.ubVal = -1; // n/a
-    }
-    if (maintainLowerBound) {
-      lowerBound->initNodeBound(cn);
-    } else {
-      cn.lbVal = -1; // n/a
-    }
-    (*lookup)[hs] = &cn;
+// version of getNode() used when several threads may be searching at
+// once.  looking up an existing node only requires the lock for one
+// shard of the hash table.  creating a new node initializes its bounds,
+// which can modify the shared bound representations, so it requires
+// the write lock on boundsLock.
+MDPNode* BoundPair::getNodeConcurrent(const state_vector& s,
+				      const StateKey& hs)
+{
+  ZMDPMutex& shardLock = lookup->getShardLock(hs);
+  shardLock.lock();
+  MDPHash::iterator pr = lookup->find(hs);
+  MDPNode* ret = (lookup->end() == pr) ? NULL : pr->second;
+  shardLock.unlock();
+  if (NULL != ret) return ret;
+
+  boundsLock.writeLock();
+  // check again; another thread may have created the node while we
+  // waited for the lock
+  pr = lookup->find(hs);
+  if (lookup->end() == pr) {
+    ret = createNode(s, hs);
+  } else {
+    ret = pr->second;
+  }
+  boundsLock.unlock();
+  return ret;
+}
 
-    FOR_EACH (hstructP, getNodeHandlers) {
-      (*hstructP->h)(cn, hstructP->hdata);
-    }
+// create a new fringe node and add it to the lookup table.  the node is
+// inserted only after it is fully initialized, so concurrent lookups
+// never see a partially constructed node.
+MDPNode* BoundPair::createNode(const state_vector& s, const StateKey& hs)
+{
+  MDPNode& cn = *nodeStore->newNode();
+  cn.s = s;
+  cn.isTerminal = problem->getIsTerminalState(s);
 
-    numStatesTouched++;
-    return &cn;
+  if (maintainUpperBound) {
+    upperBound->initNodeBound(cn);
   } else {
-    // return existing node
-    return pr->second;
+    cn.ubVal = -1; // n/a
+  }
+  if (maintainLowerBound) {
+    lowerBound->initNodeBound(cn);
+  } else {
+    cn.lbVal = -1; // n/a
+  }
+
+  FOR_EACH (hstructP, getNodeHandlers) {
+    (*hstructP->h)(cn, hstructP->hdata);
+  }
+
+  {
+    ZMDPMutexGuard g(lookup->getShardLock(hs), useConcurrentUpdates);
+    (*lookup)[hs] = &cn;
   }
+
+  numStatesTouched++;
+  return &cn;
 }
 
 MDPNode* BoundPair::getNodeOrNull(const state_vector& s) const
 {
-  typeof(lookup->begin()) pr = lookup->find(hashable(s));
+  StateKey hs;
+  getStateKey(hs, s);
+  typeof(lookup->begin()) pr = lookup->find(hs);
   if (lookup->end() == pr) {
     return NULL;
   } else {
@@ -181,27 +242,29 @@ void BoundPair::expand(MDPNode& cn)
 {
   // set up successors for this fringe node (possibly creating new fringe nodes)
   outcome_prob_vector opv;
-  state_vector sp;
-  cn.Q.resize(problem->getNumActions());
+  std::vector<state_vector> nextStates;
+  nodeStore->allocQ(cn, problem->getNumActions());
   FOR (a, problem->getNumActions()) {
     MDPQEntry& Qa = cn.Q[a];
     Qa.immediateReward = problem->getReward(cn.s, a);
-    problem->getOutcomeProbVector(opv, cn.s, a);
-    Qa.outcomes.resize(opv.size());
+    problem->getAllOutcomes(opv, nextStates, cn.s, a);
+    // outcomes with zero probability are left with nextState = NULL
+    nodeStore->allocOutcomes(Qa, opv.size());
     FOR (o, opv.size()) {
       double oprob = opv(o);
       if (oprob > OBS_IS_ZERO_EPS) {
-	MDPEdge* e = new MDPEdge();
-        Qa.outcomes[o] = e;
-        e->obsProb = oprob;
-        e->nextState = getNode(problem->getNextState(sp, cn.s, a, o));
-      } else {
-        Qa.outcomes[o] = NULL;
+	MDPEdge& e = Qa.outcomes.edges[o];
+        e.obsProb = oprob;
+        e.nextState = getNode(nextStates[o]);
       }
     }
     Qa.ubVal = BP_QVAL_UNDEFINED;
   }
-  numStatesExpanded++;
+  if (useConcurrentUpdates) {
+    atomicIncrement(numStatesExpanded);
+  } else {
+    numStatesExpanded++;
+  }
 }
 
 void BoundPair::update(MDPNode& cn, int* maxUBActionP)
@@ -209,6 +272,10 @@ void BoundPair::update(MDPNode& cn, int* maxUBActionP)
   if (cn.isFringe()) {
     expand(cn);
   }
+  if (useConcurrentUpdates) {
+    updateConcurrent(cn, maxUBActionP);
+    return;
+  }
   if (dualPointBounds) {
     // updateDualPointBounds is an optimized procedure that only works if both lower
     // and upper bound are point bounds
@@ -227,13 +294,51 @@ void BoundPair::update(MDPNode& cn, int* maxUBActionP)
   numBackups++;
 }
 
+// version of the bounds update used when several threads may be
+// searching at once (the caller holds the node lock for cn).  the
+// expensive backup calculations run in parallel under the read lock;
+// the results are committed under the write lock.  other threads may
+// commit between the two phases, but since the bounds only get tighter,
+// a backup calculated from slightly stale bounds is still valid.
+void BoundPair::updateConcurrent(MDPNode& cn, int* maxUBActionP)
+{
+  if (dualPointBounds) {
+    boundsLock.writeLock();
+    updateDualPointBounds(cn, maxUBActionP);
+    numBackups++;
+    boundsLock.unlock();
+    return;
+  }
+
+  void* lbData = NULL;
+  void* ubData = NULL;
+  boundsLock.readLock();
+  if (maintainLowerBound) {
+    lbData = lowerBound->computeUpdate(cn);
+  }
+  if (maintainUpperBound) {
+    ubData = upperBound->computeUpdate(cn, maxUBActionP);
+  }
+  boundsLock.unlock();
+
+  boundsLock.writeLock();
+  if (maintainLowerBound) {
+    lowerBound->commitUpdate(cn, lbData);
+  }
+  if (maintainUpperBound) {
+    upperBound->commitUpdate(cn, ubData, maxUBActionP);
+  }
+  numBackups++;
+  boundsLock.unlock();
+}
+
 // this implementation is not very efficient, but it is guaranteed not
 // to modify the algorithm state, so it can safely be used for
 // simulation testing in the middle of a run.
 int BoundPair::chooseAction(const state_vector& s) const
 {
   outcome_prob_vector opv;
-  state_vector sp;
+  std::vector<state_vector> nextStates;
   int bestAction = -1;
 
   if (!useUpperBoundRunTimeActionSelection) {
@@ -250,11 +355,11 @@ int BoundPair::chooseAction(const state_vector& s) const
     double maxVal = -99e+20;
     double minVal = 99e+20;
     FOR (a, problem->getNumActions()) {
-      problem->getOutcomeProbVector(opv, s, a);
+      problem->getAllOutcomes(opv, nextStates, s, a);
       lbVal = 0;
       FOR (o, opv.size()) {
 	if (opv(o) > OBS_IS_ZERO_EPS) {
-	  problem->getNextState(sp, s, a, o);
+	  const state_vector& sp = nextStates[o];
 	  lbVal += opv(o) * lowerBound->getValue(sp, getNodeOrNull(sp));
 	}
       }
@@ -275,11 +380,11 @@ int BoundPair::chooseAction(const state_vector& s) const
   double ubVal;
   double maxVal = -99e+20;
   FOR (a, problem->getNumActions()) {
-    problem->getOutcomeProbVector(opv, s, a);
+    problem->getAllOutcomes(opv, nextStates, s, a);
     ubVal = 0;
     FOR (o, opv.size()) {
       if (opv(o) > OBS_IS_ZERO_EPS) {
-	problem->getNextState(sp, s, a, o);
+	const state_vector& sp = nextStates[o];
 	ubVal += opv(o) * upperBound->getValue(sp, getNodeOrNull(sp));
       }
     }
@@ -301,17 +406,17 @@ ValueInterval BoundPair::getValueAt(const state_vector& s) const
 
 ValueInterval BoundPair::getQValue(const state_vector& s, int a) const
 {
-  state_vector sp;
+  std::vector<state_vector> nextStates;
   MDPNode* spn;
   double lbVal, ubVal;
   outcome_prob_vector opv;
 
   lbVal = 0;
   ubVal = 0;
-  problem->getOutcomeProbVector(opv, s, a);
+  problem->getAllOutcomes(opv, nextStates, s, a);
   FOR (o, opv.size()) {
     if (opv(o) > OBS_IS_ZERO_EPS) {
-      problem->getNextState(sp, s, a, o);
+      const state_vector& sp = nextStates[o];
       spn = getNodeOrNull(sp);
       if (maintainLowerBound) {
 	lbVal += opv(o) * lowerBound->getValue(sp, spn);
@@ -333,10 +438,165 @@ void BoundPair::writePolicy(const std::string& outFileName, bool canModifyBounds
   MaxPlanesLowerBound* mlb = (MaxPlanesLowerBound*) lowerBound;
   if (canModifyBounds) {
     mlb->prunePlanes(numBackups);
+    if (mlb->useMaxPlanesLPPruning) {
+      mlb->prunePlanesLP(numBackups);
+    }
   }
   mlb->writeToFile(outFileName);
 }
 
+void BoundPair::writeUpperBound(const std::string& outFileName)
+{
+  SawtoothUpperBound* sub = (SawtoothUpperBound*) upperBound;
+  sub->prune(numBackups);
+  sub->writeToFile(outFileName);
+}
+
+void BoundPair::writePolicyCheckpoint(PolicyLogWriter& log, double timeSoFar)
+{
+  MaxPlanesLowerBound* mlb = (MaxPlanesLowerBound*) lowerBound;
+  if (!log.isOpen()) {
+    log.open(mlb->pomdp->numStates);
+  }
+  log.checkpoint(*mlb, timeSoFar);
+}
+
+// the search graph is written first, with nodes identified by the
+// order they were created in, followed by the bound representations
+void BoundPair::writeCheckpoint(SolverCheckpointWriter& out)
+{
+  size_t numNodes = nodeStore->numNodes;
+  EXT_NAMESPACE::hash_map<const MDPNode*, long long> nodeIds;
+  FOR (i, numNodes) {
+    nodeIds[nodeStore->getNode(i)] = i;
+  }
+
+  out.beginSection("GRAPH");
+  out.writeInt(numStatesTouched);
+  out.writeInt(numStatesExpanded);
+  out.writeInt(numBackups);
+  out.writeInt(numNodes);
+  out.writeInt((NULL == root) ? -1 : nodeIds[root]);
+  FOR (i, numNodes) {
+    const MDPNode& cn = *nodeStore->getNode(i);
+    out.writeCVector(cn.s);
+    out.writeInt(cn.isTerminal);
+    out.writeDouble(cn.lbVal);
+    out.writeDouble(cn.ubVal);
+  }
+  FOR (i, numNodes) {
+    const MDPNode& cn = *nodeStore->getNode(i);
+    out.writeInt(cn.getNumActions());
+    FOR (a, cn.getNumActions()) {
+      const MDPQEntry& Qa = cn.Q[a];
+      out.writeDouble(Qa.immediateReward);
+      out.writeDouble(Qa.lbVal);
+      out.writeDouble(Qa.ubVal);
+      out.writeInt(Qa.getNumOutcomes());
+      FOR (o, Qa.getNumOutcomes()) {
+	MDPEdge* e = Qa.outcomes[o];
+	if (NULL == e) {
+	  out.writeInt(-1);
+	} else {
+	  out.writeInt(nodeIds[e->nextState]);
+	  out.writeDouble(e->obsProb);
+	}
+      }
+    }
+  }
+
+  if (maintainLowerBound) {
+    lowerBound->writeCheckpoint(out);
+  }
+  if (maintainUpperBound) {
+    upperBound->writeCheckpoint(out);
+  }
+}
+
+// restores the state saved by writeCheckpoint().  the get node handlers
+// run on each restored node, as they would when the node is created, so
+// the search strategy's per-node data is allocated.
+void BoundPair::readCheckpoint(MDP* _problem,
+			       const ZMDPConfig* _config,
+			       SolverCheckpointReader& in)
+{
+  initGraph(_problem, _config);
+
+  in.expectSection("GRAPH");
+  numStatesTouched = in.readInt();
+  numStatesExpanded = in.readInt();
+  numBackups = in.readInt();
+  long long numNodes = in.readInt();
+  long long rootId = in.readInt();
+  if (numNodes < 0 || rootId < -1 || rootId >= numNodes) {
+    in.fail("checkpoint is corrupted");
+  }
+
+  std::vector<MDPNode*> nodes(numNodes);
+  StateKey hs;
+  FOR (i, numNodes) {
+    MDPNode& cn = *nodeStore->newNode();
+    in.readCVector(cn.s);
+    cn.isTerminal = in.readInt();
+    cn.lbVal = in.readDouble();
+    cn.ubVal = in.readDouble();
+
+    FOR_EACH (hstructP, getNodeHandlers) {
+      (*hstructP->h)(cn, hstructP->hdata);
+    }
+    getStateKey(hs, cn.s);
+    (*lookup)[hs] = &cn;
+    nodes[i] = &cn;
+  }
+  root = (-1 == rootId) ? NULL : nodes[rootId];
+
+  FOR (i, numNodes) {
+    MDPNode& cn = *nodes[i];
+    int numActions = in.readInt();
+    if (0 == numActions) continue;
+    if (numActions != problem->getNumActions()) {
+      in.fail("checkpoint was written for a different model");
+    }
+    nodeStore->allocQ(cn, numActions);
+    FOR (a, numActions) {
+      MDPQEntry& Qa = cn.Q[a];
+      Qa.immediateReward = in.readDouble();
+      Qa.lbVal = in.readDouble();
+      Qa.ubVal = in.readDouble();
+      nodeStore->allocOutcomes(Qa, in.readInt());
+      FOR (o, Qa.getNumOutcomes()) {
+	long long id = in.readInt();
+	if (-1 == id) continue;
+	if (id < 0 || id >= numNodes) {
+	  in.fail("checkpoint is corrupted");
+	}
+	MDPEdge& e = Qa.outcomes.edges[o];
+	e.obsProb = in.readDouble();
+	e.nextState = nodes[id];
+      }
+    }
+  }
+
+  if (maintainLowerBound) {
+    lowerBound->readCheckpoint(in, BP_INITIALIZATION_PRECISION_FACTOR * targetPrecision);
+  }
+  if (maintainUpperBound) {
+    upperBound->readCheckpoint(in, BP_INITIALIZATION_PRECISION_FACTOR * targetPrecision);
+  }
+}
+
+bool BoundPair::getLowerBoundPruneStats(BoundPruneStats& stats) const
+{
+  if (!maintainLowerBound) return false;
+  return lowerBound->getPruneStats(stats);
+}
+
+void BoundPair::printBoundStats(std::ostream& out) const
+{
+  if (maintainLowerBound) lowerBound->printQueryStats(out);
+  if (maintainUpperBound) upperBound->printQueryStats(out);
+}
+
 }; // namespace zmdp
 
 /***************************************************************************
@@ -35,6 +35,8 @@ using namespace sla;
 
 namespace zmdp {
 
+struct PolicyLogWriter;
+
 struct BoundPair : public BoundPairCore {
   MDP* problem;
   const ZMDPConfig* config;
@@ -50,21 +52,39 @@ struct BoundPair : public BoundPairCore {
 	    bool _maintainUpperBound,
 	    bool _useUpperBoundRunTimeActionSelection,
 	    bool _dualPointBounds);
+  // deletes the search graph and the lower and upper bounds
+  ~BoundPair(void);
 
   void updateDualPointBounds(MDPNode& cn, int* maxUBActionP);
 
   void initialize(MDP* _problem,
 		  const ZMDPConfig* _config);
+  void initGraph(MDP* _problem,
+		 const ZMDPConfig* _config);
 
   MDPNode* getRootNode(void);
   MDPNode* getNode(const state_vector& s);
+  MDPNode* getNodeConcurrent(const state_vector& s, const StateKey& hs);
+  MDPNode* createNode(const state_vector& s, const StateKey& hs);
   MDPNode* getNodeOrNull(const state_vector& s) const;
   void expand(MDPNode& cn);
   void update(MDPNode& cn, int* maxUBActionP);
+  void updateConcurrent(MDPNode& cn, int* maxUBActionP);
   int chooseAction(const state_vector& s) const;
   ValueInterval getValueAt(const state_vector& s) const;
   ValueInterval getQValue(const state_vector& s, int a) const;
   void writePolicy(const std::string& outFileName, bool canModifyBounds);
+  // writes a sawtooth upper bound that a later run can warm-start from
+  void writeUpperBound(const std::string& outFileName);
+  // appends the changes to the policy since the last checkpoint to log,
+  // opening it on the first call
+  void writePolicyCheckpoint(PolicyLogWriter& log, double timeSoFar);
+  void writeCheckpoint(SolverCheckpointWriter& out);
+  void readCheckpoint(MDP* _problem,
+		      const ZMDPConfig* _config,
+		      SolverCheckpointReader& in);
+  bool getLowerBoundPruneStats(BoundPruneStats& stats) const;
+  void printBoundStats(std::ostream& out) const;
 };
 
 }; // namespace zmdp
@@ -29,9 +29,14 @@
 
 #include "MDPCache.h"
 #include "MDPModel.h"
+#include "AbstractBound.h"
 
 #define BP_QVAL_UNDEFINED (-99e+20)
 
+// number of mutexes in the lock-striped table used to lock individual
+// nodes during parallel search
+#define BP_NUM_NODE_LOCKS (1024)
+
 using namespace sla;
 
 namespace zmdp {
@@ -52,7 +57,23 @@ struct BoundPairCore {
 
   MDPNode* root;
   MDPHash* lookup;
-
+  MDPNodeStore* nodeStore;
+
+  // parallel search support.  when useConcurrentUpdates is true, the
+  // search strategy may call update() from several threads at once,
+  // as long as each thread holds getNodeLock(cn) for the node it is
+  // updating.  boundsLock protects the shared value function
+  // representations: it is held for reading while backups are
+  // calculated and for writing while their results are committed.
+  bool useConcurrentUpdates;
+  ZMDPRWLock boundsLock;
+  ZMDPMutex nodeLocks[BP_NUM_NODE_LOCKS];
+
+  BoundPairCore(void) :
+    lookup(NULL),
+    nodeStore(NULL),
+    useConcurrentUpdates(false)
+  {}
   virtual ~BoundPairCore(void) {}
 
   virtual void initialize(MDP* _problem,
@@ -67,9 +88,30 @@ struct BoundPairCore {
   virtual ValueInterval getQValue(const state_vector& s, int a) const = 0;
 
   virtual void writePolicy(const std::string& outFileName, bool canModifyBounds) { assert(0); }
+  virtual void writeUpperBound(const std::string& outFileName) { assert(0); }
+
+  // save the search graph and bound representations to a solver
+  // checkpoint, or restore them in place of initialize()
+  virtual void writeCheckpoint(SolverCheckpointWriter& out) { assert(0); }
+  virtual void readCheckpoint(MDP* _problem,
+			      const ZMDPConfig* _config,
+			      SolverCheckpointReader& in) { assert(0); }
+
+  // returns false if the lower bound does not prune itself
+  virtual bool getLowerBoundPruneStats(BoundPruneStats& stats) const { return false; }
+  // prints query statistics for the bound representations, if any
+  virtual void printBoundStats(std::ostream& out) const {}
 
   void addGetNodeHandler(GetNodeHandler getNodeHandler, void* handlerData);
 
+  void enableConcurrentUpdates(void) {
+    useConcurrentUpdates = true;
+    nodeStore->useLocking = true;
+  }
+  ZMDPMutex& getNodeLock(const MDPNode& cn) {
+    return nodeLocks[(((size_t) &cn) / sizeof(MDPNode)) % BP_NUM_NODE_LOCKS];
+  }
+
   // relies on correct cached Q values!
   static int getMaxUBAction(MDPNode& cn);
 
@@ -37,11 +37,26 @@ namespace zmdp {
 struct IncrementalLowerBound : public AbstractBound {
   virtual void initNodeBound(MDPNode& cn) = 0;
   virtual void update(MDPNode& cn) = 0;
+
+  // two-phase form of update() used by parallel search.
+  // computeUpdate() only reads the shared bound representation, so
+  // several threads can run it at once; it returns an opaque record
+  // that is later passed to commitUpdate(), which runs while other
+  // threads are locked out.  the default implementation does all of
+  // the work in the commit phase.
+  virtual void* computeUpdate(MDPNode& cn) { return NULL; }
+  virtual void commitUpdate(MDPNode& cn, void* updateData) { update(cn); }
   virtual int chooseAction(const state_vector& s) {
     // signal to fall back to default implementation if derived class
     // does not implement chooseAction()
     return -1;
   }
+  // like chooseAction(), but also sets margin to how much the best
+  // applicable plane at s beats the best plane with a different action
+  // (99e+20 if there is no such plane).  returns -1 if not implemented.
+  virtual int chooseActionWithMargin(const state_vector& s, double& margin) {
+    return -1;
+  }
 };
 
 }; // namespace zmdp
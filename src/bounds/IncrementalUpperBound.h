@@ -37,6 +37,13 @@ namespace zmdp {
 struct IncrementalUpperBound : public AbstractBound {
   virtual void initNodeBound(MDPNode& cn) = 0;
   virtual void update(MDPNode& cn, int* maxUBActionP) = 0;
+
+  // two-phase form of update(); see IncrementalLowerBound.  if the
+  // compute phase does not set *maxUBActionP, the commit phase must.
+  virtual void* computeUpdate(MDPNode& cn, int* maxUBActionP) { return NULL; }
+  virtual void commitUpdate(MDPNode& cn, void* updateData, int* maxUBActionP) {
+    update(cn, maxUBActionP);
+  }
 };
 
 }; // namespace zmdp
@@ -39,10 +39,142 @@ using namespace MatrixUtils;
 
 namespace zmdp {
 
-int getNodeCacheStorage(const MDPHash* lookup, int whichMetric)
+/**********************************************************************
+ * MDPSlabArena
+ **********************************************************************/
+
+MDPSlabArena::MDPSlabArena(void) :
+  pos(NULL),
+  end(NULL),
+  numBytesReserved(0),
+  numBytesUsed(0)
+{}
+
+MDPSlabArena::~MDPSlabArena(void)
+{
+  FOR_EACH (blockP, blocks) {
+    free(*blockP);
+  }
+}
+
+void* MDPSlabArena::alloc(size_t numBytes)
+{
+  // keep every allocation aligned for doubles and pointers
+  numBytes = (numBytes + MDP_SLAB_ALIGN - 1) & ~((size_t) MDP_SLAB_ALIGN - 1);
+  if (pos + numBytes > end) {
+    size_t blockSize = std::max((size_t) MDP_SLAB_BYTES, numBytes);
+    char* block = (char*) malloc(blockSize);
+    if (NULL == block) {
+      fprintf(stderr, "ERROR: MDPSlabArena: out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+    blocks.push_back(block);
+    numBytesReserved += blockSize;
+    pos = block;
+    end = block + blockSize;
+  }
+  void* ret = pos;
+  pos += numBytes;
+  numBytesUsed += numBytes;
+  return ret;
+}
+
+/**********************************************************************
+ * MDPNodeStore
+ **********************************************************************/
+
+MDPNodeStore::MDPNodeStore(void) :
+  numNodes(0),
+  useLocking(false)
+{}
+
+MDPNodeStore::~MDPNodeStore(void)
+{
+  FOR (i, numNodes) {
+    nodeBlocks[i / MDP_STORE_NODES_PER_BLOCK][i % MDP_STORE_NODES_PER_BLOCK].~MDPNode();
+  }
+  FOR_EACH (blockP, nodeBlocks) {
+    free(*blockP);
+  }
+}
+
+MDPNode* MDPNodeStore::newNode(void)
+{
+  ZMDPMutexGuard g(lock, useLocking);
+  int offset = numNodes % MDP_STORE_NODES_PER_BLOCK;
+  if (0 == offset) {
+    MDPNode* block =
+      (MDPNode*) malloc(MDP_STORE_NODES_PER_BLOCK * sizeof(MDPNode));
+    if (NULL == block) {
+      fprintf(stderr, "ERROR: MDPNodeStore: out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+    nodeBlocks.push_back(block);
+  }
+  MDPNode* cn = new (&nodeBlocks.back()[offset]) MDPNode();
+  numNodes++;
+
+  cn->isTerminal = false;
+  cn->lbVal = 0;
+  cn->ubVal = 0;
+  cn->searchData = NULL;
+  cn->boundsData = NULL;
+  return cn;
+}
+
+void MDPNodeStore::allocQ(MDPNode& cn, int numActions)
+{
+  MDPQEntry* entries;
+  {
+    ZMDPMutexGuard g(lock, useLocking);
+    entries = (MDPQEntry*) arena.alloc(numActions * sizeof(MDPQEntry));
+  }
+  FOR (a, numActions) {
+    new (&entries[a]) MDPQEntry();
+  }
+  cn.Q.entries = entries;
+  cn.Q.n = numActions;
+}
+
+void MDPNodeStore::allocOutcomes(MDPQEntry& Qa, int numOutcomes)
+{
+  MDPEdge* edges;
+  {
+    ZMDPMutexGuard g(lock, useLocking);
+    edges = (MDPEdge*) arena.alloc(numOutcomes * sizeof(MDPEdge));
+  }
+  FOR (o, numOutcomes) {
+    edges[o].obsProb = 0;
+    edges[o].nextState = NULL;
+  }
+  Qa.outcomes.edges = edges;
+  Qa.outcomes.n = numOutcomes;
+}
+
+void* MDPNodeStore::allocData(size_t numBytes)
+{
+  ZMDPMutexGuard g(lock, useLocking);
+  return arena.alloc(numBytes);
+}
+
+size_t MDPNodeStore::getNumBytes(void) const
+{
+  return nodeBlocks.size() * MDP_STORE_NODES_PER_BLOCK * sizeof(MDPNode)
+    + nodeBlocks.capacity() * sizeof(MDPNode*)
+    + arena.numBytesReserved
+    + arena.blocks.capacity() * sizeof(char*);
+}
+
+/**********************************************************************
+ * getNodeCacheStorage
+ **********************************************************************/
+
+int getNodeCacheStorage(const MDPHash* lookup, const MDPNodeStore* store,
+			int whichMetric)
 {
   int eltCount = 0;
   int entryCount = 0;
+  size_t numBytes = 0;
   FOR_EACH (pr, *lookup) {
     if (!pr->second->isFringe()) {
       eltCount++;
@@ -50,6 +182,8 @@ int getNodeCacheStorage(const MDPHash* lookup, int whichMetric)
       // the number of entries in the belief plus one for the value
       entryCount += pr->second->s.filled() + 1;
     }
+    // belief vectors keep their entries on the heap
+    numBytes += pr->second->s.data.capacity() * sizeof(cvector_entry);
   }
   
   switch (whichMetric) {
@@ -59,6 +193,20 @@ int getNodeCacheStorage(const MDPHash* lookup, int whichMetric)
   case ZMDP_S_NUM_ENTRIES_TABULAR:
     return entryCount;
 
+  case ZMDP_S_NUM_KBYTES_TABULAR:
+    // approximate hash table overhead: a bucket pointer per bucket,
+    // and for each element the key/value pair plus the next pointer and
+    // cached hash code kept by the hash table node
+    FOR (i, MDP_HASH_NUM_SHARDS) {
+      const MDPHash::Shard& sh = lookup->shards[i];
+      numBytes += sh.bucket_count() * sizeof(void*)
+	+ sh.size() * (sizeof(MDPHash::value_type) + sizeof(void*) + sizeof(size_t));
+    }
+    if (NULL != store) {
+      numBytes += store->getNumBytes();
+    }
+    return (int) (numBytes / 1024);
+
   default:
     /* N/A */
     return 0;
@@ -27,9 +27,19 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <new>
 
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTypes.h"
+#include "StateKey.h"
+#include "zmdpThreads.h"
+
+#define MDP_HASH_NUM_SHARDS (64)
+
+// MDPNodeStore allocation parameters
+#define MDP_SLAB_BYTES (1 << 20)
+#define MDP_SLAB_ALIGN (8)
+#define MDP_STORE_NODES_PER_BLOCK (4096)
 
 using namespace sla;
 
@@ -42,18 +52,49 @@ struct MDPEdge {
   MDPNode* nextState;
 };
 
+// MDPEdgeArray is the array of outcomes for one MDPQEntry.  The edges
+// are stored inline in a flat array allocated by MDPNodeStore; an edge
+// whose nextState is NULL represents an outcome with zero probability,
+// for which operator[] returns NULL.
+struct MDPEdgeArray {
+  MDPEdge* edges;
+  unsigned int n;
+
+  MDPEdgeArray(void) : edges(NULL), n(0) {}
+
+  MDPEdge* operator[](size_t o) const {
+    return (NULL == edges[o].nextState) ? NULL : &edges[o];
+  }
+  size_t size(void) const { return n; }
+};
+
 struct MDPQEntry {
   double immediateReward;
-  std::vector<MDPEdge*> outcomes;
+  MDPEdgeArray outcomes;
   double lbVal, ubVal;
 
   size_t getNumOutcomes(void) const { return outcomes.size(); }
 };
 
+// MDPQArray is the array of Q entries (one per action) for a node,
+// allocated by MDPNodeStore.  The node is a fringe node until the
+// array is allocated.
+struct MDPQArray {
+  MDPQEntry* entries;
+  unsigned int n;
+
+  MDPQArray(void) : entries(NULL), n(0) {}
+
+  MDPQEntry& operator[](size_t a) { return entries[a]; }
+  const MDPQEntry& operator[](size_t a) const { return entries[a]; }
+  size_t size(void) const { return n; }
+  bool empty(void) const { return 0 == n; }
+};
+
 struct MDPNode {
   state_vector s;
   bool isTerminal;
-  std::vector<MDPQEntry> Q;
+  MDPQArray Q;
   double lbVal, ubVal;
   // these fields are used for different purposes depending on the search
   //   strategy and value function representation
@@ -65,9 +106,139 @@ struct MDPNode {
   MDPNode& getNextState(int a, int o) { return *Q[a].outcomes[o]->nextState; }
 };
 
-typedef EXT_NAMESPACE::hash_map<std::string, MDPNode*> MDPHash;
+// MDPSlabArena hands out memory from large contiguous blocks, avoiding
+// the per-object overhead of the general-purpose allocator.  Memory is
+// only released when the arena is destroyed.
+struct MDPSlabArena {
+  std::vector<char*> blocks;
+  char* pos;
+  char* end;
+  size_t numBytesReserved;
+  size_t numBytesUsed;
+
+  MDPSlabArena(void);
+  ~MDPSlabArena(void);
+
+  void* alloc(size_t numBytes);
+};
+
+// MDPNodeStore owns the nodes of a search graph along with their Q
+// entries, outcome edges, and per-node search and bounds data, all
+// allocated from slabs.  Nodes are never freed individually; the whole
+// graph is freed when the store is destroyed.
+struct MDPNodeStore {
+  MDPSlabArena arena;
+  std::vector<MDPNode*> nodeBlocks;
+  size_t numNodes;
+  // set during parallel search, when Q entries and edges may be
+  // allocated by several threads at once
+  bool useLocking;
+  ZMDPMutex lock;
+
+  MDPNodeStore(void);
+  ~MDPNodeStore(void);
+
+  MDPNode* newNode(void);
+  // returns the i'th node created
+  MDPNode* getNode(size_t i) const {
+    return &nodeBlocks[i / MDP_STORE_NODES_PER_BLOCK][i % MDP_STORE_NODES_PER_BLOCK];
+  }
+  // sets cn.Q to a new array of numActions entries with no outcomes
+  void allocQ(MDPNode& cn, int numActions);
+  // sets Qa.outcomes to a new array of numOutcomes zero-probability edges
+  void allocOutcomes(MDPQEntry& Qa, int numOutcomes);
+  void* allocData(size_t numBytes);
+
+  // allocates a value-initialized object of type T for use as
+  // MDPNode::searchData or MDPNode::boundsData.  T's destructor is
+  // never called, so it should not own other memory.
+  template <class T>
+  T* newData(void) { return new (allocData(sizeof(T))) T(); }
+
+  size_t getNumBytes(void) const;
+};
+
+// MDPHash maps state keys to search graph nodes.  It is split into
+// MDP_HASH_NUM_SHARDS independent hash tables, each with its own mutex,
+// so that parallel search threads can look up and insert nodes
+// concurrently.  The interface is the subset of hash_map used in the
+// codebase; callers that need thread safety hold getShardLock(key)
+// around find() and operator[].
+struct MDPHash {
+  typedef EXT_NAMESPACE::hash_map<StateKey, MDPNode*, StateKeyHash> Shard;
+  typedef Shard::value_type value_type;
+
+  struct iterator {
+    MDPHash* h;
+    int shard;
+    Shard::iterator pos;
+
+    iterator(void) : h(NULL), shard(MDP_HASH_NUM_SHARDS) {}
+    iterator(MDPHash* _h, int _shard, Shard::iterator _pos) :
+      h(_h), shard(_shard), pos(_pos)
+    {
+      skipEmpty();
+    }
+
+    // advance past the end of empty shards
+    void skipEmpty(void) {
+      while (shard < MDP_HASH_NUM_SHARDS && h->shards[shard].end() == pos) {
+	shard++;
+	if (shard < MDP_HASH_NUM_SHARDS) pos = h->shards[shard].begin();
+      }
+    }
+    value_type& operator*(void) const { return *pos; }
+    value_type* operator->(void) const { return &(*pos); }
+    iterator& operator++(void) { pos++; skipEmpty(); return *this; }
+    iterator operator++(int) { iterator ret = *this; ++(*this); return ret; }
+    bool operator==(const iterator& rhs) const {
+      if (shard != rhs.shard) return false;
+      return (MDP_HASH_NUM_SHARDS == shard) || (pos == rhs.pos);
+    }
+    bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+  };
+  typedef iterator const_iterator;
+
+  Shard shards[MDP_HASH_NUM_SHARDS];
+  ZMDPMutex shardLocks[MDP_HASH_NUM_SHARDS];
+
+  static int getShardIndex(const StateKey& key) {
+    // the low bits of fp1 select the bucket within a shard, so use
+    // the high bits to select the shard
+    return (int) ((key.fp1 >> 58) % MDP_HASH_NUM_SHARDS);
+  }
+  ZMDPMutex& getShardLock(const StateKey& key) {
+    return shardLocks[getShardIndex(key)];
+  }
+
+  iterator begin(void) {
+    return iterator(this, 0, shards[0].begin());
+  }
+  iterator begin(void) const {
+    return ((MDPHash*) this)->begin();
+  }
+  iterator end(void) const { return iterator(); }
+  iterator find(const StateKey& key) const {
+    int i = getShardIndex(key);
+    Shard& sh = ((MDPHash*) this)->shards[i];
+    Shard::iterator pos = sh.find(key);
+    if (sh.end() == pos) return end();
+    return iterator((MDPHash*) this, i, pos);
+  }
+  MDPNode*& operator[](const StateKey& key) {
+    return shards[getShardIndex(key)][key];
+  }
+  size_t size(void) const {
+    size_t ret = 0;
+    FOR (i, MDP_HASH_NUM_SHARDS) {
+      ret += shards[i].size();
+    }
+    return ret;
+  }
+};
 
-int getNodeCacheStorage(const MDPHash* lookup, int whichMetric);
+int getNodeCacheStorage(const MDPHash* lookup, const MDPNodeStore* store,
+			int whichMetric);
 
 }; // namespace zmdp
 
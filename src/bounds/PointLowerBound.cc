@@ -120,7 +120,8 @@ int PointLowerBound::getStorage(int whichMetric) const
 
   case ZMDP_S_NUM_ELTS_TABULAR:
   case ZMDP_S_NUM_ENTRIES_TABULAR:
-    return getNodeCacheStorage(core->lookup, whichMetric);
+  case ZMDP_S_NUM_KBYTES_TABULAR:
+    return getNodeCacheStorage(core->lookup, core->nodeStore, whichMetric);
 
   default:
     assert(0); // never reach this point
@@ -56,16 +56,18 @@ void RelaxUBInitializer::setup(double targetPrecision)
   initUpperBound->initialize(targetPrecision);
 
   lookup = new MDPHash();
+  nodeStore = new MDPNodeStore();
   root = getNode(problem->getInitialState());
 }
 
 MDPNode* RelaxUBInitializer::getNode(const state_vector& s)
 {
-  string hs = hashable(s);
+  StateKey hs;
+  getStateKey(hs, s);
   MDPHash::iterator pr = lookup->find(hs);
   if (lookup->end() == pr) {
     // create a new fringe node
-    MDPNode& cn = *(new MDPNode);
+    MDPNode& cn = *nodeStore->newNode();
     cn.s = s;
     cn.lbVal = initLowerBound->getValue(s, NULL);
     cn.ubVal = initUpperBound->getValue(s, NULL);
@@ -81,22 +83,19 @@ void RelaxUBInitializer::expand(MDPNode& cn)
 {
   // set up successors for this fringe node (possibly creating new fringe nodes)
   outcome_prob_vector opv;
-  state_vector sp;
-  cn.Q.resize(problem->getNumActions());
+  std::vector<state_vector> nextStates;
+  nodeStore->allocQ(cn, problem->getNumActions());
   FOR (a, problem->getNumActions()) {
     MDPQEntry& Qa = cn.Q[a];
     Qa.immediateReward = problem->getReward(cn.s, a);
-    problem->getOutcomeProbVector(opv, cn.s, a);
-    Qa.outcomes.resize(opv.size());
+    problem->getAllOutcomes(opv, nextStates, cn.s, a);
+    nodeStore->allocOutcomes(Qa, opv.size());
     FOR (o, opv.size()) {
       double oprob = opv(o);
       if (oprob > OBS_IS_ZERO_EPS) {
-	MDPEdge* e = new MDPEdge();
-        Qa.outcomes[o] = e;
-        e->obsProb = oprob;
-        e->nextState = getNode(problem->getNextState(sp, cn.s, a, o));
-      } else {
-        Qa.outcomes[o] = NULL;
+	MDPEdge& e = Qa.outcomes.edges[o];
+        e.obsProb = oprob;
+        e.nextState = getNode(nextStates[o]);
       }
     }
   }
@@ -259,7 +258,7 @@ double RelaxUBInitializer::getValue(const state_vector& s, const MDPNode* cn) co
 
 int RelaxUBInitializer::getStorage(int whichMetric) const
 {
-  return getNodeCacheStorage(lookup, whichMetric);
+  return getNodeCacheStorage(lookup, nodeStore, whichMetric);
 }
 
 }; // namespace zmdp
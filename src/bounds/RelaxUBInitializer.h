@@ -33,6 +33,7 @@ struct RelaxUBInitializer : public AbstractBound {
   MDP* problem;
   MDPNode* root;
   MDPHash* lookup;
+  MDPNodeStore* nodeStore;
   AbstractBound* initLowerBound;
   AbstractBound* initUpperBound;
   const ZMDPConfig* config;
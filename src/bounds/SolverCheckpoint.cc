@@ -0,0 +1,272 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    SolverCheckpoint.cc
+ @brief   Binary files holding the full state of a solver, for resuming a run.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <iostream>
+
+#include "zmdpCommonDefs.h"
+#include "SolverCheckpoint.h"
+
+using namespace std;
+using namespace sla;
+
+namespace zmdp {
+
+static const char SC_MAGIC[8] = { 'Z','M','D','P','C','K','P','\0' };
+static const uint32_t SC_BYTE_ORDER_MARK = 0x01020304;
+static const char* SC_END_TAG = "END";
+
+struct SCHeader {
+  char magic[8];
+  int32_t version;
+  uint32_t byteOrderMark;
+  int32_t entryBytes;
+  int32_t reserved;
+};
+
+static void scMakeTag(char* result, const char* tag)
+{
+  assert(strlen(tag) <= ZMDP_CHECKPOINT_TAG_BYTES);
+  memset(result, 0, ZMDP_CHECKPOINT_TAG_BYTES);
+  memcpy(result, tag, strlen(tag));
+}
+
+/***************************************************************************
+ * WRITING
+ ***************************************************************************/
+
+SolverCheckpointWriter::SolverCheckpointWriter(const std::string& _fileName) :
+  fileName(_fileName),
+  tmpFileName(_fileName + ".tmp")
+{
+  outFile = fopen(tmpFileName.c_str(), "wb");
+  if (NULL == outFile) {
+    fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
+	    tmpFileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  SCHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, SC_MAGIC, sizeof(h.magic));
+  h.version = ZMDP_SOLVER_CHECKPOINT_VERSION;
+  h.byteOrderMark = SC_BYTE_ORDER_MARK;
+  h.entryBytes = sizeof(cvector_entry);
+  write(&h, sizeof(h));
+}
+
+SolverCheckpointWriter::~SolverCheckpointWriter(void)
+{
+  if (NULL != outFile) {
+    // close() was never called; don't leave a partial file behind
+    fclose(outFile);
+    unlink(tmpFileName.c_str());
+  }
+}
+
+void SolverCheckpointWriter::beginSection(const char* tag)
+{
+  char buf[ZMDP_CHECKPOINT_TAG_BYTES];
+  scMakeTag(buf, tag);
+  write(buf, sizeof(buf));
+}
+
+void SolverCheckpointWriter::write(const void* x, size_t numBytes)
+{
+  if (numBytes > 0 && 1 != fwrite(x, numBytes, 1, outFile)) {
+    fprintf(stderr, "ERROR: error writing %s: %s\n",
+	    tmpFileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+}
+
+void SolverCheckpointWriter::writeInt(long long x)
+{
+  int64_t y = x;
+  write(&y, sizeof(y));
+}
+
+void SolverCheckpointWriter::writeDouble(double x)
+{
+  write(&x, sizeof(x));
+}
+
+void SolverCheckpointWriter::writeCVector(const cvector& x)
+{
+  writeInt(x.size());
+  writeInt(x.data.size());
+  write(x.data.empty() ? NULL : &x.data[0],
+	x.data.size() * sizeof(cvector_entry));
+}
+
+void SolverCheckpointWriter::writeDVector(const dvector& x)
+{
+  writeInt(x.size());
+  write(x.data.empty() ? NULL : &x.data[0], x.data.size() * sizeof(double));
+}
+
+void SolverCheckpointWriter::close(void)
+{
+  beginSection(SC_END_TAG);
+  if (0 != fflush(outFile) || 0 != fsync(fileno(outFile))) {
+    fprintf(stderr, "ERROR: error writing %s: %s\n",
+	    tmpFileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  fclose(outFile);
+  outFile = NULL;
+  if (0 != rename(tmpFileName.c_str(), fileName.c_str())) {
+    fprintf(stderr, "ERROR: couldn't rename %s to %s: %s\n",
+	    tmpFileName.c_str(), fileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+}
+
+/***************************************************************************
+ * READING
+ ***************************************************************************/
+
+SolverCheckpointReader::SolverCheckpointReader(const std::string& _fileName) :
+  fileName(_fileName)
+{
+  inFile = fopen(fileName.c_str(), "rb");
+  if (NULL == inFile) {
+    cerr << "ERROR: couldn't open " << fileName << " for reading: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  SCHeader h;
+  if (1 != fread(&h, sizeof(h), 1, inFile)
+      || 0 != memcmp(h.magic, SC_MAGIC, sizeof(h.magic))) {
+    fail("not a ZMDP solver checkpoint file");
+  }
+  if (h.byteOrderMark != SC_BYTE_ORDER_MARK
+      || h.entryBytes != (int) sizeof(cvector_entry)) {
+    fail("checkpoint was written on an incompatible architecture");
+  }
+  if (h.version != ZMDP_SOLVER_CHECKPOINT_VERSION) {
+    cerr << "ERROR: " << fileName << ": checkpoint format version "
+	 << h.version << " is not supported (expected version "
+	 << ZMDP_SOLVER_CHECKPOINT_VERSION << ")" << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+SolverCheckpointReader::~SolverCheckpointReader(void)
+{
+  if (NULL != inFile) {
+    fclose(inFile);
+  }
+}
+
+void SolverCheckpointReader::expectSection(const char* tag)
+{
+  char expected[ZMDP_CHECKPOINT_TAG_BYTES];
+  char found[ZMDP_CHECKPOINT_TAG_BYTES + 1];
+  scMakeTag(expected, tag);
+  read(found, ZMDP_CHECKPOINT_TAG_BYTES);
+  if (0 != memcmp(expected, found, ZMDP_CHECKPOINT_TAG_BYTES)) {
+    found[ZMDP_CHECKPOINT_TAG_BYTES] = '\0';
+    cerr << "ERROR: " << fileName << ": expected checkpoint section '"
+	 << tag << "' but found '" << found << "' (was the checkpoint "
+	 << "written with a different search strategy or bound "
+	 << "representation?)" << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+void SolverCheckpointReader::read(void* x, size_t numBytes)
+{
+  if (numBytes > 0 && 1 != fread(x, numBytes, 1, inFile)) {
+    fail("checkpoint is truncated");
+  }
+}
+
+long long SolverCheckpointReader::readInt(void)
+{
+  int64_t x;
+  read(&x, sizeof(x));
+  return x;
+}
+
+double SolverCheckpointReader::readDouble(void)
+{
+  double x;
+  read(&x, sizeof(x));
+  return x;
+}
+
+void SolverCheckpointReader::readCVector(cvector& x)
+{
+  long long size = readInt();
+  long long numEntries = readInt();
+  if (size < 0 || numEntries < 0 || numEntries > size) {
+    fail("checkpoint is corrupted");
+  }
+  x.resize(size);
+  x.data.resize(numEntries);
+  read(x.data.empty() ? NULL : &x.data[0],
+       numEntries * sizeof(cvector_entry));
+}
+
+void SolverCheckpointReader::readDVector(dvector& x)
+{
+  long long size = readInt();
+  if (size < 0) {
+    fail("checkpoint is corrupted");
+  }
+  x.resize(size);
+  read(x.data.empty() ? NULL : &x.data[0], size * sizeof(double));
+}
+
+void SolverCheckpointReader::close(void)
+{
+  expectSection(SC_END_TAG);
+  char c;
+  if (1 == fread(&c, 1, 1, inFile)) {
+    fail("unexpected data after the end of the checkpoint");
+  }
+  fclose(inFile);
+  inFile = NULL;
+}
+
+void SolverCheckpointReader::fail(const char* msg) const
+{
+  cerr << "ERROR: " << fileName << ": " << msg << endl;
+  exit(EXIT_FAILURE);
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,97 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    SolverCheckpoint.h
+ @brief   Binary files holding the full state of a solver, for resuming a run.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCSolverCheckpoint_h
+#define INCSolverCheckpoint_h
+
+#include <stdio.h>
+
+#include <string>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTypes.h"
+
+// A solver checkpoint holds everything a search needs to continue where
+// it left off: the search graph with its cached Q values, the bound
+// representations, and the search strategy's counters and per-node
+// data.  The file is a sequence of tagged sections, each written and
+// read back in the same order by the object that owns the state, so a
+// checkpoint can only be resumed with the same model and the same
+// search strategy and bound representations.  Checkpoints are specific
+// to the architecture that wrote them.
+#define ZMDP_SOLVER_CHECKPOINT_VERSION (1)
+
+// section tags are at most this long
+#define ZMDP_CHECKPOINT_TAG_BYTES (8)
+
+namespace zmdp {
+
+// writes to a temporary file that close() renames into place, so an
+// interrupted write never clobbers the previous checkpoint
+struct SolverCheckpointWriter {
+  std::string fileName;
+  std::string tmpFileName;
+  FILE* outFile;
+
+  SolverCheckpointWriter(const std::string& _fileName);
+  ~SolverCheckpointWriter(void);
+
+  void beginSection(const char* tag);
+  void write(const void* x, size_t numBytes);
+  void writeInt(long long x);
+  void writeDouble(double x);
+  void writeCVector(const sla::cvector& x);
+  void writeDVector(const sla::dvector& x);
+  void close(void);
+};
+
+// any error (a missing file, a truncated file, or a section that does
+// not match what the caller expects) is fatal
+struct SolverCheckpointReader {
+  std::string fileName;
+  FILE* inFile;
+
+  SolverCheckpointReader(const std::string& _fileName);
+  ~SolverCheckpointReader(void);
+
+  void expectSection(const char* tag);
+  void read(void* x, size_t numBytes);
+  long long readInt(void);
+  double readDouble(void);
+  void readCVector(sla::cvector& x);
+  void readDVector(sla::dvector& x);
+  // checks that the whole file was read
+  void close(void);
+
+  // prints an error message mentioning the file and exits
+  void fail(const char* msg) const;
+};
+
+}; // namespace zmdp
+
+#endif // INCSolverCheckpoint_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
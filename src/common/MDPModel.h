@@ -71,6 +71,25 @@ struct MDP {
   // returns the expected immediate reward when from state s action a is selected
   virtual double getReward(const state_vector& s, int a) = 0;
 
+  // sets opv to be the vector of outcome probabilities when from state
+  // s action a is selected, and sets nextStates[o] to be the next state
+  // for every outcome o with opv(o) > OBS_IS_ZERO_EPS (other entries of
+  // nextStates are unspecified).  the default implementation just calls
+  // getOutcomeProbVector() and getNextState(); models that can share
+  // work across outcomes should override it.
+  virtual void getAllOutcomes(outcome_prob_vector& opv,
+			      std::vector<state_vector>& nextStates,
+			      const state_vector& s, int a)
+  {
+    getOutcomeProbVector(opv, s, a);
+    nextStates.resize(opv.size());
+    FOR (o, opv.size()) {
+      if (opv(o) > OBS_IS_ZERO_EPS) {
+	getNextState(nextStates[o], s, a, o);
+      }
+    }
+  }
+
   // returns a new lower bound or upper bound that is valid for
   // this MDP.  notes:
   // * the resulting bound must be initialized before it is used, and
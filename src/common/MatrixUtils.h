@@ -54,6 +54,11 @@ namespace MatrixUtils {
   // Generate a sample from a uniform distribution over [0,1].
   double unit_rand(void);
 
+  // Directs unit_rand() calls in the current thread to stream (or back
+  // to the global generator if stream is NULL).
+  struct RandomStream;
+  void setThreadRandomStream(RandomStream* stream);
+
   // Generate a matrix where each sample is drawn according to unit_rand().
   void rand_matrix(dmatrix& result, int num_rows, int num_cols);
   void rand_vector(dvector& v, int num_entries);
@@ -90,6 +95,46 @@ namespace MatrixUtils {
    * FUNCTIONS
    **********************************************************************/
 
+  // A seedable pseudo-random number stream (splitmix64).  Streams
+  // with different seeds are independent for practical purposes, so a
+  // computation split into pieces can give each piece its own stream and
+  // get the same result no matter which thread runs each piece.
+  struct RandomStream {
+    unsigned long long state;
+
+    RandomStream(unsigned long long seed = 0) : state(seed) {}
+
+    unsigned long long nextInt(void) {
+      unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+    }
+
+    // uniform over [0,1)
+    double nextUnit(void) {
+      return (nextInt() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // seed for the index'th sub-stream of a computation seeded with seed
+    static unsigned long long deriveSeed(unsigned long long seed,
+					 unsigned long long index) {
+      RandomStream r(seed ^ (index * 0xD1B54A32D192ED03ULL));
+      return r.nextInt();
+    }
+  };
+
+  inline RandomStream*& threadRandomStream(void)
+  {
+    static __thread RandomStream* stream = NULL;
+    return stream;
+  }
+
+  inline void setThreadRandomStream(RandomStream* stream)
+  {
+    threadRandomStream() = stream;
+  }
+
   inline void init_matrix_utils(void)
   {
   // Initialize the random number generator
@@ -101,6 +146,10 @@ namespace MatrixUtils {
   // Generate a sample from a uniform distribution over [0,1].
   inline double unit_rand(void)
   {
+    RandomStream* stream = threadRandomStream();
+    if (NULL != stream) {
+      return stream->nextUnit();
+    }
     return ((double)std::rand())/RAND_MAX;
   }
 
@@ -199,10 +248,11 @@ namespace MatrixUtils {
     return 0;
   }
 
+  // the returned buffer is reused by the next call in the same thread
   inline const char* hashable(const dvector& b)
   {
-    static char *buf = NULL;
-    static unsigned int n = 0;
+    static __thread char *buf = NULL;
+    static __thread unsigned int n = 0;
 
     if (b.size() > n) {
       n = b.size();
@@ -220,8 +270,8 @@ namespace MatrixUtils {
 
   inline const char* hashable(const cvector& b)
   {
-    static char *buf = NULL;
-    static unsigned int n = 0;
+    static __thread char *buf = NULL;
+    static __thread unsigned int n = 0;
 
     if (b.size() > n) {
       n = b.size();
@@ -0,0 +1,133 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    SimplexSolver.cc
+ @brief   Small dense simplex solver for the LP pruning of lower bound planes.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+
+#include "zmdpCommonDefs.h"
+#include "SimplexSolver.h"
+
+// coefficients smaller than this are treated as zero when choosing
+// pivots
+#define SIMPLEX_EPS (1e-12)
+
+namespace zmdp {
+
+void SimplexSolver::setSize(int _numVars, int _numConstraints)
+{
+  numVars = _numVars;
+  numConstraints = _numConstraints;
+  tableau.assign((numConstraints+1) * stride(), 0.0);
+
+  // slack variables start out basic
+  basis.resize(numConstraints);
+  FOR (i, numConstraints) {
+    tableau[i*stride() + numVars + i] = 1.0;
+    basis[i] = numVars + i;
+  }
+}
+
+void SimplexSolver::pivot(int row, int col)
+{
+  int w = stride();
+  double* prow = &tableau[row*w];
+  double scale = 1.0 / prow[col];
+  FOR (j, w) {
+    prow[j] *= scale;
+  }
+  prow[col] = 1.0;
+
+  FOR (i, numConstraints+1) {
+    if ((int) i == row) continue;
+    double* irow = &tableau[i*w];
+    double factor = irow[col];
+    if (0.0 == factor) continue;
+    FOR (j, w) {
+      irow[j] -= factor * prow[j];
+    }
+    irow[col] = 0.0;
+  }
+  basis[row] = col;
+}
+
+int SimplexSolver::solve(int maxIterations)
+{
+  int w = stride();
+  int numCols = numVars + numConstraints;
+  const double* obj = &tableau[objRow()*w];
+
+  FOR (iter, maxIterations) {
+    // Bland's rule: entering variable is the lowest-indexed column
+    // with a negative reduced cost
+    int col = -1;
+    FOR (j, numCols) {
+      if (obj[j] < -SIMPLEX_EPS) {
+	col = j;
+	break;
+      }
+    }
+    if (-1 == col) return SIMPLEX_OPTIMAL;
+
+    // ratio test; ties go to the row whose basic variable has the
+    // lowest index
+    int row = -1;
+    double bestRatio = 0;
+    FOR (i, numConstraints) {
+      double a = tableau[i*w + col];
+      if (a <= SIMPLEX_EPS) continue;
+      double ratio = tableau[i*w + rhsCol()] / a;
+      if (-1 == row
+	  || ratio < bestRatio - SIMPLEX_EPS
+	  || (ratio <= bestRatio + SIMPLEX_EPS && basis[i] < basis[row])) {
+	row = i;
+	bestRatio = ratio;
+      }
+    }
+    if (-1 == row) return SIMPLEX_UNBOUNDED;
+
+    pivot(row, col);
+  }
+
+  return SIMPLEX_ITERATION_LIMIT;
+}
+
+void SimplexSolver::getSolution(std::vector<double>& x) const
+{
+  x.assign(numVars, 0.0);
+  FOR (i, numConstraints) {
+    if (basis[i] < numVars) {
+      x[basis[i]] = tableau[i*stride() + rhsCol()];
+    }
+  }
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,81 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    SimplexSolver.h
+ @brief   Small dense simplex solver for the LP pruning of lower bound planes.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCSimplexSolver_h
+#define INCSimplexSolver_h
+
+#include <vector>
+
+#define SIMPLEX_OPTIMAL          (0)
+#define SIMPLEX_UNBOUNDED        (1)
+#define SIMPLEX_ITERATION_LIMIT  (2)
+
+namespace zmdp {
+
+// Solves
+//
+//   maximize c'x  subject to  A x <= b,  x >= 0
+//
+// where b >= 0, so that x = 0 is feasible and no phase-one is needed.
+// Uses a dense tableau and Bland's rule, which is fine for the small
+// problems this is meant for (tens of constraints).
+struct SimplexSolver {
+  int numVars;
+  int numConstraints;
+
+  SimplexSolver(void) : numVars(0), numConstraints(0) {}
+
+  // clears any previous problem; all coefficients start at zero
+  void setSize(int _numVars, int _numConstraints);
+  void setObjective(int var, double c) { tableau[objRow()*stride() + var] = -c; }
+  void setConstraint(int row, int var, double a) { tableau[row*stride() + var] = a; }
+  void setBound(int row, double b) { tableau[row*stride() + rhsCol()] = b; }
+
+  // returns one of the SIMPLEX_* codes above
+  int solve(int maxIterations);
+
+  double getObjectiveValue(void) const { return tableau[objRow()*stride() + rhsCol()]; }
+  void getSolution(std::vector<double>& x) const;
+
+protected:
+  // the tableau has one row per constraint plus the objective row, and
+  // one column per variable, one slack column per constraint, and the
+  // right-hand side
+  std::vector<double> tableau;
+  // basis[row] is the variable that is basic in that row
+  std::vector<int> basis;
+
+  int stride(void) const { return numVars + numConstraints + 1; }
+  int rhsCol(void) const { return numVars + numConstraints; }
+  int objRow(void) const { return numConstraints; }
+  void pivot(int row, int col);
+};
+
+}; // namespace zmdp
+
+#endif // INCSimplexSolver_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -54,6 +54,11 @@ public:
   
   // wraps up logging actions when the run is finished
   virtual void finishLogging(void) {}
+
+  // writes the full state of the solver to a checkpoint file that a
+  // later run can resume from (see the resumeFrom config parameter).
+  // returns false if no checkpoint was written.
+  virtual bool writeCheckpoint(const std::string& fileName) { return false; }
 };
 
 }; // namespace zmdp
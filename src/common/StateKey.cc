@@ -0,0 +1,53 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    StateKey.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#include <assert.h>
+
+#include <set>
+#include <string>
+
+#include "StateKey.h"
+#include "zmdpThreads.h"
+
+namespace zmdp {
+
+// text keys are only used to reproduce old runs, so the table is never
+// cleared
+static std::set<std::string>* stateKeyTextTableG = NULL;
+static ZMDPMutex stateKeyTextLockG;
+
+const std::string* internStateKeyText(const std::string& text)
+{
+  ZMDPMutexGuard g(stateKeyTextLockG);
+  if (NULL == stateKeyTextTableG) {
+    stateKeyTextTableG = new std::set<std::string>();
+  }
+  return &(*stateKeyTextTableG->insert(text).first);
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,136 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    StateKey.h
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCStateKey_h
+#define INCStateKey_h
+
+#include <stdint.h>
+#include <math.h>
+
+#include <string>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTypes.h"
+#include "MatrixUtils.h"
+
+// entries are quantized to the same precision used by
+// HASH_VECTOR_PRECISION, so two states map to the same fingerprint
+// key exactly when they would map to the same text key (barring
+// fingerprint collisions, which are astronomically unlikely with
+// 128 bits)
+#define STATE_KEY_QUANTA_PER_UNIT (1e+9)
+
+// set from the useFingerprintStateKeys config field, defined in
+// zmdpConfig.cc
+extern bool zmdpUseFingerprintStateKeysG;
+
+namespace zmdp {
+
+// StateKey identifies a state (or POMDP belief) in the node caches
+// (MDPHash, CMDPHash, StateIndex).  By default the key is a 128-bit
+// fingerprint of the (index, quantized value) pairs of the state
+// vector, which is much cheaper to generate and compare than the
+// string returned by MatrixUtils::hashable().  If the global
+// zmdpUseFingerprintStateKeysG is false, the key falls back to the
+// hashable() text, which is useful for checking that a run is
+// byte-for-byte identical to one made with older versions of ZMDP.
+// Text keys point into a table of interned strings, so that
+// fingerprint keys stay plain values that never allocate, and equal
+// texts always have the same pointer.
+struct StateKey {
+  uint64_t fp1, fp2;
+  const std::string* text; // NULL unless using text keys
+
+  bool operator==(const StateKey& rhs) const {
+    return (fp1 == rhs.fp1) && (fp2 == rhs.fp2) && (text == rhs.text);
+  }
+  bool operator!=(const StateKey& rhs) const { return !(*this == rhs); }
+};
+
+struct StateKeyHash {
+  size_t operator()(const StateKey& k) const { return (size_t) k.fp1; }
+};
+
+// MurmurHash2-style 64-bit mixing step
+inline void stateKeyMix(uint64_t& h, uint64_t w, uint64_t m)
+{
+  w *= m;
+  w ^= w >> 47;
+  w *= m;
+  h ^= w;
+  h *= m;
+}
+
+// final avalanche (from MurmurHash3)
+inline uint64_t stateKeyFinish(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// returns the interned copy of text, which lives until the program
+// exits.  safe to call from several threads.
+const std::string* internStateKeyText(const std::string& text);
+
+// sets result to be the key for s
+inline void getStateKey(StateKey& result, const sla::cvector& s)
+{
+  if (!zmdpUseFingerprintStateKeysG) {
+    result.text = internStateKeyText(MatrixUtils::hashable(s));
+    EXT_NAMESPACE::hash<std::string> h;
+    result.fp1 = h(*result.text);
+    result.fp2 = 0;
+    return;
+  }
+
+  // two hash lanes with different seeds and multipliers make up the
+  // 128-bit fingerprint
+  const uint64_t m1 = 0xc6a4a7935bd1e995ULL;
+  const uint64_t m2 = 0x9e3779b97f4a7c15ULL;
+  uint64_t h1 = 0x8445d61a4e774912ULL ^ (s.filled() * m1);
+  uint64_t h2 = 0x2f7e0a7d3c1b5b29ULL ^ (s.filled() * m2);
+  FOR_EACH (si, s.data) {
+    uint64_t ind = si->index;
+    uint64_t q = (uint64_t) (int64_t) floor(si->value * STATE_KEY_QUANTA_PER_UNIT + 0.5);
+    stateKeyMix(h1, ind, m1);
+    stateKeyMix(h1, q, m1);
+    stateKeyMix(h2, q, m2);
+    stateKeyMix(h2, ind, m2);
+  }
+  result.fp1 = stateKeyFinish(h1);
+  result.fp2 = stateKeyFinish(h2);
+  result.text = NULL;
+}
+
+}; // namespace zmdp
+
+#endif // INCStateKey_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
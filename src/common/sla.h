@@ -32,6 +32,7 @@
 #include <algorithm>
 
 #include "zmdpCommonDefs.h"
+#include "sla_kernels.h"
 
 // sla     = simple linear algebra
 // dvector = dense vector
@@ -87,6 +88,27 @@ namespace sla {
       value(_value)
     {}
   };
+
+  // the vectorized kernels in sla_kernels.h rely on this layout
+  typedef char cvector_entry_size_check
+    [(sizeof(cvector_entry) == SLA_ENTRY_BYTES) ? 1 : -1];
+  typedef char cvector_entry_offset_check
+    [(offsetof(cvector_entry, value) == SLA_ENTRY_VALUE_OFFSET) ? 1 : -1];
+
+  // appends n entries to buf in the cvector_entry layout
+  // (SLA_ENTRY_BYTES each).  the padding after each index is zeroed, so
+  // binary files written from buf do not depend on uninitialized memory.
+  inline void append_packed_entries(std::vector<char>& buf,
+				    const cvector_entry* entries, size_t n)
+  {
+    size_t pos = buf.size();
+    buf.resize(pos + n * SLA_ENTRY_BYTES, 0);
+    char* p = n ? &buf[pos] : NULL;
+    for (size_t i=0; i < n; i++, p += SLA_ENTRY_BYTES) {
+      memcpy(p, &entries[i].index, sizeof(entries[i].index));
+      memcpy(p + SLA_ENTRY_VALUE_OFFSET, &entries[i].value, sizeof(entries[i].value));
+    }
+  }
   
   struct cvector {
     unsigned int size_;
@@ -850,17 +872,16 @@ namespace sla {
   // result = x * A
   inline void mult(dvector& result, const dvector& x, const cmatrix& A)
   {
-    typeof(A.data.begin()) Ai, col_end;
-
     assert( x.size() == A.size1() );
     result.resize( A.size2() );
 
+    if (A.data.empty()) return;
+    const char* entries = (const char*) &A.data[0];
     FOR (c, A.size2()) {
-      col_end = A.data.begin() + A.col_starts[c+1];
-      for (Ai = A.data.begin() + A.col_starts[c];
-	   Ai != col_end; Ai++) {
-	result(c) += x(Ai->index) * Ai->value;
-      }
+      unsigned int start = A.col_starts[c];
+      result(c) += dot_gather( &x.data[0], 0,
+			       entries + start * SLA_ENTRY_BYTES,
+			       A.col_starts[c+1] - start );
     }
   }
 
@@ -1008,11 +1029,9 @@ namespace sla {
   inline double inner_prod(const dvector& x, const cvector& y)
   {
     assert( x.size() == y.size() );
-    double sum = 0.0;
-    FOR_EACH (yi, y.data) {
-      sum += x(yi->index) * yi->value;
-    }
-    return sum;
+    if (y.data.empty()) return 0.0;
+    return dot_gather( &x.data[0], 0,
+		       (const char*) &y.data[0], y.data.size() );
   }
 
   // result = x .* y [for all i, result(i) = x(i) * y(i)]
@@ -1041,6 +1060,18 @@ namespace sla {
   inline double inner_prod(const cvector& x, const cvector& y)
   {
     assert( x.size() == y.size() );
+    if (x.data.empty() || y.data.empty()) return 0.0;
+
+    // if one operand has an entry for every index, its values can be
+    // gathered directly instead of merging the two index lists
+    if (x.data.size() == x.size()) {
+      return dot_gather( &x.data[0].value, 1,
+			 (const char*) &y.data[0], y.data.size() );
+    } else if (y.data.size() == y.size()) {
+      return dot_gather( &y.data[0].value, 1,
+			 (const char*) &x.data[0], x.data.size() );
+    }
+
     return inner_prod_cvector_internal( x.data.begin(), x.data.end(),
 					y.data.begin(), y.data.end() );
   }
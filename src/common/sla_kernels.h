@@ -0,0 +1,362 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    sla_kernels.h
+ @brief   Vectorized kernels for the sparse-dense inner products in sla.h.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCsla_kernels_h
+#define INCsla_kernels_h
+
+#include <stddef.h>
+#include <stdlib.h>
+
+// the kernels take pointers to arrays of sla::cvector_entry records.
+// sla.h checks that cvector_entry has this layout.
+#define SLA_ENTRY_BYTES (16)
+#define SLA_ENTRY_VALUE_OFFSET (8)
+
+// below this many entries the scalar loop is faster than setting up
+// the vector registers
+#define SLA_SIMD_MIN_ENTRIES (8)
+
+#define SLA_SIMD_SCALAR (0)
+#define SLA_SIMD_AVX2   (1)
+#define SLA_SIMD_AVX512 (2)
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) \
+  && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define SLA_HAVE_X86_KERNELS 1
+#  include <immintrin.h>
+#endif
+
+namespace sla {
+
+  /**********************************************************************
+   * RUN-TIME KERNEL SELECTION
+   **********************************************************************/
+
+  inline int& simd_level_internal(void)
+  {
+    static int level = -1;
+    return level;
+  }
+
+  inline int detect_simd_level(void)
+  {
+#if SLA_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SLA_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return SLA_SIMD_AVX2;
+    }
+#endif
+    return SLA_SIMD_SCALAR;
+  }
+
+  // returns the most capable kernel set supported by this cpu, unless
+  // overridden with set_simd_level().  the ZMDP_SLA_SIMD environment
+  // variable (0=scalar, 1=avx2, 2=avx512) can lower the initial level.
+  inline int simd_level(void)
+  {
+    int& level = simd_level_internal();
+    if (-1 == level) {
+      int detected = detect_simd_level();
+      const char* env = getenv("ZMDP_SLA_SIMD");
+      if (NULL != env) {
+	int requested = atoi(env);
+	if (requested < detected) detected = requested;
+      }
+      level = detected;
+    }
+    return level;
+  }
+
+  // request a less capable kernel set (levels above what the cpu
+  // supports are clamped)
+  inline void set_simd_level(int level)
+  {
+    int detected = detect_simd_level();
+    simd_level_internal() = (level < detected) ? level : detected;
+  }
+
+  /**********************************************************************
+   * GATHER DOT PRODUCT
+   *
+   * returns sum_i x[ entries[i].index << xshift ] * entries[i].value
+   *
+   * with xshift = 0, x is a dense array of doubles (a dvector).  with
+   * xshift = 1, x points to the value field of the first entry of a
+   * cvector that has an entry for every index (so that
+   * x.data[j].index == j), since each entry is two doubles wide.
+   **********************************************************************/
+
+  inline double dot_gather_scalar(const double* x, int xshift,
+				  const char* entries, size_t n)
+  {
+    double sum = 0.0;
+    for (size_t i=0; i < n; i++) {
+      const char* e = entries + i*SLA_ENTRY_BYTES;
+      unsigned int ind = *((const unsigned int*) e);
+      sum += x[((size_t) ind) << xshift]
+	* *((const double*) (e + SLA_ENTRY_VALUE_OFFSET));
+    }
+    return sum;
+  }
+
+#if SLA_HAVE_X86_KERNELS
+
+  // gcc 12 reports false positives inside the avx512 intrinsic headers
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+  // each 256-bit load picks up two whole entries: [index0 pad value0
+  // | index1 pad value1].  unpacking pairs of loads separates the
+  // values and (zero-extended) indices into 64-bit lanes, so the only
+  // gather needed is the one that reads x.
+
+  __attribute__((target("avx2,fma")))
+  inline double dot_gather_avx2(const double* x, int xshift,
+				const char* entries, size_t n)
+  {
+    const __m256i indexMask = _mm256_set1_epi64x(0xFFFFFFFFLL);
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    const __m256d zero = _mm256_setzero_pd();
+    const __m128i shift = _mm_cvtsi32_si128(xshift);
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i+8 <= n; i += 8) {
+      const double* e = (const double*) (entries + i*SLA_ENTRY_BYTES);
+      __m256d e01 = _mm256_loadu_pd(e);
+      __m256d e23 = _mm256_loadu_pd(e+4);
+      __m256d e45 = _mm256_loadu_pd(e+8);
+      __m256d e67 = _mm256_loadu_pd(e+12);
+      __m256i ind0 = _mm256_and_si256(_mm256_castpd_si256(_mm256_unpacklo_pd(e01, e23)),
+				      indexMask);
+      __m256i ind1 = _mm256_and_si256(_mm256_castpd_si256(_mm256_unpacklo_pd(e45, e67)),
+				      indexMask);
+      __m256d x0 = _mm256_mask_i64gather_pd(zero, x, _mm256_sll_epi64(ind0, shift),
+					    allLanes, 8);
+      __m256d x1 = _mm256_mask_i64gather_pd(zero, x, _mm256_sll_epi64(ind1, shift),
+					    allLanes, 8);
+      acc0 = _mm256_fmadd_pd(x0, _mm256_unpackhi_pd(e01, e23), acc0);
+      acc1 = _mm256_fmadd_pd(x1, _mm256_unpackhi_pd(e45, e67), acc1);
+    }
+    acc0 = _mm256_add_pd(acc0, acc1);
+    __m128d sum2 = _mm_add_pd(_mm256_castpd256_pd128(acc0),
+			      _mm256_extractf128_pd(acc0, 1));
+    double sum = _mm_cvtsd_f64(_mm_add_sd(sum2, _mm_unpackhi_pd(sum2, sum2)));
+    return sum + dot_gather_scalar(x, xshift, entries + i*SLA_ENTRY_BYTES, n-i);
+  }
+
+  __attribute__((target("avx512f")))
+  inline double dot_gather_avx512(const double* x, int xshift,
+				  const char* entries, size_t n)
+  {
+    // same scheme as the avx2 kernel, four entries per load
+    const __m512i indexMask = _mm512_set1_epi64(0xFFFFFFFFLL);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m128i shift = _mm_cvtsi32_si128(xshift);
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i+16 <= n; i += 16) {
+      const double* e = (const double*) (entries + i*SLA_ENTRY_BYTES);
+      __m512d e03 = _mm512_loadu_pd(e);
+      __m512d e47 = _mm512_loadu_pd(e+8);
+      __m512d e811 = _mm512_loadu_pd(e+16);
+      __m512d e1215 = _mm512_loadu_pd(e+24);
+      __m512i ind0 = _mm512_and_si512(_mm512_castpd_si512(_mm512_unpacklo_pd(e03, e47)),
+				      indexMask);
+      __m512i ind1 = _mm512_and_si512(_mm512_castpd_si512(_mm512_unpacklo_pd(e811, e1215)),
+				      indexMask);
+      __m512d x0 = _mm512_mask_i64gather_pd(zero, 0xFF, _mm512_sll_epi64(ind0, shift),
+					    x, 8);
+      __m512d x1 = _mm512_mask_i64gather_pd(zero, 0xFF, _mm512_sll_epi64(ind1, shift),
+					    x, 8);
+      acc0 = _mm512_fmadd_pd(x0, _mm512_unpackhi_pd(e03, e47), acc0);
+      acc1 = _mm512_fmadd_pd(x1, _mm512_unpackhi_pd(e811, e1215), acc1);
+    }
+    double lanes[8];
+    _mm512_storeu_pd(lanes, _mm512_add_pd(acc0, acc1));
+    double sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]))
+      + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    if (i+8 <= n) {
+      // finish with the avx2 kernel rather than the scalar loop
+      return sum + dot_gather_avx2(x, xshift, entries + i*SLA_ENTRY_BYTES, n-i);
+    }
+    return sum + dot_gather_scalar(x, xshift, entries + i*SLA_ENTRY_BYTES, n-i);
+  }
+
+#pragma GCC diagnostic pop
+
+#endif // SLA_HAVE_X86_KERNELS
+
+  inline double dot_gather(const double* x, int xshift,
+			   const char* entries, size_t n)
+  {
+#if SLA_HAVE_X86_KERNELS
+    if (n >= SLA_SIMD_MIN_ENTRIES) {
+      switch (simd_level()) {
+      case SLA_SIMD_AVX512:
+	return dot_gather_avx512(x, xshift, entries, n);
+      case SLA_SIMD_AVX2:
+	return dot_gather_avx2(x, xshift, entries, n);
+      default:
+	break;
+      }
+    }
+#endif
+    return dot_gather_scalar(x, xshift, entries, n);
+  }
+
+  /**********************************************************************
+   * GATHER MIN RATIO
+   *
+   * returns min_i x[ entries[i].index ] / entries[i].value, or 99e+20
+   * if n = 0.  used for sawtooth interpolation, where x is a dense
+   * belief and the entries are the non-zeros of a stored point.  the
+   * result does not depend on which kernel is used, since division and
+   * min are exact.
+   **********************************************************************/
+
+  inline double min_ratio_gather_scalar(const double* x,
+					const char* entries, size_t n)
+  {
+    double minRatio = 99e+20;
+    for (size_t i=0; i < n; i++) {
+      const char* e = entries + i*SLA_ENTRY_BYTES;
+      unsigned int ind = *((const unsigned int*) e);
+      double ratio = x[ind] / *((const double*) (e + SLA_ENTRY_VALUE_OFFSET));
+      if (ratio < minRatio) minRatio = ratio;
+    }
+    return minRatio;
+  }
+
+#if SLA_HAVE_X86_KERNELS
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+  // same entry unpacking as dot_gather_avx2()
+  __attribute__((target("avx2,fma")))
+  inline double min_ratio_gather_avx2(const double* x,
+				      const char* entries, size_t n)
+  {
+    const __m256i indexMask = _mm256_set1_epi64x(0xFFFFFFFFLL);
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d min0 = _mm256_set1_pd(99e+20);
+    __m256d min1 = min0;
+    size_t i = 0;
+    for (; i+8 <= n; i += 8) {
+      const double* e = (const double*) (entries + i*SLA_ENTRY_BYTES);
+      __m256d e01 = _mm256_loadu_pd(e);
+      __m256d e23 = _mm256_loadu_pd(e+4);
+      __m256d e45 = _mm256_loadu_pd(e+8);
+      __m256d e67 = _mm256_loadu_pd(e+12);
+      __m256i ind0 = _mm256_and_si256(_mm256_castpd_si256(_mm256_unpacklo_pd(e01, e23)),
+				      indexMask);
+      __m256i ind1 = _mm256_and_si256(_mm256_castpd_si256(_mm256_unpacklo_pd(e45, e67)),
+				      indexMask);
+      __m256d x0 = _mm256_mask_i64gather_pd(zero, x, ind0, allLanes, 8);
+      __m256d x1 = _mm256_mask_i64gather_pd(zero, x, ind1, allLanes, 8);
+      min0 = _mm256_min_pd(min0, _mm256_div_pd(x0, _mm256_unpackhi_pd(e01, e23)));
+      min1 = _mm256_min_pd(min1, _mm256_div_pd(x1, _mm256_unpackhi_pd(e45, e67)));
+    }
+    min0 = _mm256_min_pd(min0, min1);
+    __m128d min2 = _mm_min_pd(_mm256_castpd256_pd128(min0),
+			      _mm256_extractf128_pd(min0, 1));
+    double minRatio = _mm_cvtsd_f64(_mm_min_sd(min2, _mm_unpackhi_pd(min2, min2)));
+    double rest = min_ratio_gather_scalar(x, entries + i*SLA_ENTRY_BYTES, n-i);
+    return (rest < minRatio) ? rest : minRatio;
+  }
+
+  __attribute__((target("avx512f")))
+  inline double min_ratio_gather_avx512(const double* x,
+					const char* entries, size_t n)
+  {
+    const __m512i indexMask = _mm512_set1_epi64(0xFFFFFFFFLL);
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d min0 = _mm512_set1_pd(99e+20);
+    __m512d min1 = min0;
+    size_t i = 0;
+    for (; i+16 <= n; i += 16) {
+      const double* e = (const double*) (entries + i*SLA_ENTRY_BYTES);
+      __m512d e03 = _mm512_loadu_pd(e);
+      __m512d e47 = _mm512_loadu_pd(e+8);
+      __m512d e811 = _mm512_loadu_pd(e+16);
+      __m512d e1215 = _mm512_loadu_pd(e+24);
+      __m512i ind0 = _mm512_and_si512(_mm512_castpd_si512(_mm512_unpacklo_pd(e03, e47)),
+				      indexMask);
+      __m512i ind1 = _mm512_and_si512(_mm512_castpd_si512(_mm512_unpacklo_pd(e811, e1215)),
+				      indexMask);
+      __m512d x0 = _mm512_mask_i64gather_pd(zero, 0xFF, ind0, x, 8);
+      __m512d x1 = _mm512_mask_i64gather_pd(zero, 0xFF, ind1, x, 8);
+      min0 = _mm512_min_pd(min0, _mm512_div_pd(x0, _mm512_unpackhi_pd(e03, e47)));
+      min1 = _mm512_min_pd(min1, _mm512_div_pd(x1, _mm512_unpackhi_pd(e811, e1215)));
+    }
+    double lanes[8];
+    _mm512_storeu_pd(lanes, _mm512_min_pd(min0, min1));
+    double minRatio = lanes[0];
+    for (int k=1; k < 8; k++) {
+      if (lanes[k] < minRatio) minRatio = lanes[k];
+    }
+    double rest;
+    if (i+8 <= n) {
+      rest = min_ratio_gather_avx2(x, entries + i*SLA_ENTRY_BYTES, n-i);
+    } else {
+      rest = min_ratio_gather_scalar(x, entries + i*SLA_ENTRY_BYTES, n-i);
+    }
+    return (rest < minRatio) ? rest : minRatio;
+  }
+
+#pragma GCC diagnostic pop
+
+#endif // SLA_HAVE_X86_KERNELS
+
+  inline double min_ratio_gather(const double* x,
+				 const char* entries, size_t n)
+  {
+#if SLA_HAVE_X86_KERNELS
+    if (n >= SLA_SIMD_MIN_ENTRIES) {
+      switch (simd_level()) {
+      case SLA_SIMD_AVX512:
+	return min_ratio_gather_avx512(x, entries, n);
+      case SLA_SIMD_AVX2:
+	return min_ratio_gather_avx2(x, entries, n);
+      default:
+	break;
+      }
+    }
+#endif
+    return min_ratio_gather_scalar(x, entries, n);
+  }
+
+}; // namespace sla
+
+#endif // INCsla_kernels_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
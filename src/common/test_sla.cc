@@ -451,6 +451,66 @@ void test_mask(void)
        << " " << zm(6) << endl;
 }
 
+void test_kernels(void)
+{
+  const int n = 5000;
+  const int nnz = 500;
+  const int reps = 20000;
+  const char* levelNames[] = { "scalar", "avx2", "avx512" };
+  timeval start_time, end_time;
+
+  // random dense vector, sparse vector, and dense-indexed cvector
+  srand(1);
+  dvector xd(n);
+  FOR (i, n) {
+    xd(i) = ((double) rand()) / RAND_MAX;
+  }
+  cvector xc;
+  copy( xc, xd );
+  cvector y(n);
+  for (int i=0; i < n; i += n/nnz) {
+    y.push_back( i + rand() % (n/nnz), ((double) rand()) / RAND_MAX );
+  }
+
+  double expected = 0.0;
+  double expectedMinRatio = 99e+20;
+  FOR_EACH (yi, y.data) {
+    expected += xd(yi->index) * yi->value;
+    expectedMinRatio = std::min(expectedMinRatio, xd(yi->index) / yi->value);
+  }
+
+  cout << "--kernels: detected level=" << levelNames[simd_level()] << endl;
+  int maxLevel = simd_level();
+  for (int level=0; level <= maxLevel; level++) {
+    set_simd_level(level);
+    double dsum = inner_prod( xd, y );
+    double csum = inner_prod( xc, y );
+    double minRatio = min_ratio_gather(&xd.data[0],
+				       (const char*) &y.data[0], y.data.size());
+    bool ok = (fabs(dsum - expected) < 1e-9 && fabs(csum - expected) < 1e-9
+	       && minRatio == expectedMinRatio);
+
+    gettimeofday(&start_time,0);
+    double total = 0.0;
+    FOR (r, reps) {
+      total += inner_prod( xd, y );
+    }
+    gettimeofday(&end_time,0);
+    double elapsed = ((end_time.tv_sec - start_time.tv_sec)
+		      + 1e-6*(end_time.tv_usec - start_time.tv_usec));
+
+    cout << "  " << levelNames[level]
+	 << ": " << (ok ? "ok" : "MISMATCH")
+	 << " dvector.cvector=" << dsum
+	 << " cvector.cvector=" << csum
+	 << " expected=" << expected
+	 << " minRatio=" << minRatio
+	 << " ns/call=" << (1e+9 * elapsed / reps)
+	 << " (checksum " << total << ")" << endl;
+  }
+  set_simd_level(maxLevel);
+}
+
 void test_performance(void)
 {
   cmatrix T;
@@ -521,6 +581,7 @@ int main(int argc, char** argv) {
   test_unary();
   test_binary();
   test_mask();
+  test_kernels();
 
   test_performance();
 
@@ -25,6 +25,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <time.h>
+#include <math.h>
 #include <iostream>
 #include "zmdpCommonTime.h"
 
@@ -106,6 +108,90 @@ getTime(void) {
   return tv;
 }
 
+double
+getMonotonicSeconds(void) {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+void
+LatencyHistogram::clear(void) {
+  for (int k=0; k < LATENCY_HISTOGRAM_NUM_BUCKETS; k++) {
+    counts[k] = 0;
+  }
+  numSamples = 0;
+  sumSeconds = 0.0;
+  maxSeconds = 0.0;
+}
+
+void
+LatencyHistogram::add(double seconds) {
+  double us = seconds * 1e+6;
+  int k = 0;
+  if (us >= 1.0) {
+    k = 1 + (int) floor(log2(us));
+    if (k >= LATENCY_HISTOGRAM_NUM_BUCKETS) {
+      k = LATENCY_HISTOGRAM_NUM_BUCKETS-1;
+    }
+  }
+  counts[k]++;
+  numSamples++;
+  sumSeconds += seconds;
+  if (seconds > maxSeconds) maxSeconds = seconds;
+}
+
+void
+LatencyHistogram::merge(const LatencyHistogram& other) {
+  for (int k=0; k < LATENCY_HISTOGRAM_NUM_BUCKETS; k++) {
+    counts[k] += other.counts[k];
+  }
+  numSamples += other.numSamples;
+  sumSeconds += other.sumSeconds;
+  if (other.maxSeconds > maxSeconds) maxSeconds = other.maxSeconds;
+}
+
+double
+LatencyHistogram::getQuantileBound(double q) const {
+  long long target = (long long) ceil(q * numSamples);
+  long long cumulative = 0;
+  for (int k=0; k < LATENCY_HISTOGRAM_NUM_BUCKETS-1; k++) {
+    cumulative += counts[k];
+    if (cumulative >= target) {
+      return ldexp(1e-6, k);
+    }
+  }
+  return maxSeconds;
+}
+
+void
+LatencyHistogram::print(std::ostream& out, const char* label) const {
+  char buf[256];
+  if (0 == numSamples) {
+    snprintf(buf, sizeof(buf), "%s: no samples\n", label);
+    out << buf;
+    return;
+  }
+  snprintf(buf, sizeof(buf),
+	   "%s: %lld samples, mean %.2f us, p50 < %.0f us, p99 < %.0f us, max %.2f us\n",
+	   label, numSamples, 1e+6 * sumSeconds / numSamples,
+	   1e+6 * getQuantileBound(0.5), 1e+6 * getQuantileBound(0.99),
+	   1e+6 * maxSeconds);
+  out << buf;
+  for (int k=0; k < LATENCY_HISTOGRAM_NUM_BUCKETS; k++) {
+    if (0 == counts[k]) continue;
+    double lo = (0 == k) ? 0.0 : ldexp(1.0, k-1);
+    if (k == LATENCY_HISTOGRAM_NUM_BUCKETS-1) {
+      snprintf(buf, sizeof(buf), "  [%8.0f us ...        ) %10lld %5.1f%%\n",
+	       lo, counts[k], 100.0 * counts[k] / numSamples);
+    } else {
+      snprintf(buf, sizeof(buf), "  [%8.0f us, %8.0f us) %10lld %5.1f%%\n",
+	       lo, ldexp(1.0, k), counts[k], 100.0 * counts[k] / numSamples);
+    }
+    out << buf;
+  }
+}
+
 }; // namespace zmdp
 
 /***************************************************************************
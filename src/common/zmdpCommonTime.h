@@ -24,6 +24,13 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <iosfwd>
+
+// bucket 0 of a LatencyHistogram counts durations under 1 microsecond;
+// bucket k counts durations in [2^(k-1), 2^k) microseconds, and the
+// last bucket also counts anything longer
+#define LATENCY_HISTOGRAM_NUM_BUCKETS (28)
+
 namespace zmdp {
 
 void fsleep(double seconds);
@@ -44,6 +51,29 @@ timeval operator +(const timeval &a, const timeval &b);
 bool operator <(const timeval &a, const timeval &b);
 timeval getTime(void);
 
+// monotonic clock reading in seconds, with sub-microsecond resolution
+// where the system provides it.  only differences are meaningful.
+double getMonotonicSeconds(void);
+
+// Distribution of short durations (such as per-decision latencies) in
+// power-of-two buckets.  Histograms from different threads can be
+// merged.
+struct LatencyHistogram {
+  long long counts[LATENCY_HISTOGRAM_NUM_BUCKETS];
+  long long numSamples;
+  double sumSeconds;
+  double maxSeconds;
+
+  LatencyHistogram(void) { clear(); }
+  void clear(void);
+  void add(double seconds);
+  void merge(const LatencyHistogram& other);
+  // upper edge of the bucket containing the q'th quantile, in seconds
+  double getQuantileBound(double q) const;
+  // writes a summary line followed by one line per non-empty bucket
+  void print(std::ostream& out, const char* label) const;
+};
+
 }; // namespace zmdp
 
 #endif // INCzmdpCommonTime_h
@@ -298,6 +298,7 @@ void ZMDPConfig::writeToStream(std::ostream& out) const
 };
 
 int zmdpDebugLevelG = 0;
+bool zmdpUseFingerprintStateKeysG = true;
 
 /***************************************************************************
  * REVISION HISTORY:
@@ -67,6 +67,7 @@ struct ZMDPConfig {
 }; // namespace zmdp
 
 extern int zmdpDebugLevelG;
+extern bool zmdpUseFingerprintStateKeysG;
 
 #endif // INCzmdpConfig_h
 
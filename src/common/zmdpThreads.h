@@ -0,0 +1,133 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    zmdpThreads.h
+ @brief   Thin wrappers for the pthread primitives used by parallel search.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCzmdpThreads_h
+#define INCzmdpThreads_h
+
+#include <pthread.h>
+
+namespace zmdp {
+
+struct ZMDPMutex {
+  pthread_mutex_t m;
+
+  ZMDPMutex(void) { pthread_mutex_init(&m, NULL); }
+  ~ZMDPMutex(void) { pthread_mutex_destroy(&m); }
+
+  void lock(void) { pthread_mutex_lock(&m); }
+  void unlock(void) { pthread_mutex_unlock(&m); }
+
+private:
+  // not copyable
+  ZMDPMutex(const ZMDPMutex&);
+  void operator=(const ZMDPMutex&);
+};
+
+struct ZMDPRWLock {
+  pthread_rwlock_t l;
+
+  ZMDPRWLock(void) {
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+    // the glibc default lets a steady stream of readers starve writers
+    pthread_rwlockattr_setkind_np(&attr,
+				  PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&l, &attr);
+    pthread_rwlockattr_destroy(&attr);
+  }
+  ~ZMDPRWLock(void) { pthread_rwlock_destroy(&l); }
+
+  void readLock(void) { pthread_rwlock_rdlock(&l); }
+  void writeLock(void) { pthread_rwlock_wrlock(&l); }
+  void unlock(void) { pthread_rwlock_unlock(&l); }
+
+private:
+  // not copyable
+  ZMDPRWLock(const ZMDPRWLock&);
+  void operator=(const ZMDPRWLock&);
+};
+
+struct ZMDPCondition {
+  pthread_cond_t c;
+
+  ZMDPCondition(void) { pthread_cond_init(&c, NULL); }
+  ~ZMDPCondition(void) { pthread_cond_destroy(&c); }
+
+  // the caller must hold mutex
+  void wait(ZMDPMutex& mutex) { pthread_cond_wait(&c, &mutex.m); }
+  void broadcast(void) { pthread_cond_broadcast(&c); }
+
+private:
+  // not copyable
+  ZMDPCondition(const ZMDPCondition&);
+  void operator=(const ZMDPCondition&);
+};
+
+// locks the mutex for the lifetime of the guard if doLock is true
+struct ZMDPMutexGuard {
+  ZMDPMutex* mutex;
+
+  ZMDPMutexGuard(ZMDPMutex& _mutex, bool doLock = true) :
+    mutex(doLock ? &_mutex : NULL)
+  {
+    if (NULL != mutex) mutex->lock();
+  }
+  ~ZMDPMutexGuard(void) {
+    if (NULL != mutex) mutex->unlock();
+  }
+};
+
+// relaxed atomic access to a double that may be read by one thread while
+// another thread writes it
+inline double atomicLoadDouble(const double& x)
+{
+  double ret;
+  __atomic_load(&x, &ret, __ATOMIC_RELAXED);
+  return ret;
+}
+
+inline void atomicStoreDouble(double& x, double val)
+{
+  __atomic_store(&x, &val, __ATOMIC_RELAXED);
+}
+
+inline void atomicIncrement(int& x)
+{
+  __sync_fetch_and_add(&x, 1);
+}
+
+inline void atomicAdd(long long& x, long long delta)
+{
+  __sync_fetch_and_add(&x, delta);
+}
+
+}; // namespace zmdp
+
+#endif // INCzmdpThreads_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -38,6 +38,7 @@
 #include "MatrixUtils.h"
 #include "BoundPairExec.h"
 #include "MaxPlanesLowerBound.h"
+#include "BinaryPolicy.h"
 
 using namespace std;
 using namespace MatrixUtils;
@@ -46,7 +47,12 @@ using namespace sla;
 namespace zmdp {
 
 BoundPairExec::BoundPairExec(void) :
-  bounds(NULL)
+  bounds(NULL),
+  actionSelection(BPE_LOOKAHEAD),
+  hybridMargin(0.0),
+  recordLatency(false),
+  numDecisions(0),
+  numLookaheads(0)
 {}
 
 // initializer to use if you already have data structures for the model
@@ -64,29 +70,51 @@ void BoundPairExec::initReadFiles(const std::string& modelFileName,
 				  const ZMDPConfig& config)
 {
   bool useFastModelParser = config.getBool("useFastModelParser");
-  std::string policyType = config.getString("policyType");
   timeval tv1, tv2;
 
   printf("BoundPairExec: reading pomdp model, useFastModelParser=%d\n",
 	 useFastModelParser);
   gettimeofday(&tv1, NULL);
   Pomdp* pomdp = new Pomdp(modelFileName, &config);
-  mdp = pomdp;
   gettimeofday(&tv2, NULL);
   printf("  (took %.3f seconds)\n",
 	 (tv2.tv_sec - tv1.tv_sec) + 1e-6*(tv2.tv_usec - tv1.tv_usec));
 
-  MaxPlanesLowerBound* lb = new MaxPlanesLowerBound(pomdp, &config);
-  printf("BoundPairExec: reading policy of type '%s'\n", policyType.c_str());
+  initReadPolicy(pomdp, policyFileName, config);
+}
+
+// alternate initializer that reads a policy for a model that has
+// already been read
+void BoundPairExec::initReadPolicy(MDP* _mdp,
+				   const std::string& policyFileName,
+				   const ZMDPConfig& config)
+{
+  std::string policyType = config.getString("policyType");
+  timeval tv1, tv2;
+  Pomdp* pomdp = (Pomdp*) _mdp;
+  mdp = _mdp;
+
+  IncrementalLowerBound* lowerBound;
   gettimeofday(&tv1, NULL);
-  if (policyType == "maxPlanes") {
-    lb->readFromFile(policyFileName);
-  } else if (policyType == "cassandraAlpha") {
-    lb->readFromCassandraAlphaFile(policyFileName);
+  if (BinaryPolicy::isBinaryPolicyFile(policyFileName)) {
+    // a binary policy is queried in place, without building planes
+    printf("BoundPairExec: mapping binary policy\n");
+    BinaryPolicyLowerBound* blb = new BinaryPolicyLowerBound(pomdp, &config);
+    blb->readFromFile(policyFileName);
+    lowerBound = blb;
   } else {
-    fprintf(stderr, "ERROR: BoundPairExec: unknown policy type '%s'\n",
-	    policyType.c_str());
-    exit(EXIT_FAILURE);
+    MaxPlanesLowerBound* lb = new MaxPlanesLowerBound(pomdp, &config);
+    printf("BoundPairExec: reading policy of type '%s'\n", policyType.c_str());
+    if (policyType == "maxPlanes") {
+      lb->readFromFile(policyFileName);
+    } else if (policyType == "cassandraAlpha") {
+      lb->readFromCassandraAlphaFile(policyFileName);
+    } else {
+      fprintf(stderr, "ERROR: BoundPairExec: unknown policy type '%s'\n",
+	      policyType.c_str());
+      exit(EXIT_FAILURE);
+    }
+    lowerBound = lb;
   }
   gettimeofday(&tv2, NULL);
   printf("  (took %.3f seconds)\n",
@@ -96,12 +124,32 @@ void BoundPairExec::initReadFiles(const std::string& modelFileName,
 			 /* maintainUpperBound = */ false,
 			 /* useUpperBoundRunTimeActionSelection = */ false,
 			 /* dualPointBounds = */ false);
-  bounds->lowerBound = lb;
+  bounds->lowerBound = lowerBound;
   bounds->initialize(mdp, &config);
 
+  setActionSelection(config);
+
   currentStateInitialized = false;
 }
 
+void BoundPairExec::setActionSelection(const ZMDPConfig& config)
+{
+  std::string selection = config.getString("execActionSelection");
+  if (selection == "lookahead") {
+    actionSelection = BPE_LOOKAHEAD;
+  } else if (selection == "direct") {
+    actionSelection = BPE_DIRECT;
+  } else if (selection == "hybrid") {
+    actionSelection = BPE_HYBRID;
+  } else {
+    fprintf(stderr, "ERROR: unknown execActionSelection '%s' (-h for help)\n",
+	    selection.c_str());
+    exit(EXIT_FAILURE);
+  }
+  hybridMargin = config.getDouble("execHybridMargin");
+  recordLatency = config.getBool("execLatencyHistogram");
+}
+
 void BoundPairExec::setToInitialState(void)
 {
   currentState = mdp->getInitialState();
@@ -110,7 +158,36 @@ void BoundPairExec::setToInitialState(void)
 
 int BoundPairExec::chooseAction(void)
 {
-  return bounds->chooseAction(currentState);
+  double startTime = 0.0;
+  if (recordLatency) {
+    startTime = getMonotonicSeconds();
+  }
+
+  // the direct policy takes the action of the best plane at the current
+  // belief, skipping the |A|*|O| plane queries of one-step lookahead.
+  // the hybrid only trusts it when no plane with a different action is
+  // within hybridMargin of the best one.
+  int a = -1;
+  IncrementalLowerBound* lb = bounds->lowerBound;
+  if (BPE_DIRECT == actionSelection) {
+    a = lb->chooseAction(currentState);
+  } else if (BPE_HYBRID == actionSelection) {
+    double margin = 0.0;
+    a = lb->chooseActionWithMargin(currentState, margin);
+    if (-1 != a && margin < hybridMargin) {
+      a = -1;
+    }
+  }
+  if (-1 == a) {
+    a = bounds->chooseAction(currentState);
+    numLookaheads++;
+  }
+  numDecisions++;
+
+  if (recordLatency) {
+    latency.add(getMonotonicSeconds() - startTime);
+  }
+  return a;
 }
 
 void BoundPairExec::advanceToNextState(int a, int o)
@@ -120,6 +197,40 @@ void BoundPairExec::advanceToNextState(int a, int o)
   currentState = nextState;
 }
 
+MDPExecCore* BoundPairExec::clone(void) const
+{
+  BoundPairExec* result = new BoundPairExec(*this);
+  result->latency.clear();
+  result->numDecisions = 0;
+  result->numLookaheads = 0;
+  return result;
+}
+
+void BoundPairExec::addStats(const MDPExecCore& other)
+{
+  const BoundPairExec& bother = (const BoundPairExec&) other;
+  latency.merge(bother.latency);
+  numDecisions += bother.numDecisions;
+  numLookaheads += bother.numLookaheads;
+}
+
+void BoundPairExec::printStats(std::ostream& out) const
+{
+  if (BPE_HYBRID == actionSelection && numDecisions > 0) {
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+	     "hybrid action selection: %lld of %lld decisions (%.1f%%) used lookahead\n",
+	     numLookaheads, numDecisions, 100.0 * numLookaheads / numDecisions);
+    out << buf;
+  }
+  if (recordLatency) {
+    const char* label = (BPE_DIRECT == actionSelection) ? "direct"
+      : (BPE_HYBRID == actionSelection) ? "hybrid" : "lookahead";
+    std::string fullLabel = std::string("action selection latency (") + label + ")";
+    latency.print(out, fullLabel.c_str());
+  }
+}
+
 void BoundPairExec::setBelief(const belief_vector& b)
 {
   currentState = b;
@@ -35,6 +35,7 @@
 #include "MDPExec.h"
 #include "Pomdp.h"
 #include "BoundPair.h"
+#include "zmdpCommonTime.h"
 
 /**********************************************************************
  * CLASSES
@@ -42,8 +43,24 @@
 
 namespace zmdp {
 
+// how BoundPairExec chooses actions; see execActionSelection in
+// zmdp.config
+enum BoundPairExecSelection {
+  BPE_LOOKAHEAD,
+  BPE_DIRECT,
+  BPE_HYBRID
+};
+
 struct BoundPairExec : public MDPExec {
   BoundPair* bounds;
+  BoundPairExecSelection actionSelection;
+  double hybridMargin;
+  bool recordLatency;
+
+  // decision statistics, collected if recordLatency is set
+  LatencyHistogram latency;
+  long long numDecisions;
+  long long numLookaheads;
 
   BoundPairExec(void);
 
@@ -56,10 +73,25 @@ struct BoundPairExec : public MDPExec {
 		     const std::string& policyFileName,
 		     const ZMDPConfig& config);
 
+  // alternate initializer that reads a policy for a model that has
+  // already been read
+  void initReadPolicy(MDP* _mdp,
+		      const std::string& policyFileName,
+		      const ZMDPConfig& config);
+
+  // reads execActionSelection, execHybridMargin and
+  // execLatencyHistogram.  initReadPolicy() calls this; otherwise the
+  // exec always uses one-step lookahead.
+  void setActionSelection(const ZMDPConfig& config);
+
   // implement MDPExec virtual methods
   void setToInitialState(void);
   int chooseAction(void);
   void advanceToNextState(int a, int o);
+  // the clone shares the model and bounds, which are only read
+  MDPExecCore* clone(void) const;
+  void addStats(const MDPExecCore& other);
+  void printStats(std::ostream& out) const;
 
   // can use for finer control
   void setBelief(const belief_vector& b);
@@ -27,6 +27,8 @@
  * INCLUDES
  **********************************************************************/
 
+#include <iostream>
+
 #include "MDPModel.h"
 
 /**********************************************************************
@@ -41,6 +43,17 @@ struct MDPExecCore {
   virtual void setToInitialState(void) = 0;
   virtual int chooseAction(void) = 0;
   virtual void advanceToNextState(int a, int o) = 0;
+
+  // Returns a new exec that follows the same policy and can be used in
+  // another thread while this one is in use, or NULL if cloning is not
+  // supported.  The caller owns the result.
+  virtual MDPExecCore* clone(void) const { return NULL; }
+
+  // execs that collect statistics on their decisions (such as action
+  // selection latency) can print them here.  addStats() folds in the
+  // statistics of a clone of this exec.
+  virtual void addStats(const MDPExecCore& other) {}
+  virtual void printStats(std::ostream& out) const {}
 };
 
 // MDPExec adds some default class members to MDPExecCore,
@@ -31,9 +31,13 @@
 #include <assert.h>
 #include <sys/time.h>
 #include <limits.h>
+#include <math.h>
+#include <errno.h>
+#include <string.h>
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTime.h"
@@ -46,8 +50,45 @@ using namespace std;
 using namespace MatrixUtils;
 using namespace sla;
 
+// in adaptive mode (evaluationConfidenceWidth > 0), trials are divided
+// into up to this many batches
+#define PE_ADAPTIVE_MAX_BATCHES (300)
+// the confidence interval is checked after each round of this many
+// batches, starting when at least PE_ADAPTIVE_MIN_BATCHES are done
+#define PE_ADAPTIVE_BATCHES_PER_ROUND (10)
+#define PE_ADAPTIVE_MIN_BATCHES (10)
+
+// with no step limit, exact evaluation iterates until the value and
+// success probability change by less than this much
+#define PE_EXACT_RESIDUAL (1e-10)
+#define PE_EXACT_MAX_ITERATIONS (100000)
+
 namespace zmdp {
 
+// one batch of simulation trials.  trace and score output is buffered
+// so it can be written in batch order after the batches are done.
+struct PEBatch {
+  bool done;
+  int firstTrial;
+  int numTrials;
+  int numTracesToLog;
+  RandomStream rng;
+  dvector rewards;
+  double successRate;
+  std::ostringstream traceOut;
+  std::ostringstream scoresOut;
+};
+
+// per-thread evaluation state
+struct PEWorker {
+  PolicyEvaluator* evaluator;
+  MDPExecCore* exec;
+  MDPSim* sim;
+  CacheMDP* modelCache;
+
+  PEWorker(void) : evaluator(NULL), exec(NULL), sim(NULL), modelCache(NULL) {}
+};
+
 PolicyEvaluator::PolicyEvaluator(MDP* _simModel,
 				 MDPExecCore* _exec,
 				 const ZMDPConfig* _config,
@@ -56,15 +97,15 @@ PolicyEvaluator::PolicyEvaluator(MDP* _simModel,
   exec(_exec),
   config(_config),
   assumeIdenticalModels(_assumeIdenticalModels),
-  sim(NULL),
   simOutFile(NULL),
-  scoresOutFile(NULL),
-  modelCache(NULL)
-{}
+  scoresOutFile(NULL)
+{
+  numTrialsUsed = 0;
+}
 
 void PolicyEvaluator::getRewardSamples(dvector& rewards, double& successRate, bool _verbose)
 {
-  timeval startTime = getTime();
+  startTime = getTime();
 
   verbose = _verbose;
 
@@ -77,6 +118,30 @@ void PolicyEvaluator::getRewardSamples(dvector& rewards, double& successRate, bo
   if (simulationTracesToLogPerEpoch < 0) {
     simulationTracesToLogPerEpoch = INT_MAX;
   }
+  int numEvaluationThreads = std::max(1, config->getInt("numEvaluationThreads"));
+  evaluationConfidenceWidth = config->getDouble("evaluationConfidenceWidth");
+  evaluationMaxWallclockSeconds = config->getDouble("evaluationMaxWallclockSeconds");
+  useExactEvaluation = config->getBool("useExactEvaluation");
+  exactEvaluationMaxNodes = config->getInt("exactEvaluationMaxNodes");
+
+  if (useExactEvaluation) {
+    if (!assumeIdenticalModels) {
+      // the policy's action must be a function of the simulator state
+      fprintf(stderr, "WARNING: useExactEvaluation requires identical planning and simulation models; "
+	      "using simulation\n");
+    } else if (evaluateExact(rewards, successRate)) {
+      return;
+    }
+  }
+
+  seed = (unsigned int) config->getInt("evaluationRandomSeed");
+  if (0 == seed) {
+    timeval now = getTime();
+    seed = (((unsigned long long) now.tv_sec) << 20) ^ now.tv_usec ^ getpid();
+  }
+  if (zmdpDebugLevelG >= 1) {
+    printf("policy evaluation random seed: %llu\n", seed);
+  }
 
   simOutFile = new ofstream(simulationTraceOutputFile.c_str());
   if (! (*simOutFile)) {
@@ -95,23 +160,116 @@ void PolicyEvaluator::getRewardSamples(dvector& rewards, double& successRate, bo
   }
     
   // parameter 30 is arbitrary, trying to guarantee valid statistics
-  int numBatches = std::min(evaluationTrialsPerEpoch, 30);
-  int numTrialsPerBatch = evaluationTrialsPerEpoch / numBatches;
+  int maxBatches = std::min(evaluationTrialsPerEpoch, 30);
+  int batchesPerRound = maxBatches;
+  if (evaluationConfidenceWidth > 0) {
+    // adaptive mode: smaller batches, checked a round at a time
+    maxBatches = std::min(evaluationTrialsPerEpoch, PE_ADAPTIVE_MAX_BATCHES);
+    batchesPerRound = PE_ADAPTIVE_BATCHES_PER_ROUND;
+  }
+  int numTrialsPerBatch = evaluationTrialsPerEpoch / maxBatches;
+
+  // each trial draws from its own random number stream (see
+  // startTrial()), so the results do not depend on which thread runs
+  // it, and evaluations of different policies with the same seed use
+  // common random numbers
+  batches.resize(maxBatches);
+  for (int i=0; i < maxBatches; i++) {
+    PEBatch* batch = new PEBatch();
+    batch->firstTrial = i*numTrialsPerBatch;
+    batch->numTrials = numTrialsPerBatch;
+    batch->numTracesToLog = std::max(0, simulationTracesToLogPerEpoch - batch->firstTrial);
+    batch->done = false;
+    batches[i] = batch;
+  }
+  nextBatch = 0;
+  batchLimit = 0;
+  outOfTime = false;
+
+  // each thread needs its own copy of the exec
+  int numThreads = std::min(numEvaluationThreads, maxBatches);
+  std::vector<PEWorker> workers(numThreads);
+  workers[0].exec = exec;
+  for (int t=1; t < numThreads; t++) {
+    workers[t].exec = exec->clone();
+    if (NULL == workers[t].exec) {
+      fprintf(stderr, "WARNING: this policy type does not support numEvaluationThreads > 1; "
+	      "using 1 thread\n");
+      for (int u=1; u < t; u++) {
+	delete workers[u].exec;
+      }
+      numThreads = 1;
+      break;
+    }
+  }
+  workers.resize(numThreads);
+  FOR (t, numThreads) {
+    workers[t].evaluator = this;
+  }
 
-  rewards.resize(numBatches);
-  double successRateSum = 0.0;
-  int startTrialIndex = 0;
-  for (int i=0; i < numBatches; i++) {
-    dvector batchRewards;
-    double batchSuccessRate;
-    doBatch(batchRewards, batchSuccessRate, numTrialsPerBatch,
-	    std::max(0, simulationTracesToLogPerEpoch - startTrialIndex));
-    rewards(i) = sum(batchRewards) / numTrialsPerBatch;
-    successRateSum += batchSuccessRate;
-    startTrialIndex += numTrialsPerBatch;
+  // run rounds of batches until the confidence interval is narrow
+  // enough, time runs out, or all batches are done
+  std::vector<pthread_t> threads(numThreads);
+  int numDone = 0;
+  double mean, quantile1, quantile2;
+  double ciWidth = -1;
+  bool reachedTargetWidth = false;
+  while (1) {
+    batchLimit = std::min(maxBatches, batchLimit + batchesPerRound);
+    for (int t=1; t < numThreads; t++) {
+      if (0 != pthread_create(&threads[t], NULL, &workerMain, &workers[t])) {
+	fprintf(stderr, "ERROR: couldn't create evaluation thread %d\n", (int) t);
+	exit(EXIT_FAILURE);
+      }
+    }
+    runWorker(workers[0]);
+    for (int t=1; t < numThreads; t++) {
+      pthread_join(threads[t], NULL);
+    }
+
+    numDone = 0;
+    FOR (i, maxBatches) {
+      if (batches[i]->done) numDone++;
+    }
+    if (outOfTime || batchLimit == maxBatches) break;
+
+    if (numDone >= PE_ADAPTIVE_MIN_BATCHES) {
+      // the bootstrap draws from a stream seeded by the round, so the
+      // stopping decision is reproducible
+      dvector batchMeans(numDone);
+      FOR (i, numDone) {
+	batchMeans(i) = sum(batches[i]->rewards) / numTrialsPerBatch;
+      }
+      RandomStream bootstrapRng(RandomStream::deriveSeed(~seed, batchLimit));
+      setThreadRandomStream(&bootstrapRng);
+      calc_bootstrap_mean_quantile(batchMeans, 0.05, mean, quantile1, quantile2);
+      setThreadRandomStream(NULL);
+      ciWidth = quantile2 - quantile1;
+      if (ciWidth <= evaluationConfidenceWidth) {
+	reachedTargetWidth = true;
+	break;
+      }
+    }
   }
   printf("\n");
 
+  // batches that were not started (because time ran out) are skipped
+  rewards.resize(numDone);
+  double successRateSum = 0.0;
+  int j = 0;
+  for (int i=0; i < maxBatches; i++) {
+    PEBatch& batch = *batches[i];
+    if (!batch.done) continue;
+    rewards(j++) = sum(batch.rewards) / numTrialsPerBatch;
+    successRateSum += batch.successRate;
+    (*simOutFile) << batch.traceOut.str();
+    if (verbose) {
+      (*scoresOutFile) << batch.scoresOut.str();
+    }
+  }
+  int numBatches = numDone;
+  numTrialsUsed = numDone * numTrialsPerBatch;
+
   printf("batchRewards: ");
   for (int i=0; i < numBatches; i++) {
     printf("%.4lf ", rewards(i));
@@ -125,22 +283,228 @@ void PolicyEvaluator::getRewardSamples(dvector& rewards, double& successRate, bo
 
   DELETE_AND_NULL(simOutFile);
   DELETE_AND_NULL(scoresOutFile);
-  DELETE_AND_NULL(sim);
-  DELETE_AND_NULL(modelCache);
+  FOR (t, numThreads) {
+    if (t > 0) {
+      exec->addStats(*workers[t].exec);
+      DELETE_AND_NULL(workers[t].exec);
+    }
+    DELETE_AND_NULL(workers[t].sim);
+    DELETE_AND_NULL(workers[t].modelCache);
+  }
+  FOR (i, maxBatches) {
+    DELETE_AND_NULL(batches[i]);
+  }
+  batches.clear();
+
+  if (evaluationConfidenceWidth > 0 || evaluationMaxWallclockSeconds > 0) {
+    printf("(policy evaluation used %d trials in %d batches", numTrialsUsed, numBatches);
+    if (reachedTargetWidth) {
+      printf(", confidence interval width %.4lf", ciWidth);
+    } else if (outOfTime) {
+      printf(", stopped at evaluationMaxWallclockSeconds");
+    }
+    printf(")\n");
+  }
+  printf("(policy evaluation took %.3lf seconds, %d thread%s)\n",
+	 timevalToSeconds(getTime() - startTime),
+	 numThreads, (numThreads > 1) ? "s" : "");
+}
+
+// one transition of the policy's Markov chain, stored in CSR form
+struct PEExactEdge {
+  int nextIndex; // -1 if nextState is terminal or never expanded
+  bool nextIsTerminal;
+  double prob;
+};
+
+// Expands the graph of states the policy can reach from the initial
+// state within evaluationMaxStepsPerTrial steps, merging states with
+// the same StateKey, then computes the expected discounted reward and
+// probability of termination of a trial by iterating over the graph.
+// With a step limit H, exactly H iterations give the same quantities
+// the simulation trials estimate; with no limit, the iteration runs to
+// convergence.  Returns false (and does no evaluation) if the graph
+// grows past exactEvaluationMaxNodes.
+bool PolicyEvaluator::evaluateExact(dvector& rewards, double& successRate)
+{
+  int maxDepth = evaluationMaxStepsPerTrial;
+  MDPExec* mexec = dynamic_cast<MDPExec*>(exec);
+  if (NULL == mexec) {
+    // the policy's state must be settable to each node of the graph
+    fprintf(stderr, "WARNING: useExactEvaluation does not support this policy type; "
+	    "using simulation\n");
+    return false;
+  }
+  if (maxDepth <= 0 && simModel->getDiscount() >= 1.0) {
+    // with no discounting, iteration on an unbounded horizon may never
+    // converge (and each iteration can touch exactEvaluationMaxNodes states)
+    fprintf(stderr, "WARNING: useExactEvaluation with discount 1 requires a positive "
+	    "evaluationMaxStepsPerTrial; using simulation\n");
+    return false;
+  }
+  CacheMDP graph(simModel);
+
+  // nodes are appended to the node table as they are discovered, so
+  // walking the table in order is a breadth-first search, and each
+  // node's depth is the fewest steps needed to reach it
+  std::vector<int> depth(1, 0);
+  std::vector<int> expandedIndex;
+  std::vector<CMDPNode*> expanded;
+  for (int si=0; si < (int)graph.nodeTable.size(); si++) {
+    CMDPNode* cn = graph.nodeTable[si];
+    expandedIndex.push_back(-1);
+    // like the simulator, always take an action in the initial state
+    if ((cn->isTerminal && si > 0)
+	|| (maxDepth > 0 && depth[si] >= maxDepth)) {
+      continue;
+    }
+    mexec->currentState = cn->s;
+    cn->userInt = mexec->chooseAction();
+    graph.getQ(*cn, cn->userInt);
+    expandedIndex[si] = expanded.size();
+    expanded.push_back(cn);
+    while (depth.size() < graph.nodeTable.size()) {
+      depth.push_back(depth[si] + 1);
+    }
+    if ((int)graph.nodeTable.size() > exactEvaluationMaxNodes) {
+      fprintf(stderr, "WARNING: policy reaches more than exactEvaluationMaxNodes=%d states; "
+	      "using simulation\n", exactEvaluationMaxNodes);
+      return false;
+    }
+  }
+
+  // flatten the expanded part of the graph
+  int numNodes = expanded.size();
+  std::vector<int> edgeStart(numNodes+1);
+  std::vector<PEExactEdge> edges;
+  dvector immediateReward(numNodes);
+  FOR (i, numNodes) {
+    CMDPNode* cn = expanded[i];
+    CMDPQEntry* Qa = cn->Q[cn->userInt];
+    edgeStart[i] = edges.size();
+    immediateReward(i) = Qa->immediateReward;
+    FOR (o, Qa->getNumOutcomes()) {
+      CMDPEdge* e = Qa->outcomes[o];
+      if (NULL == e) continue;
+      PEExactEdge ee;
+      ee.nextIsTerminal = e->nextState->isTerminal;
+      ee.nextIndex = ee.nextIsTerminal ? -1 : expandedIndex[e->nextState->si];
+      ee.prob = Qa->opv(o);
+      edges.push_back(ee);
+    }
+  }
+  edgeStart[numNodes] = edges.size();
+
+  // after k iterations, value(i) and success(i) are the expected
+  // discounted reward and termination probability of a trial that
+  // starts at expanded[i] and runs for at most k steps
+  double discount = simModel->getDiscount();
+  dvector value(numNodes), success(numNodes);
+  dvector nextValue(numNodes), nextSuccess(numNodes);
+  int numIterations = 0;
+  double residual = 0.0;
+  while (1) {
+    if (maxDepth > 0 && numIterations == maxDepth) break;
+    residual = 0.0;
+    FOR (i, numNodes) {
+      double v = 0.0, p = 0.0;
+      for (int k=edgeStart[i]; k < edgeStart[i+1]; k++) {
+	const PEExactEdge& ee = edges[k];
+	if (ee.nextIsTerminal) {
+	  p += ee.prob;
+	} else if (-1 != ee.nextIndex) {
+	  v += ee.prob * value(ee.nextIndex);
+	  p += ee.prob * success(ee.nextIndex);
+	}
+      }
+      nextValue(i) = immediateReward(i) + discount * v;
+      nextSuccess(i) = p;
+      residual = std::max(residual, fabs(nextValue(i) - value(i)));
+      residual = std::max(residual, fabs(nextSuccess(i) - success(i)));
+    }
+    value.data.swap(nextValue.data);
+    success.data.swap(nextSuccess.data);
+    numIterations++;
+    if (maxDepth <= 0
+	&& (residual < PE_EXACT_RESIDUAL || numIterations == PE_EXACT_MAX_ITERATIONS)) {
+      if (residual >= PE_EXACT_RESIDUAL) {
+	fprintf(stderr, "WARNING: exact policy evaluation did not converge after %d iterations "
+		"(residual=%g)\n", numIterations, residual);
+      }
+      break;
+    }
+  }
+
+  // the initial state is always expanded, at index 0
+  rewards.resize(1);
+  rewards(0) = value(0);
+  successRate = success(0);
+  numTrialsUsed = 0;
 
-  printf("(policy evaluation took %.3lf seconds)\n",
+  printf("batchRewards: %.4lf \n", rewards(0));
+  if (verbose) {
+    scoresOutFile = new ofstream(scoresOutputFile.c_str());
+    if (!(*scoresOutFile)) {
+      fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
+	      scoresOutputFile.c_str(), strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    (*scoresOutFile) << value(0) << endl;
+    delete scoresOutFile;
+    scoresOutFile = NULL;
+  }
+  printf("(exact policy evaluation: %d states, %d expanded, %d transitions, %d iterations, "
+	 "took %.3lf seconds)\n",
+	 (int) graph.nodeTable.size(), numNodes, (int) edges.size(), numIterations,
 	 timevalToSeconds(getTime() - startTime));
+
+  return true;
 }
 
-void PolicyEvaluator::doBatch(dvector& rewards,
-			      double& successRate,
-			      int numTrials,
-			      int numTracesToLog)
+void PolicyEvaluator::runWorker(PEWorker& w)
+{
+  while (1) {
+    int i;
+    {
+      ZMDPMutexGuard g(batchLock);
+      if (nextBatch >= batchLimit || outOfTime) break;
+      // always run at least one batch
+      if (evaluationMaxWallclockSeconds > 0 && nextBatch > 0
+	  && timevalToSeconds(getTime() - startTime) > evaluationMaxWallclockSeconds) {
+	outOfTime = true;
+	break;
+      }
+      i = nextBatch++;
+    }
+
+    PEBatch& batch = *batches[i];
+    setThreadRandomStream(&batch.rng);
+    doBatch(w, batch);
+    setThreadRandomStream(NULL);
+    batch.done = true;
+  }
+}
+
+void* PolicyEvaluator::workerMain(void* arg)
+{
+  PEWorker* w = (PEWorker*) arg;
+  w->evaluator->runWorker(*w);
+  return NULL;
+}
+
+// the j'th random draw of trial i is the same no matter which policy is
+// evaluated, how the trials are batched, or which thread runs them
+void PolicyEvaluator::startTrial(PEBatch& batch, int i)
+{
+  batch.rng = RandomStream(RandomStream::deriveSeed(seed, batch.firstTrial + i));
+}
+
+void PolicyEvaluator::doBatch(PEWorker& w, PEBatch& batch)
 {
   if (useEvaluationCache) {
-    doBatchCache(rewards, successRate, numTrials, numTracesToLog);
+    doBatchCache(w, batch);
   } else {
-    doBatchSimple(rewards, successRate, numTrials, numTracesToLog);
+    doBatchSimple(w, batch);
   }
 }
 
@@ -157,16 +521,16 @@ struct PESimLogEntry {
 
 typedef std::vector<PESimLogEntry> PESimLog;
 
-void PolicyEvaluator::doBatchCache(dvector& rewards,
-				   double& successRate,
-				   int numTrials,
-				   int numTracesToLog)
+void PolicyEvaluator::doBatchCache(PEWorker& w, PEBatch& batch)
 {
-  if (NULL == modelCache) {
-    modelCache = new CacheMDP(simModel);
+  if (NULL == w.modelCache) {
+    w.modelCache = new CacheMDP(simModel);
   }
+  CacheMDP* modelCache = w.modelCache;
+  MDPExecCore* exec = w.exec;
+  int numTrials = batch.numTrials;
     
-  ofstream* simOutFileTmp = simOutFile;
+  std::ostream* simOutFileTmp = &batch.traceOut;
 
   // pass 0: clear old count data if any
   for (int si=0; si < (int)modelCache->nodeTable.size(); si++) {
@@ -188,13 +552,14 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
   std::vector<PESimLog> trials(numTrials);
   int numTrialsReachedGoal = 0;
   for (int i=0; i < numTrials; i++) {
-    if (i >= numTracesToLog) {
+    if (i >= batch.numTracesToLog) {
       simOutFileTmp = NULL; // stop logging
     }
       
     if (simOutFileTmp) {
       (*simOutFileTmp) << ">>> begin" << endl;
     }
+    startTrial(batch, i);
     exec->setToInitialState();
     CMDPNode* simState = modelCache->root;
     CMDPQEntry* Qa = NULL;
@@ -294,6 +659,7 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
   }
 
   // pass 3: go back through logs and perform reweighting
+  dvector& rewards = batch.rewards;
   rewards.resize(numTrials);
   double batchSumReward = 0.0;
   for (int i=0; i < numTrials; i++) {
@@ -311,30 +677,34 @@ void PolicyEvaluator::doBatchCache(dvector& rewards,
   }
 
   if (verbose) {
-    (*scoresOutFile) << batchSumReward/numTrials << endl;
+    batch.scoresOut << batchSumReward/numTrials << endl;
   }
 
-  successRate = ((double) numTrialsReachedGoal) / numTrials;
+  batch.successRate = ((double) numTrialsReachedGoal) / numTrials;
 }
 
-void PolicyEvaluator::doBatchSimple(dvector& rewards,
-				    double& successRate,
-				    int numTrials,
-				    int numTracesToLog)
+void PolicyEvaluator::doBatchSimple(PEWorker& w, PEBatch& batch)
 {
-  sim = new MDPSim(simModel);
+  if (NULL == w.sim) {
+    w.sim = new MDPSim(simModel);
+  }
+  MDPSim* sim = w.sim;
+  MDPExecCore* exec = w.exec;
+  int numTrials = batch.numTrials;
     
-  sim->simOutFile = simOutFile;
+  sim->simOutFile = &batch.traceOut;
     
   int numTrialsReachedGoal = 0;
     
   // do evaluation
+  dvector& rewards = batch.rewards;
   rewards.resize(numTrials);
   for (int i=0; i < numTrials; i++) {
-    if (i >= numTracesToLog) {
+    if (i >= batch.numTracesToLog) {
       sim->simOutFile = NULL; // stop logging
     }
       
+    startTrial(batch, i);
     sim->restart();
     exec->setToInitialState();
     for (int j=0; (j < evaluationMaxStepsPerTrial) || (0 == evaluationMaxStepsPerTrial);
@@ -353,7 +723,7 @@ void PolicyEvaluator::doBatchSimple(dvector& rewards,
     }
     rewards(i) = sim->rewardSoFar;
     if (verbose) {
-      (*scoresOutFile) << sim->rewardSoFar << endl;
+      batch.scoresOut << sim->rewardSoFar << endl;
       if (i%10 == 9) {
 	printf(".");
 	fflush(stdout);
@@ -365,7 +735,7 @@ void PolicyEvaluator::doBatchSimple(dvector& rewards,
     fflush(stdout);
   }
 
-  successRate = ((double) numTrialsReachedGoal) / numTrials;
+  batch.successRate = ((double) numTrialsReachedGoal) / numTrials;
 }
 
 }; // namespace zmdp
@@ -23,12 +23,18 @@
 #ifndef INCPolicyEvaluator_h
 #define INCPolicyEvaluator_h
 
+#include <sys/time.h>
+
 #include "MDPExec.h"
 #include "MDPSim.h"
 #include "CacheMDP.h"
+#include "zmdpThreads.h"
 
 namespace zmdp {
 
+struct PEBatch;
+struct PEWorker;
+
 struct PolicyEvaluator {
   PolicyEvaluator(MDP* _simModel,
 		  MDPExecCore* _exec,
@@ -36,6 +42,9 @@ struct PolicyEvaluator {
 		  bool _assumeIdenticalModels);
   void getRewardSamples(dvector& rewards, double& successRate, bool _verbose);
 
+  // number of trials run by the last call to getRewardSamples()
+  int numTrialsUsed;
+
 protected:
   MDP* simModel;
   MDP* planningModel;
@@ -43,23 +52,38 @@ protected:
   const ZMDPConfig* config;
   bool assumeIdenticalModels;
   bool useEvaluationCache;
+  bool useExactEvaluation;
+  int exactEvaluationMaxNodes;
   int evaluationTrialsPerEpoch;
   int evaluationMaxStepsPerTrial;
   std::string scoresOutputFile;
   std::string simulationTraceOutputFile;
   int simulationTracesToLogPerEpoch;
-  MDPSim* sim;
+  double evaluationConfidenceWidth;
+  double evaluationMaxWallclockSeconds;
+  unsigned long long seed;
   std::ofstream* simOutFile;
   std::ofstream* scoresOutFile;
   bool verbose;
-  CacheMDP* modelCache;
-
-  void doBatch(dvector& rewards, double& successRate, int numTrials,
-	       int numTracesToLog);
-  void doBatchCache(dvector& rewards, double& successRate, int numTrials,
-		    int numTracesToLog);
-  void doBatchSimple(dvector& rewards, double& successRate, int numTrials,
-		     int numTracesToLog);
+
+  // batches are handed out to worker threads in order
+  std::vector<PEBatch*> batches;
+  int nextBatch;
+  // batches up to batchLimit are handed out in the current round
+  int batchLimit;
+  bool outOfTime;
+  timeval startTime;
+  ZMDPMutex batchLock;
+
+  // prints a warning and returns false if the policy can't be evaluated
+  // exactly, in which case the caller falls back to simulation
+  bool evaluateExact(dvector& rewards, double& successRate);
+  void runWorker(PEWorker& w);
+  static void* workerMain(void* arg);
+  void startTrial(PEBatch& batch, int i);
+  void doBatch(PEWorker& w, PEBatch& batch);
+  void doBatchCache(PEWorker& w, PEBatch& batch);
+  void doBatchSimple(PEWorker& w, PEBatch& batch);
 };
 
 }; // namespace zmdp
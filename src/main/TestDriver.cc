@@ -39,12 +39,33 @@
 #include "MatrixUtils.h"
 #include "BoundPairExec.h"
 #include "PolicyEvaluator.h"
+#include "PolicyLog.h"
 
 using namespace std;
 using namespace MatrixUtils;
 
 namespace zmdp {
 
+// writes the policy to a temporary file and renames it into place, so
+// an interrupted write never leaves a partial policy behind
+static void writePolicyAtomically(SolverObjects& so, const char* outPolicyFileName)
+{
+  // the temporary file keeps the extension, which selects the format
+  string outFile = outPolicyFileName;
+  size_t dot = outFile.rfind('.');
+  if (string::npos == dot || string::npos != outFile.find('/', dot)) {
+    dot = outFile.size();
+  }
+  string tmpFile = outFile.substr(0, dot) + ".tmp" + outFile.substr(dot);
+
+  so.bounds->writePolicy(tmpFile, /* canModifyBounds = */ false);
+  if (0 != rename(tmpFile.c_str(), outFile.c_str())) {
+    cerr << "ERROR: couldn't rename " << tmpFile << " to " << outFile
+	 << ": " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
 void TestDriver::batchTestIncremental(const ZMDPConfig& config,
 				      int numIterations,
 				      SolverObjects& so,
@@ -56,7 +77,8 @@ void TestDriver::batchTestIncremental(const ZMDPConfig& config,
 				      const string& incPlotFileName,
 				      const string& boundsFileName,
 				      const string& simFileName,
-				      const char* outPolicyFileName)
+				      const char* outPolicyFileName,
+				      const char* policyCheckpointLogName)
 {
   belief_vector last_belief, diff;
 
@@ -100,6 +122,14 @@ void TestDriver::batchTestIncremental(const ZMDPConfig& config,
     }
   }
 
+  // with a checkpoint log, each epoch appends the changes to the policy
+  // to the log in the background, and the full policy is written only
+  // once, at the end of the run
+  PolicyLogWriter* policyLog = NULL;
+  if (NULL != policyCheckpointLogName) {
+    policyLog = new PolicyLogWriter(policyCheckpointLogName);
+  }
+
   double terminateLowerBoundValue = config.getDouble("terminateLowerBoundValue");
   double terminateUpperBoundValue = config.getDouble("terminateUpperBoundValue");
 
@@ -156,17 +186,10 @@ void TestDriver::batchTestIncremental(const ZMDPConfig& config,
       logLastSimTime = ::log(timeSoFar);
 
       // write output policy at each evaluation epoch if that was requested
-      if (NULL != outPolicyFileName) {
-	// create a backup of the policy from the last epoch in case policy
-	// writing is interrupted
-	string cmd = string("mv ") + outPolicyFileName + " " + outPolicyFileName + ".bak >& /dev/null";
-	system(cmd.c_str());
-
-	so.bounds->writePolicy(outPolicyFileName, /* canModifyBounds = */ false);
-
-	// delete the backup
-	cmd = string("rm -f ") + outPolicyFileName + ".bak >& /dev/null";
-	system(cmd.c_str());
+      if (NULL != policyLog) {
+	so.bounds->writePolicyCheckpoint(*policyLog, timeSoFar);
+      } else if (NULL != outPolicyFileName) {
+	writePolicyAtomically(so, outPolicyFileName);
       }
 
       // simulate running the policy many times and collect the per-run total reward values
@@ -223,20 +246,36 @@ void TestDriver::batchTestIncremental(const ZMDPConfig& config,
 	}
 
 	int totalEntries = lbNumEntries1 + lbNumEntries2 + ubNumEntries1 + ubNumEntries2;
+
+	// memory used by the search graph, shared by both bounds
+	int nodeCacheKBytes = 0;
+	if (NULL != so.bounds->lookup) {
+	  nodeCacheKBytes = getNodeCacheStorage(so.bounds->lookup, so.bounds->nodeStore,
+						ZMDP_S_NUM_KBYTES_TABULAR);
+	}
 	
 	snprintf(sbuf, sizeof(sbuf),
-		 "%10lf %10d %10d %10d %10d %10d %10d %10d %10d %10d",
+		 "%10lf %10d %10d %10d %10d %10d %10d %10d %10d %10d %10d",
 		 timeSoFar, totalEntries,
 		 lbNumElts1, lbNumEntries1,
 		 lbNumElts2, lbNumEntries2,
 		 ubNumElts1, ubNumEntries1,
-		 ubNumElts2, ubNumEntries2);
+		 ubNumElts2, ubNumEntries2,
+		 nodeCacheKBytes);
 
 	(*storageOutputFile) << sbuf << endl;
 	storageOutputFile->flush();
       }
     }
   }
+  if (NULL != policyLog) {
+    // waits for the last checkpoint to be written
+    delete policyLog;
+    if (NULL != outPolicyFileName) {
+      writePolicyAtomically(so, outPolicyFileName);
+    }
+  }
+
   incPlotFile.close();
   boundsFile.close();
   simOutFile.close();
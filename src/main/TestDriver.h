@@ -52,7 +52,8 @@ public:
 			    const std::string& incPlotFileName,
 			    const std::string& boundsFileName,
 			    const std::string& simFileName,
-			    const char* outPolicyFileName);
+			    const char* outPolicyFileName,
+			    const char* policyCheckpointLogName);
 
 };
 
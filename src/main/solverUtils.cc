@@ -149,6 +149,7 @@ void SolverParams::setValues(const ZMDPConfig& config)
   // set global debug level, used by parts of the codebase that do not
   // depend on ZMDPConfig
   zmdpDebugLevelG = config.getInt("debugLevel");
+  zmdpUseFingerprintStateKeysG = config.getBool("useFingerprintStateKeys");
 
   if (zmdpDebugLevelG >= 1) {
     cout << "[params begin]" << endl;
@@ -164,6 +165,10 @@ void SolverParams::setValues(const ZMDPConfig& config)
   SU_GET_BOOL(maintainUpperBound);
 
   SU_GET_STRING(policyOutputFile);
+  SU_GET_STRING(policyCheckpointLog);
+  SU_GET_STRING(upperBoundOutputFile);
+  SU_GET_STRING(solverCheckpointFile);
+  SU_GET_DOUBLE(solverCheckpointIntervalSeconds);
 
   SU_GET_BOOL(useFastModelParser);
   SU_GET_DOUBLE(terminateRegretBound);
@@ -200,12 +205,14 @@ void SolverParams::inferMissingValues(void)
 {
   // fill in default and inferred values
   if (-1 == modelType) {
-    if (endsWith(probName, ".pomdp")) {
+    if (endsWith(probName, ".pomdp") || endsWith(probName, ".pomdpb")
+	|| endsWith(probName, ".pomdp.gz")) {
       if (zmdpDebugLevelG >= 1) {
 	printf("[params] inferred modelType='pomdp' from model filename extension\n");
       }
       modelType = T_POMDP;
-    } else if (endsWith(probName, ".mdp")) {
+    } else if (endsWith(probName, ".mdp") || endsWith(probName, ".mdpb")
+	       || endsWith(probName, ".mdp.gz")) {
       if (zmdpDebugLevelG >= 1) {
 	printf("[params] inferred modelType='mdp' from model filename extension\n");
       }
@@ -220,6 +227,9 @@ void SolverParams::inferMissingValues(void)
 	printf("[params] inferred modelType='custom' from model filename\n");
       }
       modelType = T_CUSTOM;
+    } else if (0 == strcmp(probName, "-")) {
+      fprintf(stderr, "ERROR: specify --modelType when reading the model from standard input (-h for help)\n");
+      exit(EXIT_FAILURE);
     } else {
       fprintf(stderr, "ERROR: couldn't infer problem type from model filename %s (use -t option, -h for help)\n",
 	      probName);
@@ -266,6 +276,15 @@ void SolverParams::inferMissingValues(void)
   if (NULL != policyOutputFile && 0 == strcmp(policyOutputFile, "none")) {
     policyOutputFile = NULL;
   }
+  if (0 == strcmp(policyCheckpointLog, "none")) {
+    policyCheckpointLog = NULL;
+  }
+  if (0 == strcmp(upperBoundOutputFile, "none")) {
+    upperBoundOutputFile = NULL;
+  }
+  if (0 == strcmp(solverCheckpointFile, "none")) {
+    solverCheckpointFile = NULL;
+  }
   if (NULL != policyOutputFile && 0 == strcmp(policyOutputFile, "-")) {
     if (usingBenchmarkFrontEnd) {
       policyOutputFile = NULL;
@@ -421,6 +440,24 @@ void constructSolverObjects(SolverObjects& obj,
       p.policyOutputFile = NULL;
     }
   }
+  if (NULL != p.policyCheckpointLog) {
+    if (! (p.maintainLowerBound && (p.lowerBoundRepresentation == V_MAXPLANES))) {
+      cerr << "WARNING: policyCheckpointLog is only supported when modelType='pomdp',\n"
+	   << "  lowerBoundRepresentation='maxPlanes', and lower bound is maintained;\n"
+	   << "  disabling the policy checkpoint log on this run"
+	   << endl;
+      p.policyCheckpointLog = NULL;
+    }
+  }
+  if (NULL != p.upperBoundOutputFile) {
+    if (! (p.maintainUpperBound && (p.upperBoundRepresentation == V_SAWTOOTH))) {
+      cerr << "WARNING: upperBoundOutputFile is only supported when modelType='pomdp',\n"
+	   << "  upperBoundRepresentation='sawtooth', and upper bound is maintained;\n"
+	   << "  disabling upper bound output on this run"
+	   << endl;
+      p.upperBoundOutputFile = NULL;
+    }
+  }
 
   bool dualPointBounds =
     p.maintainLowerBound && p.maintainUpperBound &&
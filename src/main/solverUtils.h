@@ -54,6 +54,9 @@
 
 namespace zmdp {
 
+bool endsWith(const std::string& s,
+	      const std::string& suffix);
+
 struct EnumEntry {
   const char* key;
   int val;
@@ -93,6 +96,10 @@ struct SolverParams {
   int maintainLowerBound;
   bool maintainUpperBound;
   const char* policyOutputFile;
+  const char* policyCheckpointLog;
+  const char* upperBoundOutputFile;
+  const char* solverCheckpointFile;
+  double solverCheckpointIntervalSeconds;
   bool useFastModelParser;
   double terminateRegretBound;
   double terminateWallclockSeconds;
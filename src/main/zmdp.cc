@@ -21,6 +21,8 @@
  ***************************************************************************/
 
 #include <assert.h>
+#include <limits.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <getopt.h>
 #include <signal.h>
@@ -37,6 +39,11 @@
 #include "PolicyEvaluator.h"
 #include "zmdpCommonTime.h"
 #include "TestDriver.h"
+#include "BinaryModelParser.h"
+#include "ByteSource.h"
+#include "MaxPlanesLowerBound.h"
+#include "BinaryPolicy.h"
+#include "PolicyLog.h"
 
 #include "zmdpMainConfig.cc" // embed default config file
 
@@ -47,7 +54,10 @@ using namespace zmdp;
 enum CommandsEnum {
   CMD_SOLVE,
   CMD_BENCHMARK,
-  CMD_EVALUATE
+  CMD_EVALUATE,
+  CMD_CONVERT,
+  CMD_CONVERT_POLICY,
+  CMD_COMPARE
 };
 
 bool userTerminatedG = false;
@@ -55,8 +65,12 @@ bool userTerminatedG = false;
 void sigIntHandler(int sig) {
   userTerminatedG = true;
 
-  printf("*** received SIGINT, user pressed control-C ***\n"
-	 "terminating run and writing output policy as soon as the solver returns control\n");
+  if (SIGINT == sig) {
+    printf("*** received SIGINT, user pressed control-C ***\n");
+  } else {
+    printf("*** received signal %d ***\n", sig);
+  }
+  printf("terminating run and writing output policy as soon as the solver returns control\n");
   fflush(stdout);
 }
 
@@ -72,6 +86,18 @@ void setSignalHandler(int sig, void (*handler)(int)) {
   }
 }
 
+void writeSolverCheckpoint(SolverObjects& so, const char* fileName,
+			   StopWatch& run)
+{
+  printf("%05d writing solver checkpoint to '%s'\n",
+	 (int) run.elapsedTime(), fileName);
+  fflush(stdout);
+  if (!so.solver->writeCheckpoint(fileName)) {
+    printf("%05d (solver is not initialized yet, not writing checkpoint)\n",
+	   (int) run.elapsedTime());
+  }
+}
+
 void doSolve(const ZMDPConfig& config)
 {
   init_matrix_utils();
@@ -86,15 +112,24 @@ void doSolve(const ZMDPConfig& config)
   constructSolverObjects(so, p, config);
 
   // initialize the solver
-  printf("%05d calculating initial heuristics\n",
-	 (int) run.elapsedTime());
+  const std::string& resumeFrom = config.getString("resumeFrom");
+  if ("none" == resumeFrom) {
+    printf("%05d calculating initial heuristics\n",
+	   (int) run.elapsedTime());
+  } else {
+    printf("%05d resuming from solver checkpoint '%s'\n",
+	   (int) run.elapsedTime(), resumeFrom.c_str());
+  }
   so.solver->planInit(so.sim->getModel(), &config);
   printf("%05d finished initialization, beginning to improve policy\n",
 	 (int) run.elapsedTime());
   
   setSignalHandler(SIGINT, &sigIntHandler);
+  // preemptible machines send SIGTERM before shutting down
+  setSignalHandler(SIGTERM, &sigIntHandler);
 
   double lastPrintTime = -1000;
+  double lastCheckpointTime = 0;
   bool reachedTargetPrecision = false;
   bool reachedTimeout = false;
   int numSolverCalls = 0;
@@ -119,6 +154,14 @@ void doSolve(const ZMDPConfig& config)
 	     (int) elapsed, numSolverCalls, intv.l, intv.u, (intv.u - intv.l));
       lastPrintTime = elapsed;
     }
+
+    if (NULL != p.solverCheckpointFile
+	&& p.solverCheckpointIntervalSeconds > 0
+	&& elapsed - lastCheckpointTime >= p.solverCheckpointIntervalSeconds
+	&& !(reachedTargetPrecision || reachedTimeout || userTerminatedG)) {
+      writeSolverCheckpoint(so, p.solverCheckpointFile, run);
+      lastCheckpointTime = elapsed;
+    }
   }
 
   // say why the run ended
@@ -129,10 +172,14 @@ void doSolve(const ZMDPConfig& config)
     printf("%05d terminating run; passed specified timeout of %g seconds\n",
 	   (int) run.elapsedTime(), p.terminateWallclockSeconds);
   } else {
-    printf("%05d terminating run; caught SIGINT from user\n",
+    printf("%05d terminating run; caught SIGINT or SIGTERM\n",
 	   (int) run.elapsedTime());
   }
 
+  if (NULL != p.solverCheckpointFile) {
+    writeSolverCheckpoint(so, p.solverCheckpointFile, run);
+  }
+
   // write out a policy
   if (NULL == p.policyOutputFile) {
     printf("%05d (not outputting policy)\n", (int) run.elapsedTime());
@@ -141,6 +188,11 @@ void doSolve(const ZMDPConfig& config)
     assert(so.bounds->lowerBound != NULL);
     so.bounds->writePolicy(p.policyOutputFile, /* canModifyBounds = */ true);
   }
+  if (NULL != p.upperBoundOutputFile) {
+    printf("%05d writing upper bound to '%s'\n", (int) run.elapsedTime(),
+	   p.upperBoundOutputFile);
+    so.bounds->writeUpperBound(p.upperBoundOutputFile);
+  }
 
   // finish up logging (if any, according to params specified in the config file)
   printf("%05d finishing logging (e.g., writing qValuesOutputFile if it was requested)\n",
@@ -173,7 +225,8 @@ void doBenchmark(const ZMDPConfig& config)
 			 /* incPlotFileName = */ p.evaluationOutputFile,
 			 /* boundsFileName = */ p.boundsOutputFile,
 			 /* simFileName = */ p.simulationTraceOutputFile,
-			 /* policyOutputFile = */ p.policyOutputFile);
+			 /* policyOutputFile = */ p.policyOutputFile,
+			 /* policyCheckpointLog = */ p.policyCheckpointLog);
 }
 
 void doEvaluate(const ZMDPConfig& config)
@@ -252,6 +305,241 @@ void doEvaluate(const ZMDPConfig& config)
 			       0.05, // 95% confidence interval
 			       mean, quantile1, quantile2);
   printf("REWARD_MEAN_CONF95MIN_CONF95MAX %.3lf %.3lf %.3lf\n", mean, quantile1, quantile2);
+
+  exec->printStats(std::cout);
+}
+
+void doCompare(const ZMDPConfig& config)
+{
+  // seeds random number generator (used for the bootstrap)
+  init_matrix_utils();
+
+  zmdpDebugLevelG = config.getInt("debugLevel");
+  zmdpUseFingerprintStateKeysG = config.getBool("useFingerprintStateKeys");
+
+  std::string simModelFileName = config.getString("simulatorModel");
+  std::string plannerModelFileName = config.getString("plannerModel");
+  if (plannerModelFileName == "-") {
+    plannerModelFileName = simModelFileName;
+  }
+  std::string policyType = config.getString("policyType");
+  if (policyType != "maxPlanes" && policyType != "cassandraAlpha") {
+    fprintf(stderr, "ERROR: zmdp compare supports policy types 'maxPlanes' and 'cassandraAlpha', not '%s'\n",
+	    policyType.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::string> policyFiles;
+  std::string policyList = config.getString("comparePolicyFiles");
+  if (policyList != "none") {
+    std::string::size_type start = 0;
+    while (1) {
+      std::string::size_type comma = policyList.find(',', start);
+      std::string f = policyList.substr(start, comma - start);
+      if (!f.empty()) policyFiles.push_back(f);
+      if (std::string::npos == comma) break;
+      start = comma + 1;
+    }
+  }
+  if (policyFiles.size() < 2) {
+    fprintf(stderr, "ERROR: zmdp compare needs at least two policies, separated by commas, in --comparePolicyFiles (-h for help)\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // every policy is evaluated on the same trials, with the same random
+  // draws at each step (common random numbers)
+  ZMDPConfig evalConfig(config);
+  if (0 == config.getInt("evaluationRandomSeed")) {
+    timeval now = getTime();
+    int seed = 1 + (int) ((((unsigned long) now.tv_sec) ^ now.tv_usec ^ getpid()) % (INT_MAX-1));
+    evalConfig.setInt("evaluationRandomSeed", seed);
+  }
+  printf("comparing %d policies with evaluationRandomSeed=%d\n",
+	 (int) policyFiles.size(), evalConfig.getInt("evaluationRandomSeed"));
+  if (config.getDouble("evaluationConfidenceWidth") > 0
+      || config.getDouble("evaluationMaxWallclockSeconds") > 0) {
+    fprintf(stderr, "WARNING: zmdp compare ignores evaluationConfidenceWidth and "
+	    "evaluationMaxWallclockSeconds so that every policy runs the same trials\n");
+    evalConfig.setDouble("evaluationConfidenceWidth", 0);
+    evalConfig.setDouble("evaluationMaxWallclockSeconds", 0);
+  }
+  evalConfig.setInt("simulationTracesToLogPerEpoch", 0);
+
+  Pomdp* plannerPomdp = new Pomdp(plannerModelFileName, &config);
+  Pomdp* simPomdp = plannerPomdp;
+  bool assumeIdenticalModels = (plannerModelFileName == simModelFileName);
+  if (!assumeIdenticalModels) {
+    simPomdp = new Pomdp(simModelFileName, &config);
+    if (! ((plannerPomdp->getNumActions() == simPomdp->getNumActions())
+	   && (plannerPomdp->getNumObservations() == simPomdp->getNumObservations()))) {
+      printf("ERROR: planner model %s and evaluation model %s must have the same number of actions and observations\n",
+	     plannerModelFileName.c_str(), simModelFileName.c_str());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  int numPolicies = policyFiles.size();
+  std::vector<dvector> rewardSamples(numPolicies);
+  std::vector<double> ciWidth(numPolicies);
+  std::ostringstream summary;
+  char buf[1024];
+  FOR (i, numPolicies) {
+    BoundPairExec exec;
+    exec.initReadPolicy(plannerPomdp, policyFiles[i], config);
+    PolicyEvaluator eval(simPomdp, &exec, &evalConfig, assumeIdenticalModels);
+    double successRate;
+    eval.getRewardSamples(rewardSamples[i], successRate, /* verbose = */ false);
+    exec.printStats(std::cout);
+    // the exec and its clones share the bounds without owning them
+    delete exec.bounds;
+
+    double mean, quantile1, quantile2;
+    calc_bootstrap_mean_quantile(rewardSamples[i], 0.05, mean, quantile1, quantile2);
+    ciWidth[i] = quantile2 - quantile1;
+    snprintf(buf, sizeof(buf), "REWARD_MEAN_CONF95MIN_CONF95MAX %s %.3lf %.3lf %.3lf\n",
+	     policyFiles[i].c_str(), mean, quantile1, quantile2);
+    summary << buf;
+  }
+
+  // paired differences against the first policy.  with common random
+  // numbers, the batch means of two policies are positively correlated,
+  // so the interval for their difference is narrower than it would be
+  // for independent evaluations.
+  for (int i=1; i < numPolicies; i++) {
+    dvector diff = rewardSamples[i];
+    diff -= rewardSamples[0];
+    double mean, quantile1, quantile2;
+    calc_bootstrap_mean_quantile(diff, 0.05, mean, quantile1, quantile2);
+    snprintf(buf, sizeof(buf), "PAIRED_DIFF_MEAN_CONF95MIN_CONF95MAX %s %s %.3lf %.3lf %.3lf\n",
+	     policyFiles[i].c_str(), policyFiles[0].c_str(), mean, quantile1, quantile2);
+    summary << buf;
+    snprintf(buf, sizeof(buf), "  (paired interval width %.3lf; independent evaluations would give about %.3lf)\n",
+	     quantile2 - quantile1, sqrt(ciWidth[0]*ciWidth[0] + ciWidth[i]*ciWidth[i]));
+    summary << buf;
+  }
+  printf("%s", summary.str().c_str());
+}
+
+void doConvert(const ZMDPConfig& config)
+{
+  StopWatch run;
+
+  SolverParams p;
+  p.setValues(config);
+
+  bool isPomdp;
+  std::string ext;
+  switch (p.modelType) {
+  case T_POMDP:
+    isPomdp = true;
+    ext = ".pomdp";
+    break;
+  case T_MDP:
+    isPomdp = false;
+    ext = ".mdp";
+    break;
+  default:
+    fprintf(stderr, "ERROR: 'zmdp convert' only supports modelType 'pomdp' or 'mdp' (-h for help)\n");
+    exit(EXIT_FAILURE);
+  }
+  if (BinaryModelParser::isBinaryModelFile(p.probName)) {
+    fprintf(stderr, "ERROR: model %s is already in binary format\n", p.probName);
+    exit(EXIT_FAILURE);
+  }
+
+  std::string outFile = config.getString("modelOutputFile");
+  if (outFile == "-") {
+    if (0 == strcmp(p.probName, "-")) {
+      fprintf(stderr, "ERROR: specify --modelOutputFile when reading the model from standard input\n");
+      exit(EXIT_FAILURE);
+    }
+    outFile = ByteSource::stripCompressionExtension(p.probName);
+    if (!endsWith(outFile, ext)) {
+      outFile += ext;
+    }
+    outFile += "b";
+  }
+  if (!BinaryModelParser::isBinaryModelFile(outFile)) {
+    fprintf(stderr, "ERROR: binary model output file %s must have extension '%sb' so it can be recognized when it is read\n",
+	    outFile.c_str(), ext.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  printf("%05d reading model file\n", (int) run.elapsedTime());
+  CassandraModel* model;
+  if (isPomdp) {
+    model = new Pomdp(p.probName, &config);
+  } else {
+    model = new GenericDiscreteMDP(p.probName, &config);
+  }
+
+  printf("%05d writing binary model to '%s'\n", (int) run.elapsedTime(), outFile.c_str());
+  BinaryModelParser::writeModelToFile(*model, isPomdp, outFile);
+  delete model;
+
+  printf("%05d done\n", (int) run.elapsedTime());
+}
+
+void doConvertPolicy(const ZMDPConfig& config)
+{
+  StopWatch run;
+
+  SolverParams p;
+  p.setValues(config);
+
+  if (T_POMDP != p.modelType) {
+    fprintf(stderr, "ERROR: 'zmdp convertPolicy' only supports modelType 'pomdp' (-h for help)\n");
+    exit(EXIT_FAILURE);
+  }
+
+  std::string inFile = config.getString("policyInputFile");
+  std::string policyType = config.getString("policyType");
+  std::string outFile = config.getString("policyOutputFile");
+  if (outFile == "-") {
+    if (BinaryPolicy::isBinaryPolicyFile(inFile)) {
+      fprintf(stderr, "ERROR: policy %s is already in binary format; specify the output file with --policyOutputFile\n",
+	      inFile.c_str());
+      exit(EXIT_FAILURE);
+    }
+    if (PolicyLog::isPolicyLogFile(inFile)) {
+      // compacting a checkpoint log: foo.policylog -> foo.policy
+      outFile = inFile.substr(0, inFile.size() - strlen("log"));
+    } else {
+      outFile = inFile + "b";
+    }
+  }
+  if (outFile == inFile) {
+    fprintf(stderr, "ERROR: policy input and output files must be different\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // the model is needed for its number of states
+  printf("%05d reading model file\n", (int) run.elapsedTime());
+  Pomdp* pomdp = new Pomdp(p.probName, &config);
+  MaxPlanesLowerBound lb(pomdp, &config);
+
+  printf("%05d reading policy from '%s'\n", (int) run.elapsedTime(), inFile.c_str());
+  if (BinaryPolicy::isBinaryPolicyFile(inFile)
+      || PolicyLog::isPolicyLogFile(inFile)
+      || policyType == "maxPlanes") {
+    lb.readFromFile(inFile);
+  } else if (policyType == "cassandraAlpha") {
+    lb.readFromCassandraAlphaFile(inFile);
+  } else {
+    fprintf(stderr, "ERROR: 'zmdp convertPolicy' can not read policy type '%s' (-h for help)\n",
+	    policyType.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  printf("%05d writing %d planes to '%s'\n", (int) run.elapsedTime(),
+	 (int) lb.planes.size(), outFile.c_str());
+  if (endsWith(outFile, ".alpha")) {
+    lb.writeToCassandraAlphaFile(outFile);
+  } else {
+    lb.writeToFile(outFile);
+  }
+
+  printf("%05d done\n", (int) run.elapsedTime());
 }
 
 void solveUsage(const char* cmd0)
@@ -268,7 +556,9 @@ void solveUsage(const char* cmd0)
     "  options for how to end the run: you can specify a desired regret bound\n"
     "  for the output solution, specify a fixed timeout, or just use ctrl-C to\n"
     "  interrupt the algorithm when you are satisfied (it will output the final\n"
-    "  policy before exiting).\n"
+    "  policy before exiting).  With --solverCheckpointFile, the full solver\n"
+    "  state is also saved, and a later run with --resumeFrom continues the\n"
+    "  search from there.\n"
     "\n"
     "Commonly used options:\n"
     "  -f        Use fast model parser (for larger RockSample and LifeSurvey problems)\n"
@@ -346,6 +636,97 @@ void evaluateUsage(const char* cmd0)
   exit(-1);
 }
 
+void compareUsage(const char* cmd0)
+{
+  cerr <<
+    "usage: " << cmd0 << " compare [options] <simulatorModel>\n"
+    "  Run 'zmdp -h' for an overview of commands and generic options.\n"
+    "\n"
+    "  'zmdp compare' evaluates several policies for the same model on identical\n"
+    "  simulated trials: trial i draws the same sequence of random numbers for\n"
+    "  every policy (common random numbers).  It reports the mean reward of each\n"
+    "  policy and, for each policy after the first, the mean difference from the\n"
+    "  first policy with a 95% confidence interval.  Because the evaluations share\n"
+    "  their randomness, the interval for the difference is usually much narrower\n"
+    "  than independent 'zmdp evaluate' runs would give.  Set --evaluationRandomSeed\n"
+    "  to reproduce a comparison (or to compare against a later run).\n"
+    "\n"
+    "Commonly used options:\n"
+    "  -f        Use fast model parser (for larger RockSample and LifeSurvey problems)\n"
+    "  -i <#>    Specify number of simulation runs per policy [1000]\n"
+    "  --comparePolicyFiles <f1>,<f2>,...  Specify the policies to compare\n"
+    "  For many more options and more detailed descriptions, see the config file.\n"
+    "\n"
+    "Examples:\n"
+    "  " << cmd0 << " compare --comparePolicyFiles a.policy,b.policy RockSample_7_8.pomdp\n"
+    "  " << cmd0 << " compare --comparePolicyFiles a.policy,b.policyb,c.policy -i 5000 RockSample_7_8.pomdp\n"
+    "\n"
+    ;
+  exit(-1);
+}
+
+void convertUsage(const char* cmd0)
+{
+  cerr <<
+    "usage: " << cmd0 << " convert [options] <model>\n"
+    "  Run 'zmdp -h' for an overview of commands and generic options.\n"
+    "\n"
+    "  'zmdp convert' reads a .pomdp or .mdp model and writes it in ZMDP's\n"
+    "  binary model format (extension .pomdpb or .mdpb).  Binary models can be\n"
+    "  used in place of the original model with any other command and load much\n"
+    "  faster, which helps when the same large model is used for many runs.\n"
+    "  Like the other commands, it also reads gzip-compressed models (.pomdp.gz)\n"
+    "  and, if <model> is '-', standard input.\n"
+    "  Binary models are specific to the machine architecture that wrote them.\n"
+    "\n"
+    "Commonly used options:\n"
+    "  -f        Use fast model parser to read the input model\n"
+    "  --modelOutputFile <file>  Specify where to write the binary model [<model>b]\n"
+    "\n"
+    "Examples:\n"
+    "  " << cmd0 << " convert -f RockSample_7_8.pomdp\n"
+    "  " << cmd0 << " solve RockSample_7_8.pomdpb\n"
+    "\n"
+    ;
+  exit(-1);
+}
+
+void convertPolicyUsage(const char* cmd0)
+{
+  cerr <<
+    "usage: " << cmd0 << " convertPolicy [options] <model>\n"
+    "  Run 'zmdp -h' for an overview of commands and generic options.\n"
+    "\n"
+    "  'zmdp convertPolicy' converts a policy for <model> between ZMDP's text\n"
+    "  policy format, ZMDP's binary policy format, and the Cassandra alpha\n"
+    "  vector format.  The input format is binary if the input file has the\n"
+    "  extension .policyb and is otherwise given by --policyType.  An input\n"
+    "  file with the extension .policylog is a checkpoint log written with\n"
+    "  --policyCheckpointLog, which is compacted into a standard policy.  The output\n"
+    "  format is binary if the output file has the extension .policyb,\n"
+    "  Cassandra alpha if it has the extension .alpha, and text otherwise.\n"
+    "  Binary policies can be used with 'zmdp evaluate' in place of text\n"
+    "  policies; they are mapped into memory and queried without parsing.\n"
+    "\n"
+    "Commonly used options:\n"
+    "  -f        Use fast model parser to read the model\n"
+    "  --policyInputFile <file>   Specify the policy to read [out.policy]\n"
+    "  --policyType <type>        Format of a non-binary input policy,\n"
+    "                             'maxPlanes' or 'cassandraAlpha' [maxPlanes]\n"
+    "  -o or --policyOutputFile <file>  Specify where to write the converted\n"
+    "                             policy [<policyInputFile>b, or foo.policy\n"
+    "                             for a foo.policylog input]\n"
+    "\n"
+    "Examples:\n"
+    "  " << cmd0 << " convertPolicy RockSample_7_8.pomdp\n"
+    "  " << cmd0 << " evaluate --policyInputFile out.policyb RockSample_7_8.pomdp\n"
+    "  " << cmd0 << " convertPolicy --policyInputFile out.policyb -o out.alpha RockSample_7_8.pomdp\n"
+    "  " << cmd0 << " convertPolicy --policyInputFile run.policylog RockSample_7_8.pomdp\n"
+    "\n"
+    ;
+  exit(-1);
+}
+
 void genericUsage(const char* cmd0)
 {
   cerr <<
@@ -355,6 +736,9 @@ void genericUsage(const char* cmd0)
     "  zmdp solve      Solves an MDP or POMDP, generating an output policy\n"
     "  zmdp benchmark  Like 'solve', but interleaves evaluation during the solution process\n"
     "  zmdp evaluate   Evaluates a policy output by 'solve' or 'benchmark'\n"
+    "  zmdp compare    Compares policies on identical simulated trials\n"
+    "  zmdp convert    Converts a model to binary format for faster loading\n"
+    "  zmdp convertPolicy  Converts a policy between text, binary, and Cassandra alpha formats\n"
     "\n"
     "  For more information on a command, run (for example), 'zmdp solve -h'.\n"
     "\n"
@@ -374,10 +758,16 @@ void genericUsage(const char* cmd0)
     "  To generate an example config file (including default values and comments describing\n"
     "  all the parameters), use the '--genConfig <file>' option.\n"
     "\n"
+    "  Text models can be gzip-compressed ('.pomdp.gz' or '.mdp.gz').  If the model\n"
+    "  filename is '-', the model is read from standard input (compressed or not),\n"
+    "  so a model generator can be piped directly into zmdp; in that case specify\n"
+    "  --modelType.\n"
+    "\n"
     "Examples:\n"
     "  " << cmd0 << " solve RockSample_4_4.pomdp\n"
     "  " << cmd0 << " benchmark RockSample_4_4.pomdp\n"
     "  " << cmd0 << " evaluate --policyInputFile out.policy RockSample_4_4.pomdp\n"
+    "  gen_RockSample_5_7 - | " << cmd0 << " solve -f --modelType pomdp -\n"
     "\n"
     ;
   exit(-1);
@@ -391,6 +781,12 @@ void usage(const char* cmd0, const std::string& cmd1)
     benchmarkUsage(cmd0);
   } else if (cmd1 == "evaluate") {
     evaluateUsage(cmd0);
+  } else if (cmd1 == "compare") {
+    compareUsage(cmd0);
+  } else if (cmd1 == "convert") {
+    convertUsage(cmd0);
+  } else if (cmd1 == "convertPolicy") {
+    convertPolicyUsage(cmd0);
   } else {
     genericUsage(cmd0);
   }
@@ -420,7 +816,8 @@ int main(int argc, char **argv) {
     if (args == "bench") {
       args = "benchmark";
     }
-    if (args == "solve" || args == "benchmark" || args == "evaluate") {
+    if (args == "solve" || args == "benchmark" || args == "evaluate"
+	|| args == "compare" || args == "convert" || args == "convertPolicy") {
       cmd1 = args;
     }
 
@@ -487,6 +884,12 @@ int main(int argc, char **argv) {
     cmd = CMD_BENCHMARK;
   } else if (cmdStr == "evaluate") {
     cmd = CMD_EVALUATE;
+  } else if (cmdStr == "convert") {
+    cmd = CMD_CONVERT;
+  } else if (cmdStr == "convertPolicy") {
+    cmd = CMD_CONVERT_POLICY;
+  } else if (cmdStr == "compare") {
+    cmd = CMD_COMPARE;
   } else {
     fprintf(stderr, "ERROR: unknown command '%s' (use -h for help)\n", cmdStr.c_str());
     exit(EXIT_FAILURE);
@@ -510,8 +913,13 @@ int main(int argc, char **argv) {
       break;
     case CMD_BENCHMARK:
     case CMD_EVALUATE:
+    case CMD_COMPARE:
+    case CMD_CONVERT:
       config.setString("policyOutputFile", "none");
       break;
+    case CMD_CONVERT_POLICY:
+      // default depends on policyInputFile, filled in by doConvertPolicy()
+      break;
     default:
       assert(0); // never reach this point
     }
@@ -535,6 +943,15 @@ int main(int argc, char **argv) {
   case CMD_EVALUATE:
     doEvaluate(config);
     break;
+  case CMD_CONVERT:
+    doConvert(config);
+    break;
+  case CMD_CONVERT_POLICY:
+    doConvertPolicy(config);
+    break;
+  case CMD_COMPARE:
+    doCompare(config);
+    break;
   default:
     assert(0); // never reach this point
   }
@@ -132,7 +132,8 @@ CMDPNode* CacheMDP::getNode(const state_vector& s)
 
 CMDPNode* CacheMDP::getNodeX(const state_vector& s)
 {
-  string hs = hashable(s);
+  StateKey hs;
+  getStateKey(hs, s);
   CMDPHash::iterator pr = lookup.find(hs);
   if (lookup.end() == pr) {
     // create a new fringe node
@@ -156,15 +157,14 @@ CMDPQEntry* CacheMDP::getQ(CMDPNode& cn, int a)
 {
   if (NULL == cn.Q[a]) {
     CMDPQEntry& Qa = *(new CMDPQEntry);
+    std::vector<state_vector> nextStates;
     Qa.immediateReward = problem->getReward(cn.s, a);
-    problem->getOutcomeProbVector(Qa.opv, cn.s, a);
+    problem->getAllOutcomes(Qa.opv, nextStates, cn.s, a);
     Qa.outcomes.resize(Qa.opv.size(), NULL);
     FOR (o, Qa.opv.size()) {
       if (Qa.opv(o) > OBS_IS_ZERO_EPS) {
 	CMDPEdge* e = new CMDPEdge;
-	state_vector sp;
-	problem->getNextState(sp, cn.s, a, o);
-	e->nextState = getNodeX(sp);
+	e->nextState = getNodeX(nextStates[o]);
 	e->userInt = -1;
 	e->userDouble = 0.0;
 	Qa.outcomes[o] = e;
@@ -30,6 +30,7 @@
 #include "zmdpConfig.h"
 #include "MDPModel.h"
 #include "AbstractBound.h"
+#include "StateKey.h"
 
 namespace zmdp {
 
@@ -69,7 +70,7 @@ struct CMDPNode {
   size_t getNumActions(void) const { return Q.size(); }
 };
 
-typedef EXT_NAMESPACE::hash_map<std::string, int> CMDPHash;
+typedef EXT_NAMESPACE::hash_map<StateKey, int, StateKeyHash> CMDPHash;
 typedef std::vector<CMDPNode*> CMDPNodeTable;
 
 struct CacheMDP : public MDP {
@@ -38,6 +38,7 @@
 #include "slaMatrixUtils.h"
 #include "FastParser.h"
 #include "CassandraParser.h"
+#include "BinaryModelParser.h"
 #include "GenericDiscreteMDP.h"
 
 using namespace std;
@@ -52,13 +53,20 @@ GenericDiscreteMDP::GenericDiscreteMDP(const std::string& fileName,
   boundsInitialized(false)
 {
   bool useFastModelParser = config->getBool("useFastModelParser");
-  if (useFastModelParser) {
-    FastParser parser;
+  bool useLazyModelLoading = config->getBool("useLazyModelLoading");
+  if (BinaryModelParser::isBinaryModelFile(fileName)) {
+    BinaryModelParser parser(useLazyModelLoading);
+    parser.readGenericDiscreteMDPFromFile(*this, fileName);
+  } else if (useFastModelParser) {
+    FastParser parser(config->getInt("fastModelParserThreads"));
     parser.readGenericDiscreteMDPFromFile(*this, fileName);
   } else {
     CassandraParser parser;
     parser.readGenericDiscreteMDPFromFile(*this, fileName);
   }
+  if (useLazyModelLoading) {
+    initLazyLoading(*config);
+  }
   
   // in the generic discrete MDP, states are just integers, which
   // we represent using length 1 vectors
@@ -86,10 +94,11 @@ outcome_prob_vector& GenericDiscreteMDP::getOutcomeProbVector(outcome_prob_vecto
 
   // extract the non-zero entries of column s of Ttr[a] and
   // pack them into the dense result vector.
-  result.resize(Ttr[a].filled_in_column(s));
+  const cmatrix& Ttra = getTtr(a);
+  result.resize(Ttra.filled_in_column(s));
   int o = 0;
-  FOR_CM_MINOR(s, Ttr[a]) {
-    result(o++) = CM_VAL(Ttr[a]);
+  FOR_CM_MINOR(s, Ttra) {
+    result(o++) = CM_VAL(Ttra);
   }
 
   return result;
@@ -109,11 +118,12 @@ state_vector& GenericDiscreteMDP::getNextState(state_vector& result,
   // return the row in which the 'o'th non-zero entry in column s of
   // Ttr[a] appears.  this corresponds to the 'o'th entry in the dense
   // vector returned earlier by getOutcomeProbVector().
+  const cmatrix& Ttra = getTtr(a);
   int i = 0;
-  FOR_CM_MINOR (s, Ttr[a]) {
+  FOR_CM_MINOR (s, Ttra) {
     if (i++ == o) {
       result.resize(1);
-      result.push_back(0, CM_ROW(s, Ttr[a]));
+      result.push_back(0, CM_ROW(s, Ttra));
       return result;
     }
   }
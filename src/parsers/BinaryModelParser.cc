@@ -0,0 +1,457 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    BinaryModelParser.cc
+ @brief   Reads and writes CassandraModel in a compact binary format.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#include "zmdpCommonDefs.h"
+#include "BinaryModelParser.h"
+
+using namespace std;
+
+namespace zmdp {
+
+/***************************************************************************
+ * FILE LAYOUT
+ *
+ * header
+ * initialBelief     (cvector)
+ * initialState      (cvector)
+ * isTerminalState   (one byte per state)
+ * R                 (cmatrix)
+ * for each action a: T[a], Ttr[a], and O[a] if the model is a POMDP
+ *
+ * A cvector is stored as its size and number of entries followed by the
+ * raw entry array; a cmatrix as its dimensions and number of entries,
+ * then the raw col_starts and entry arrays.  Every field starts on an
+ * 8-byte boundary.
+ ***************************************************************************/
+
+static const char BM_MAGIC[8] = { 'Z','M','D','P','B','I','N','\0' };
+static const uint32_t BM_BYTE_ORDER_MARK = 0x01020304;
+
+struct BMHeader {
+  char magic[8];
+  int32_t version;
+  uint32_t byteOrderMark;
+  int32_t entryBytes;
+  int32_t isPomdp;
+  int32_t numStates;
+  int32_t numActions;
+  int32_t numObservations;
+  int32_t reserved;
+  double discount;
+  uint64_t fileSize;
+};
+
+static inline size_t bmPadded(size_t n)
+{
+  return (n + 7) & ~((size_t) 7);
+}
+
+/***************************************************************************
+ * WRITING
+ ***************************************************************************/
+
+struct BMWriter {
+  std::ofstream out;
+  uint64_t pos;
+  std::vector<char> entryBuf;
+
+  void write(const void* buf, size_t n) {
+    static const char zeros[8] = { 0 };
+    out.write((const char*) buf, n);
+    out.write(zeros, bmPadded(n) - n);
+    pos += bmPadded(n);
+  }
+  void writeU64(uint64_t x) { write(&x, sizeof(x)); }
+
+  // cvector_entry has padding after its index field; copy the entries
+  // through a zeroed buffer so the output does not depend on whatever
+  // the padding happens to contain
+  void writeEntries(const std::vector<cvector_entry>& entries) {
+    const size_t blockSize = 4096;
+    for (size_t i = 0; i < entries.size(); i += blockSize) {
+      size_t n = std::min(blockSize, entries.size() - i);
+      entryBuf.clear();
+      append_packed_entries(entryBuf, &entries[i], n);
+      out.write(&entryBuf[0], entryBuf.size());
+    }
+    // entries are a multiple of 8 bytes, so no padding is needed
+    pos += entries.size() * sizeof(cvector_entry);
+  }
+
+  void writeVector(const cvector& x) {
+    writeU64(x.size());
+    writeU64(x.data.size());
+    writeEntries(x.data);
+  }
+
+  void writeMatrix(const cmatrix& A) {
+    writeU64(A.size1());
+    writeU64(A.size2());
+    writeU64(A.data.size());
+    write(&A.col_starts[0], A.col_starts.size() * sizeof(unsigned int));
+    writeEntries(A.data);
+  }
+};
+
+void BinaryModelParser::writeModelToFile(const CassandraModel& p,
+					 bool isPomdp,
+					 const std::string& fileName)
+{
+  BMWriter w;
+  w.out.open(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+  if (!w.out) {
+    cerr << "ERROR: couldn't open " << fileName << " for writing: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  w.pos = 0;
+
+  BMHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, BM_MAGIC, sizeof(h.magic));
+  h.version = ZMDP_BINARY_MODEL_VERSION;
+  h.byteOrderMark = BM_BYTE_ORDER_MARK;
+  h.entryBytes = sizeof(cvector_entry);
+  h.isPomdp = isPomdp;
+  h.numStates = p.numStates;
+  h.numActions = p.numActions;
+  h.numObservations = isPomdp ? p.numObservations : -1;
+  h.discount = p.discount;
+  h.fileSize = 0; // filled in below
+  w.write(&h, sizeof(h));
+
+  w.writeVector(p.initialBelief);
+  w.writeVector(p.initialState);
+  std::vector<char> terminal(p.numStates);
+  FOR (s, p.numStates) {
+    terminal[s] = p.isTerminalState[s];
+  }
+  w.write(&terminal[0], terminal.size());
+
+  w.writeMatrix(p.R);
+  FOR (a, p.numActions) {
+    w.writeMatrix(p.T[a]);
+    w.writeMatrix(p.Ttr[a]);
+    if (isPomdp) {
+      w.writeMatrix(p.O[a]);
+    }
+  }
+
+  // now that the size is known, patch the header
+  h.fileSize = w.pos;
+  w.out.seekp(0);
+  w.out.write((const char*) &h, sizeof(h));
+
+  w.out.close();
+  if (w.out.fail()) {
+    cerr << "ERROR: error while writing " << fileName << ": "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+/***************************************************************************
+ * READING
+ ***************************************************************************/
+
+struct BMReader {
+  const char* data;
+  size_t size;
+  size_t pos;
+  const std::string* fileName;
+
+  const void* take(size_t n) {
+    if (n > size - pos) {
+      cerr << "ERROR: " << *fileName << ": binary model file is truncated"
+	   << endl;
+      exit(EXIT_FAILURE);
+    }
+    const void* ret = data + pos;
+    pos += std::min(bmPadded(n), size - pos);
+    return ret;
+  }
+  uint64_t readU64(void) {
+    uint64_t x;
+    memcpy(&x, take(sizeof(x)), sizeof(x));
+    return x;
+  }
+
+  void readVector(cvector& x) {
+    unsigned int vsize = readU64();
+    size_t nnz = readU64();
+    x.resize(vsize);
+    const cvector_entry* e =
+      (const cvector_entry*) take(nnz * sizeof(cvector_entry));
+    x.data.assign(e, e + nnz);
+  }
+
+  void readMatrix(cmatrix& A) {
+    A.size1_ = readU64();
+    A.size2_ = readU64();
+    size_t nnz = readU64();
+    const unsigned int* cs =
+      (const unsigned int*) take((A.size2_+1) * sizeof(unsigned int));
+    A.col_starts.assign(cs, cs + A.size2_ + 1);
+    if (A.col_starts[A.size2_] != nnz) {
+      cerr << "ERROR: " << *fileName << ": binary model file is corrupt"
+	   << endl;
+      exit(EXIT_FAILURE);
+    }
+    const cvector_entry* e =
+      (const cvector_entry*) take(nnz * sizeof(cvector_entry));
+    A.data.assign(e, e + nnz);
+  }
+
+  // skips over a matrix, returning the memory it needs once loaded
+  size_t skipMatrix(void) {
+    readU64();
+    size_t size2 = readU64();
+    size_t nnz = readU64();
+    take((size2+1) * sizeof(unsigned int));
+    take(nnz * sizeof(cvector_entry));
+    return (size2+1) * sizeof(unsigned int) + nnz * sizeof(cvector_entry);
+  }
+};
+
+// reads the matrices for one action at a time out of a mapped binary
+// model file, for lazily loaded models
+struct BinaryModelActionSource : public ActionMatrixSource {
+  char* data;
+  size_t size;
+  std::string fileName;
+  bool isPomdp;
+  std::vector<size_t> actionOffsets;
+  std::vector<size_t> actionBytes;
+
+  ~BinaryModelActionSource(void) {
+    munmap(data, size);
+  }
+
+  void readAction(int a, cmatrix& T, cmatrix& Ttr, cmatrix& O) {
+    BMReader r;
+    r.data = data;
+    r.size = size;
+    r.pos = actionOffsets[a];
+    r.fileName = &fileName;
+    r.readMatrix(T);
+    r.readMatrix(Ttr);
+    if (isPomdp) {
+      r.readMatrix(O);
+    }
+  }
+
+  size_t getActionBytes(int a) {
+    return actionBytes[a];
+  }
+};
+
+BinaryModelParser::BinaryModelParser(bool _lazyActions) :
+  lazyActions(_lazyActions)
+{}
+
+bool BinaryModelParser::isBinaryModelFile(const std::string& fileName)
+{
+  const char* exts[] = { ".pomdpb", ".mdpb", NULL };
+  for (const char** ext = exts; NULL != *ext; ext++) {
+    size_t n = strlen(*ext);
+    if (fileName.size() >= n
+	&& 0 == fileName.compare(fileName.size() - n, n, *ext)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BinaryModelParser::readGenericDiscreteMDPFromFile(CassandraModel& mdp,
+						       const std::string& _fileName)
+{
+  mdp.fileName = _fileName;
+  readModelFromFile(mdp, /* expectPomdp = */ false);
+}
+
+void BinaryModelParser::readPomdpFromFile(CassandraModel& pomdp,
+					  const std::string& _fileName)
+{
+  pomdp.fileName = _fileName;
+  readModelFromFile(pomdp, /* expectPomdp = */ true);
+}
+
+static void readActions(BMReader& r, CassandraModel& p, bool expectPomdp)
+{
+  p.T.resize(p.numActions);
+  p.Ttr.resize(p.numActions);
+  if (expectPomdp) {
+    p.O.resize(p.numActions);
+  }
+  FOR (a, p.numActions) {
+    r.readMatrix(p.T[a]);
+    r.readMatrix(p.Ttr[a]);
+    if (expectPomdp) {
+      r.readMatrix(p.O[a]);
+    }
+  }
+}
+
+void BinaryModelParser::readModelFromFile(CassandraModel& p,
+					  bool expectPomdp)
+{
+  timeval startTime, endTime;
+  if (zmdpDebugLevelG >= 1) {
+    cout << "reading problem (binary) from " << p.fileName << endl;
+    gettimeofday(&startTime,0);
+  }
+
+  int fd = open(p.fileName.c_str(), O_RDONLY);
+  struct stat statBuf;
+  if (-1 == fd || 0 != fstat(fd, &statBuf)) {
+    cerr << "ERROR: couldn't open " << p.fileName << " for reading: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  size_t size = statBuf.st_size;
+  if (size < sizeof(BMHeader)) {
+    cerr << "ERROR: " << p.fileName << ": not a ZMDP binary model file" << endl;
+    exit(EXIT_FAILURE);
+  }
+  char* data = (char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == data) {
+    cerr << "ERROR: couldn't map " << p.fileName << " into memory: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+#ifdef MADV_SEQUENTIAL
+  if (!lazyActions) {
+    madvise(data, size, MADV_SEQUENTIAL);
+  }
+#endif
+  close(fd);
+
+  BMReader r;
+  r.data = data;
+  r.size = size;
+  r.pos = 0;
+  r.fileName = &p.fileName;
+
+  BMHeader h;
+  memcpy(&h, r.take(sizeof(h)), sizeof(h));
+  if (0 != memcmp(h.magic, BM_MAGIC, sizeof(h.magic))) {
+    cerr << "ERROR: " << p.fileName << ": not a ZMDP binary model file" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (h.byteOrderMark != BM_BYTE_ORDER_MARK
+      || h.entryBytes != (int) sizeof(cvector_entry)) {
+    cerr << "ERROR: " << p.fileName << ": binary model file was written on an "
+	 << "incompatible architecture; re-run 'zmdp convert' on this machine" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (h.version != ZMDP_BINARY_MODEL_VERSION) {
+    cerr << "ERROR: " << p.fileName << ": binary model format version "
+	 << h.version << " is not supported (expected version "
+	 << ZMDP_BINARY_MODEL_VERSION << "); re-run 'zmdp convert'" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (h.fileSize != size) {
+    cerr << "ERROR: " << p.fileName << ": binary model file is truncated" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if ((bool) h.isPomdp != expectPomdp) {
+    cerr << "ERROR: " << p.fileName << ": binary model file contains "
+	 << (h.isPomdp ? "a POMDP" : "an MDP") << ", expected "
+	 << (expectPomdp ? "a POMDP" : "an MDP") << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  p.numStates = h.numStates;
+  p.numActions = h.numActions;
+  p.numObservations = h.numObservations;
+  p.discount = h.discount;
+
+  r.readVector(p.initialBelief);
+  r.readVector(p.initialState);
+  const char* terminal = (const char*) r.take(p.numStates);
+  p.isTerminalState.resize(p.numStates);
+  FOR (s, p.numStates) {
+    p.isTerminalState[s] = terminal[s];
+  }
+
+  r.readMatrix(p.R);
+
+  if (lazyActions) {
+    // index the per-action matrices and leave them in the file
+    BinaryModelActionSource* source = new BinaryModelActionSource();
+    source->data = data;
+    source->size = size;
+    source->fileName = p.fileName;
+    source->isPomdp = expectPomdp;
+    source->actionOffsets.resize(p.numActions);
+    source->actionBytes.resize(p.numActions);
+    FOR (a, p.numActions) {
+      source->actionOffsets[a] = r.pos;
+      size_t bytes = r.skipMatrix() + r.skipMatrix();
+      if (expectPomdp) {
+	bytes += r.skipMatrix();
+      }
+      source->actionBytes[a] = bytes;
+    }
+    p.setActionSource(source);
+  } else {
+    readActions(r, p, expectPomdp);
+    munmap(data, size);
+  }
+
+  if (zmdpDebugLevelG >= 1) {
+    gettimeofday(&endTime,0);
+    double numSeconds = (endTime.tv_sec - startTime.tv_sec)
+      + 1e-6 * (endTime.tv_usec - startTime.tv_usec);
+    cout << "[file reading took " << numSeconds << " seconds]" << endl;
+    p.debugDensity();
+    p.debugPeakMemory();
+  }
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
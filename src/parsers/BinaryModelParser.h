@@ -0,0 +1,71 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    BinaryModelParser.h
+ @brief   Reads and writes CassandraModel in a compact binary format.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCBinaryModelParser_h
+#define INCBinaryModelParser_h
+
+#include <string>
+
+#include "CassandraModel.h"
+
+namespace zmdp {
+
+// Binary model files hold a CassandraModel exactly as it is laid out in
+// memory after parsing, so that loading one is little more than a bulk
+// copy out of a memory-mapped file.  The format is specific to the
+// architecture that wrote it; files written on a machine with a
+// different byte order or struct layout are rejected.  Generate binary
+// files from .pomdp or .mdp files with 'zmdp convert'.
+#define ZMDP_BINARY_MODEL_VERSION (1)
+
+struct BinaryModelParser {
+  // If lazyActions is true, only the parts of the model that are not
+  // indexed by action are read up front; T, Ttr, and O for each action
+  // are read from the (memory-mapped) file on first use.
+  BinaryModelParser(bool _lazyActions = false);
+
+  void readGenericDiscreteMDPFromFile(CassandraModel& mdp, const std::string& fileName);
+  void readPomdpFromFile(CassandraModel& pomdp, const std::string& fileName);
+
+  static void writeModelToFile(const CassandraModel& problem,
+			       bool isPomdp,
+			       const std::string& fileName);
+
+  // true if fileName has a binary model extension ('.pomdpb' or '.mdpb')
+  static bool isBinaryModelFile(const std::string& fileName);
+
+protected:
+  bool lazyActions;
+
+  void readModelFromFile(CassandraModel& problem,
+			 bool expectPomdp);
+};
+
+}; // namespace zmdp
+
+#endif // INCBinaryModelParser_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
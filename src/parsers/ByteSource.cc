@@ -0,0 +1,253 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    ByteSource.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include <iostream>
+
+#include "zmdpCommonDefs.h"
+#include "ByteSource.h"
+
+// size of the reads issued by ByteSourceBuf and ByteSourceFile
+#define BS_CHUNK_BYTES (1 << 16)
+
+using namespace std;
+
+namespace zmdp {
+
+/***************************************************************************
+ * STATIC HELPER FUNCTIONS
+ ***************************************************************************/
+
+static bool hasCompressionExtension(const std::string& fileName)
+{
+  return (fileName.size() > 3
+	  && 0 == fileName.compare(fileName.size()-3, 3, ".gz"));
+}
+
+// zlib reads compressed and uncompressed streams alike, so all sources
+// are read through it
+struct ZlibByteSource : public ByteSource {
+  gzFile in;
+
+  ZlibByteSource(const std::string& _fileName);
+  ~ZlibByteSource(void);
+  size_t read(char* buf, size_t maxBytes);
+};
+
+ZlibByteSource::ZlibByteSource(const std::string& _fileName)
+{
+  fileName = _fileName;
+  int fd;
+  if (fileName == "-") {
+    // gzclose() closes the descriptor; leave stdin open
+    fd = dup(STDIN_FILENO);
+  } else {
+    fd = ::open(fileName.c_str(), O_RDONLY);
+  }
+  in = (-1 == fd) ? NULL : gzdopen(fd, "rb");
+  if (NULL == in) {
+    cerr << "ERROR: couldn't open " << fileName << " for reading: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  gzbuffer(in, BS_CHUNK_BYTES);
+}
+
+ZlibByteSource::~ZlibByteSource(void)
+{
+  gzclose(in);
+}
+
+size_t ZlibByteSource::read(char* buf, size_t maxBytes)
+{
+  int n = gzread(in, buf, std::min(maxBytes, (size_t) INT_MAX));
+  if (n < 0) {
+    int errnum;
+    const char* msg = gzerror(in, &errnum);
+    cerr << "ERROR: couldn't read " << fileName << ": "
+	 << ((Z_ERRNO == errnum) ? strerror(errno) : msg) << endl;
+    exit(EXIT_FAILURE);
+  }
+  return n;
+}
+
+/***************************************************************************
+ * ByteSource
+ ***************************************************************************/
+
+void ByteSource::readAll(std::vector<char>& result)
+{
+  size_t n;
+  do {
+    size_t oldSize = result.size();
+    result.resize(oldSize + BS_CHUNK_BYTES);
+    n = read(&result[oldSize], BS_CHUNK_BYTES);
+    result.resize(oldSize + n);
+  } while (n > 0);
+}
+
+ByteSource* ByteSource::open(const std::string& fileName)
+{
+  return new ZlibByteSource(fileName);
+}
+
+bool ByteSource::isPlainFile(const std::string& fileName)
+{
+  if (fileName == "-" || hasCompressionExtension(fileName)) {
+    return false;
+  }
+  // if stat() fails, let the caller report the error when it opens the file
+  struct stat statBuf;
+  if (0 == stat(fileName.c_str(), &statBuf) && !S_ISREG(statBuf.st_mode)) {
+    return false;
+  }
+  return true;
+}
+
+std::string ByteSource::stripCompressionExtension(const std::string& fileName)
+{
+  if (hasCompressionExtension(fileName)) {
+    return fileName.substr(0, fileName.size()-3);
+  } else {
+    return fileName;
+  }
+}
+
+/***************************************************************************
+ * ByteSourceBuf
+ ***************************************************************************/
+
+ByteSourceBuf::ByteSourceBuf(ByteSource* _source) :
+  source(_source),
+  buffer(BS_CHUNK_BYTES)
+{
+  setg(&buffer[0], &buffer[0], &buffer[0]);
+}
+
+ByteSourceBuf::int_type ByteSourceBuf::underflow(void)
+{
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  size_t n = source->read(&buffer[0], buffer.size());
+  if (0 == n) {
+    return traits_type::eof();
+  }
+  setg(&buffer[0], &buffer[0], &buffer[0] + n);
+  return traits_type::to_int_type(*gptr());
+}
+
+/***************************************************************************
+ * ByteSourceFile
+ ***************************************************************************/
+
+ByteSourceFile::ByteSourceFile(const std::string& fileName) :
+  fp(NULL),
+  source(NULL),
+  writeFd(-1),
+  threadRunning(false)
+{
+  if (ByteSource::isPlainFile(fileName)) {
+    // may be NULL; the caller reports the error
+    fp = fopen(fileName.c_str(), "r");
+    return;
+  }
+
+  source = ByteSource::open(fileName);
+  int fds[2];
+  if (0 != pipe(fds)) {
+    cerr << "ERROR: couldn't create a pipe to read " << fileName << ": "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  fp = fdopen(fds[0], "r");
+  writeFd = fds[1];
+  if (0 != pthread_create(&thread, NULL, &ByteSourceFile::threadMain, this)) {
+    cerr << "ERROR: couldn't start thread to read " << fileName << endl;
+    exit(EXIT_FAILURE);
+  }
+  threadRunning = true;
+}
+
+ByteSourceFile::~ByteSourceFile(void)
+{
+  if (NULL != fp) {
+    // if the reader stopped early, the writer sees EPIPE and finishes
+    fclose(fp);
+  }
+  if (threadRunning) {
+    pthread_join(thread, NULL);
+  }
+  delete source;
+}
+
+void* ByteSourceFile::threadMain(void* arg)
+{
+  ByteSourceFile* x = (ByteSourceFile*) arg;
+
+  // report a closed pipe as EPIPE rather than killing the process
+  sigset_t pipeSet;
+  sigemptyset(&pipeSet);
+  sigaddset(&pipeSet, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipeSet, NULL);
+
+  std::vector<char> buf(BS_CHUNK_BYTES);
+  size_t n;
+  while (0 != (n = x->source->read(&buf[0], buf.size()))) {
+    const char* c = &buf[0];
+    while (n > 0) {
+      ssize_t written = write(x->writeFd, c, n);
+      if (written < 0) {
+	if (EINTR == errno) continue;
+	goto done;
+      }
+      c += written;
+      n -= written;
+    }
+  }
+ done:
+  close(x->writeFd);
+  return NULL;
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
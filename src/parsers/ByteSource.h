@@ -0,0 +1,105 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    ByteSource.h
+ @brief   Pluggable sources for the bytes of a model file.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCByteSource_h
+#define INCByteSource_h
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace zmdp {
+
+// A ByteSource supplies the text of a model to the parsers.  The model
+// filename selects the source:
+//
+//   '-'         standard input, so a model generator can be piped
+//               directly into zmdp.  The stream may be gzip-compressed.
+//   '*.gz'      a gzip-compressed file, decompressed as it is read.
+//   otherwise   a file.  Named pipes and process substitutions such as
+//               '<(gen_RockSample_7_8)' are streamed like standard input.
+//
+// Regular uncompressed files are still read directly by the parsers
+// (possibly memory-mapped); see isPlainFile().
+struct ByteSource {
+  std::string fileName;
+
+  virtual ~ByteSource(void) {}
+
+  // reads up to maxBytes into buf and returns the number of bytes read,
+  // or 0 at the end of the stream.  exits with an error message if the
+  // read fails.
+  virtual size_t read(char* buf, size_t maxBytes) = 0;
+
+  // appends the rest of the stream to result
+  void readAll(std::vector<char>& result);
+
+  // opens the source for fileName; exits with an error message on failure
+  static ByteSource* open(const std::string& fileName);
+  // true if fileName is a regular file that is not compressed
+  static bool isPlainFile(const std::string& fileName);
+  // removes a compression extension ('.gz'), so that the extension of
+  // the underlying model file can be checked
+  static std::string stripCompressionExtension(const std::string& fileName);
+};
+
+// Adapts a ByteSource for parsers that read an istream.
+struct ByteSourceBuf : public std::streambuf {
+  ByteSourceBuf(ByteSource* _source);
+
+protected:
+  ByteSource* source;
+  std::vector<char> buffer;
+
+  int_type underflow(void);
+};
+
+// Adapts a ByteSource for parsers that read a stdio FILE*.  Unless the
+// source is standard input or a plain file, a background thread copies
+// the stream through a pipe.
+struct ByteSourceFile {
+  FILE* fp;
+
+  ByteSourceFile(const std::string& fileName);
+  ~ByteSourceFile(void);
+
+protected:
+  ByteSource* source;
+  int writeFd;
+  pthread_t thread;
+  bool threadRunning;
+
+  static void* threadMain(void* arg);
+};
+
+}; // namespace zmdp
+
+#endif // INCByteSource_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,149 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    CSCBuilder.cc
+ @brief   Builds compressed-column matrices from coordinate entries in linear time.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "zmdpCommonDefs.h"
+#include "CSCBuilder.h"
+
+using namespace std;
+
+namespace zmdp {
+
+struct CSCIndexCompare {
+  bool operator()(const cvector_entry& lhs, const cvector_entry& rhs) const {
+    return lhs.index < rhs.index;
+  }
+};
+
+CSCBuilder::CSCBuilder(void) :
+  size1_(0),
+  size2_(0)
+{}
+
+CSCBuilder::CSCBuilder(unsigned int _size1, unsigned int _size2) :
+  size1_(_size1),
+  size2_(_size2)
+{}
+
+void CSCBuilder::resize(unsigned int _size1, unsigned int _size2)
+{
+  clear();
+  size1_ = _size1;
+  size2_ = _size2;
+}
+
+void CSCBuilder::push_back(unsigned int r, unsigned int c, double value)
+{
+  owned.push_back(kmatrix_entry(r, c, value));
+}
+
+void CSCBuilder::addEntries(const std::vector<kmatrix_entry>& entries)
+{
+  parts.push_back(&entries);
+}
+
+void CSCBuilder::build(cmatrix& result) const
+{
+  buildInternal(result, /* transpose = */ false);
+}
+
+void CSCBuilder::buildTranspose(cmatrix& result) const
+{
+  buildInternal(result, /* transpose = */ true);
+}
+
+void CSCBuilder::clear(void)
+{
+  std::vector<kmatrix_entry>().swap(owned);
+  parts.clear();
+}
+
+void CSCBuilder::buildInternal(cmatrix& result, bool transpose) const
+{
+  unsigned int rsize1 = transpose ? size2_ : size1_;
+  unsigned int rsize2 = transpose ? size1_ : size2_;
+
+  std::vector<const std::vector<kmatrix_entry>*> all(parts);
+  all.push_back(&owned);
+
+  // count the entries in each column
+  std::vector<unsigned int> colStarts(rsize2+1, 0);
+  FOR_EACH (pi, all) {
+    FOR_EACH (ei, **pi) {
+      unsigned int c = transpose ? ei->r : ei->c;
+      assert(c < rsize2);
+      colStarts[c+1]++;
+    }
+  }
+  FOR (c, rsize2) {
+    colStarts[c+1] += colStarts[c];
+  }
+
+  // scatter the entries into their columns, preserving the order in
+  // which they were added
+  std::vector<cvector_entry> sorted(colStarts[rsize2]);
+  std::vector<unsigned int> next(colStarts.begin(), colStarts.end()-1);
+  FOR_EACH (pi, all) {
+    FOR_EACH (ei, **pi) {
+      if (transpose) {
+	sorted[next[ei->r]++] = cvector_entry(ei->c, ei->value);
+      } else {
+	sorted[next[ei->c]++] = cvector_entry(ei->r, ei->value);
+      }
+    }
+  }
+
+  // sort each column by row (usually a no-op, since most models list
+  // entries in order), then keep the last of each run of duplicates
+  result.resize(rsize1, rsize2);
+  result.data.reserve(sorted.size());
+  FOR (c, rsize2) {
+    typeof(sorted.begin()) colBegin = sorted.begin() + colStarts[c];
+    typeof(sorted.begin()) colEnd = sorted.begin() + colStarts[c+1];
+    for (typeof(colBegin) ci = colBegin; ci != colEnd; ci++) {
+      if (ci+1 != colEnd && (ci+1)->index < ci->index) {
+	std::stable_sort(colBegin, colEnd, CSCIndexCompare());
+	break;
+      }
+    }
+    for (typeof(colBegin) ci = colBegin; ci != colEnd; ci++) {
+      if (ci+1 != colEnd && (ci+1)->index == ci->index) continue;
+      if (fabs(ci->value) > SPARSE_EPS) {
+	assert(ci->index < rsize1);
+	result.data.push_back(*ci);
+      }
+    }
+    result.col_starts[c+1] = result.data.size();
+  }
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
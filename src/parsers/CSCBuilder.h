@@ -0,0 +1,81 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    CSCBuilder.h
+ @brief   Builds compressed-column matrices from coordinate entries in linear time.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCCSCBuilder_h
+#define INCCSCBuilder_h
+
+#include <vector>
+
+#include "sla.h"
+
+using namespace sla;
+
+namespace zmdp {
+
+// Collects coordinate entries and produces a cmatrix (and/or its
+// transpose) with a counting sort over columns, instead of the
+// O(nnz log nnz) stable sort in kmatrix::canonicalize().  The result is
+// the same as adding the entries to a kmatrix and calling
+// copy(cmatrix&, kmatrix&): among entries with the same coordinates the
+// last one added wins, and entries with |value| <= SPARSE_EPS are
+// dropped.  Building both a matrix and its transpose from the same
+// entries avoids materializing the kmatrix twice.
+struct CSCBuilder {
+  CSCBuilder(void);
+  CSCBuilder(unsigned int _size1, unsigned int _size2);
+
+  // discards all entries and sets the dimensions of the matrix to build
+  void resize(unsigned int _size1, unsigned int _size2);
+
+  // adds an entry owned by the builder
+  void push_back(unsigned int r, unsigned int c, double value);
+
+  // adds a run of entries without copying them; the vector must outlive
+  // any call to build() or buildTranspose().  entries added with
+  // push_back() count as coming after all the runs.
+  void addEntries(const std::vector<kmatrix_entry>& entries);
+
+  // result = A
+  void build(cmatrix& result) const;
+
+  // result = A'
+  void buildTranspose(cmatrix& result) const;
+
+  void clear(void);
+
+protected:
+  unsigned int size1_, size2_;
+  std::vector<kmatrix_entry> owned;
+  std::vector<const std::vector<kmatrix_entry>*> parts;
+
+  void buildInternal(cmatrix& result, bool transpose) const;
+};
+
+}; // namespace zmdp
+
+#endif // INCCSCBuilder_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -29,6 +29,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <sys/time.h>
+#include <sys/resource.h>
 
 #include <iostream>
 #include <fstream>
@@ -39,22 +40,137 @@ using namespace std;
 
 namespace zmdp {
 
+static void releaseMatrix(cmatrix& A)
+{
+  std::vector<unsigned int>().swap(A.col_starts);
+  std::vector<cvector_entry>().swap(A.data);
+}
+
 CassandraModel::CassandraModel(void) :
   numStates(-1),
-  numObservations(-1)
+  numObservations(-1),
+  actionSource(NULL),
+  lazyMemoryBudget(0),
+  lazyUseCounter(0),
+  lazyResidentBytes(0),
+  lazyNumLoads(0),
+  lazyNumEvictions(0)
 {}
 
+CassandraModel::~CassandraModel(void)
+{
+  if (NULL != actionSource) {
+    delete actionSource;
+  }
+}
+
+void CassandraModel::setActionSource(ActionMatrixSource* source)
+{
+  actionSource = source;
+  T.clear();
+  Ttr.clear();
+  O.clear();
+  T.resize(numActions);
+  Ttr.resize(numActions);
+  if (-1 != numObservations) {
+    O.resize(numActions);
+  }
+  actionLoaded.assign(numActions, 0);
+  actionLastUse.assign(numActions, 0);
+  lazyResidentBytes = 0;
+}
+
+void CassandraModel::setLazyMemoryBudget(size_t memoryBudgetBytes)
+{
+  lazyMemoryBudget = memoryBudgetBytes;
+}
+
+void CassandraModel::initLazyLoading(const ZMDPConfig& config)
+{
+  if (!isLazy()) {
+    fprintf(stderr, "ERROR: %s: useLazyModelLoading requires a binary model (.pomdpb or .mdpb); "
+	    "generate one with 'zmdp convert'\n", fileName.c_str());
+    exit(EXIT_FAILURE);
+  }
+  double budgetMB = config.getDouble("lazyModelMemoryBudgetMB");
+  if (budgetMB > 0 && (config.getInt("numSearchThreads") > 1
+		       || config.getInt("numEvaluationThreads") > 1)) {
+    // other search or evaluation threads may be using an action's
+    // matrices while they are evicted
+    fprintf(stderr, "WARNING: lazyModelMemoryBudgetMB is ignored when numSearchThreads > 1 "
+	    "or numEvaluationThreads > 1; matrices will be loaded on demand but never evicted\n");
+    budgetMB = 0;
+  }
+  setLazyMemoryBudget((size_t) (budgetMB * (1 << 20)));
+}
+
+void CassandraModel::loadAction(int a) const
+{
+  ZMDPMutexGuard g(lazyLock);
+  if (actionLoaded[a]) return; // another thread got here first
+
+  size_t needed = actionSource->getActionBytes(a);
+  if (lazyMemoryBudget > 0) {
+    // evict least recently used actions until the new one fits
+    while (lazyResidentBytes + needed > lazyMemoryBudget) {
+      int lru = -1;
+      FOR (b, numActions) {
+	if (actionLoaded[b] && (int) b != a
+	    && (-1 == lru || actionLastUse[b] < actionLastUse[lru])) {
+	  lru = b;
+	}
+      }
+      if (-1 == lru) break;
+      evictAction(lru);
+    }
+  }
+
+  CassandraModel* self = const_cast<CassandraModel*>(this);
+  cmatrix dummyO;
+  actionSource->readAction(a, self->T[a], self->Ttr[a],
+			   (-1 != numObservations) ? self->O[a] : dummyO);
+  lazyResidentBytes += needed;
+  lazyNumLoads++;
+  if (zmdpDebugLevelG >= 2) {
+    printf("lazy model: loaded action %d (%lu bytes resident)\n",
+	   a, (unsigned long) lazyResidentBytes);
+  }
+  __atomic_store_n(&actionLoaded[a], 1, __ATOMIC_RELEASE);
+}
+
+// the caller must hold lazyLock
+void CassandraModel::evictAction(int a) const
+{
+  CassandraModel* self = const_cast<CassandraModel*>(this);
+  __atomic_store_n(&actionLoaded[a], 0, __ATOMIC_RELEASE);
+  releaseMatrix(self->T[a]);
+  releaseMatrix(self->Ttr[a]);
+  if (-1 != numObservations) {
+    releaseMatrix(self->O[a]);
+  }
+  lazyResidentBytes -= actionSource->getActionBytes(a);
+  lazyNumEvictions++;
+  if (zmdpDebugLevelG >= 2) {
+    printf("lazy model: evicted action %d\n", a);
+  } else if (zmdpDebugLevelG >= 1 && 1 == lazyNumEvictions) {
+    printf("lazy model: reached memory budget, evicting least recently used actions\n");
+  }
+}
+
 void CassandraModel::checkForTerminalStates(void)
 {
   if (zmdpDebugLevelG >= 1) {
     printf("model initialization -- marking zero-reward absorbing states as terminal\n");
   }
   isTerminalState.resize(numStates, /* initialValue = */ true);
-  FOR (s, numStates) {
-    FOR (a, numActions) {
-      if ((fabs(1.0 - T[a](s,s)) > OBS_IS_ZERO_EPS) || R(s,a) != 0.0) {
+  // actions in the outer loop so that a lazily loaded model reads each
+  // action's matrices only once
+  FOR (a, numActions) {
+    const cmatrix& Ta = getT(a);
+    FOR (s, numStates) {
+      if (isTerminalState[s]
+	  && ((fabs(1.0 - Ta(s,s)) > OBS_IS_ZERO_EPS) || R(s,a) != 0.0)) {
 	isTerminalState[s] = false;
-	break;
       }
     }
   }
@@ -62,6 +178,12 @@ void CassandraModel::checkForTerminalStates(void)
 
 void CassandraModel::debugDensity(void)
 {
+  if (isLazy()) {
+    cout << "(lazy model: T and O density not computed until matrices are loaded)"
+	 << endl;
+    return;
+  }
+
   double T_size = -1, T_filled = -1;
   double O_size = -1, O_filled = -1;
 
@@ -89,6 +211,18 @@ void CassandraModel::debugDensity(void)
   }
 }
 
+// the peak is for the whole process, but since models are read at
+// startup it is dominated by the parser's intermediate data structures
+void CassandraModel::debugPeakMemory(void)
+{
+  struct rusage usage;
+  if (0 == getrusage(RUSAGE_SELF, &usage)) {
+    // ru_maxrss is reported in kilobytes on Linux
+    cout << "peak resident memory after reading model = "
+	 << (usage.ru_maxrss / 1024.0) << " MB" << endl;
+  }
+}
+
 }; // namespace zmdp
 
 /***************************************************************************
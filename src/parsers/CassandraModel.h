@@ -29,15 +29,29 @@
 
 #include "sla.h"
 #include "MDPModel.h"
+#include "zmdpThreads.h"
+#include "zmdpConfig.h"
 
 using namespace sla;
 
 namespace zmdp {
 
+// Supplies the per-action matrices of a lazily loaded model on demand.
+struct ActionMatrixSource {
+  virtual ~ActionMatrixSource(void) {}
+
+  // reads T[a], Ttr[a], and (for POMDPs) O[a]
+  virtual void readAction(int a, cmatrix& T, cmatrix& Ttr, cmatrix& O) = 0;
+
+  // memory needed to hold the matrices for action a, in bytes
+  virtual size_t getActionBytes(int a) = 0;
+};
+
 struct CassandraModel : public MDP {
   int numStates, numObservations;
 
   CassandraModel(void);
+  virtual ~CassandraModel(void);
 
   // initialState -- for MDPs
   state_vector initialState;
@@ -53,10 +67,80 @@ struct CassandraModel : public MDP {
   // maxHorizon: see main/zmdp.config for an explanation
   int maxHorizon;
 
+  // Use these accessors rather than indexing T, Ttr, and O directly;
+  // with a lazily loaded model they read the action's matrices on first
+  // use.  If a memory budget is set, the returned reference is valid
+  // until the next call with a different action.
+  const cmatrix& getT(int a) const;
+  const cmatrix& getTtr(int a) const;
+  const cmatrix& getO(int a) const;
+
+  // Switches to lazy loading: T, Ttr, and O start out empty and each
+  // action's matrices are read from source on first use.  If
+  // memoryBudgetBytes is positive, the least recently used actions are
+  // evicted to keep the loaded matrices within the budget (but the
+  // action being accessed is always loaded).  Takes ownership of source.
+  void setActionSource(ActionMatrixSource* source);
+  void setLazyMemoryBudget(size_t memoryBudgetBytes);
+  // applies the lazyModelMemoryBudgetMB config setting after the model
+  // has been read with lazy loading enabled
+  void initLazyLoading(const ZMDPConfig& config);
+  bool isLazy(void) const { return NULL != actionSource; }
+  // true if references returned by the accessors may be invalidated by
+  // accesses to other actions
+  bool canEvictActions(void) const { return isLazy() && lazyMemoryBudget > 0; }
+
   void checkForTerminalStates(void);
   void debugDensity(void);
+  void debugPeakMemory(void);
+
+protected:
+  ActionMatrixSource* actionSource;
+  size_t lazyMemoryBudget;
+  // these change as actions are loaded and evicted, even through const
+  // accessors
+  mutable std::vector<int> actionLoaded;
+  mutable std::vector<long long> actionLastUse;
+  mutable long long lazyUseCounter;
+  mutable size_t lazyResidentBytes;
+  mutable int lazyNumLoads, lazyNumEvictions;
+  mutable ZMDPMutex lazyLock;
+
+  void ensureActionLoaded(int a) const;
+  void loadAction(int a) const;
+  void evictAction(int a) const;
 };
 
+inline void CassandraModel::ensureActionLoaded(int a) const
+{
+  if (NULL != actionSource) {
+    if (!__atomic_load_n(&actionLoaded[a], __ATOMIC_ACQUIRE)) {
+      loadAction(a);
+    }
+    __atomic_store_n(&actionLastUse[a],
+		     __atomic_add_fetch(&lazyUseCounter, 1, __ATOMIC_RELAXED),
+		     __ATOMIC_RELAXED);
+  }
+}
+
+inline const cmatrix& CassandraModel::getT(int a) const
+{
+  ensureActionLoaded(a);
+  return T[a];
+}
+
+inline const cmatrix& CassandraModel::getTtr(int a) const
+{
+  ensureActionLoaded(a);
+  return Ttr[a];
+}
+
+inline const cmatrix& CassandraModel::getO(int a) const
+{
+  ensureActionLoaded(a);
+  return O[a];
+}
+
 }; // namespace zmdp
 
 #endif // INCCassandraModel_h
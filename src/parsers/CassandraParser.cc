@@ -38,6 +38,8 @@
 #include "MatrixUtils.h"
 #include "slaMatrixUtils.h"
 #include "sla_cassandra.h"
+#include "CSCBuilder.h"
+#include "ByteSource.h"
 #include "CassandraParser.h"
 
 using namespace std;
@@ -58,6 +60,20 @@ void CassandraParser::readPomdpFromFile(CassandraModel& pomdp, const std::string
   readModelFromFile(pomdp, /* expectPomdp = */ true);
 }
 
+// builder = A, where A is one of the row-compressed matrices in Cassandra's
+// library
+static void addCassandraEntries(CSCBuilder& builder, CassandraMatrix A)
+{
+  FOR (r, A->num_rows) {
+    int rowOffset = A->row_start[r];
+    int rowSize = A->row_length[r];
+    FOR (i, rowSize) {
+      int j = rowOffset + i;
+      builder.push_back(r, A->col[j], A->mat_val[j]);
+    }
+  }
+}
+
 // This macro is a pure pass-through. I just use it to make clear
 // that the argument is a global variable declared in Tony Cassandra's
 // code base.
@@ -73,9 +89,19 @@ void CassandraParser::readModelFromFile(CassandraModel& p,
   }
 
   // this is the main call to Tony Cassandra's parsing code
-  if (! readMDP(const_cast<char *>(p.fileName.c_str())) ) {
-    // error messages should already have been printed
-    exit(EXIT_FAILURE);
+  if (ByteSource::isPlainFile(p.fileName)) {
+    if (! readMDP(const_cast<char *>(p.fileName.c_str())) ) {
+      // error messages should already have been printed
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    // standard input, a pipe, or a compressed file
+    ByteSourceFile in(p.fileName);
+    if (! readMDPFile(in.fp) ) {
+      fprintf(stderr, "MDP file '%s' was not successfully parsed!\n",
+	      p.fileName.c_str());
+      exit(EXIT_FAILURE);
+    }
   }
 
   // from here forward, we're converting the model from the data structures in
@@ -89,28 +115,29 @@ void CassandraParser::readModelFromFile(CassandraModel& p,
     p.numObservations = -1;
   }
 
-  // convert R to sla format
-  kmatrix Rk;
-  copy(Rk, CASSANDRA_GLOBAL(Q), p.numStates);
-  kmatrix_transpose_in_place(Rk);
-  copy(p.R, Rk);
+  // convert R to sla format (Q is indexed by (a,s))
+  CSCBuilder builder(p.numActions, p.numStates);
+  addCassandraEntries(builder, CASSANDRA_GLOBAL(Q));
+  builder.buildTranspose(p.R);
 
   // convert T, Tr, and O to sla format
-  kmatrix Tk;
   p.T.resize(p.numActions);
   p.Ttr.resize(p.numActions);
   if (expectPomdp) {
     p.O.resize(p.numActions);
   }
   FOR (a, p.numActions) {
-    copy(Tk, CASSANDRA_GLOBAL(P[a]), p.numStates);
-    copy(p.T[a], Tk);
-    kmatrix_transpose_in_place(Tk);
-    copy(p.Ttr[a], Tk);
+    builder.resize(p.numStates, p.numStates);
+    addCassandraEntries(builder, CASSANDRA_GLOBAL(P[a]));
+    builder.build(p.T[a]);
+    builder.buildTranspose(p.Ttr[a]);
     if (expectPomdp) {
-      copy(p.O[a], CASSANDRA_GLOBAL(::R[a]), p.numObservations);
+      builder.resize(p.numStates, p.numObservations);
+      addCassandraEntries(builder, CASSANDRA_GLOBAL(::R[a]));
+      builder.build(p.O[a]);
     }
   }
+  builder.clear();
 
   if (expectPomdp) {
     // convert initialBelief to sla format
@@ -135,6 +162,7 @@ void CassandraParser::readModelFromFile(CassandraModel& p,
     cout << "[file reading took " << numSeconds << " seconds]" << endl;
     
     p.debugDensity();
+    p.debugPeakMemory();
   }
 
   // destroy intermediate data structures in Tony Cassandra's library
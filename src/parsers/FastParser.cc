@@ -28,15 +28,24 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 
 #include "zmdpCommonDefs.h"
 #include "MatrixUtils.h"
 #include "slaMatrixUtils.h"
 #include "sla_cassandra.h"
+#include "CSCBuilder.h"
+#include "ByteSource.h"
 #include "FastParser.h"
 
 #define POMDP_READ_ERROR_EPS (1e-10)
@@ -60,10 +69,325 @@ static void trimTrailingWhiteSpace(char *s)
   s[i+1] = '\0';
 }
 
+/***************************************************************************
+ * MAPPED FILE SCANNER
+ *
+ * These functions mirror the sscanf() formats used by
+ * readModelFromStream(), but work directly on the (not null-terminated)
+ * mapped file and avoid the locale and format-string overhead of sscanf.
+ ***************************************************************************/
+
+// the parse state for one chunk of the model body.  entries are kept in
+// file order so that duplicate entries resolve the same way as in the
+// stream reader (the last one wins).
+struct FPChunk {
+  const char* begin;
+  const char* end;
+  const CassandraModel* p;
+  bool expectPomdp;
+
+  int numLines;
+  int errorLine; // line within the chunk (starting at 1), or 0 if no error
+  std::string errorMessage;
+
+  std::vector<kmatrix_entry> R;
+  std::vector< std::vector<kmatrix_entry> > T, O;
+};
+
+// powers of ten that are exactly representable as doubles
+static const double fpPow10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline void fpSkipSpace(const char*& c, const char* end)
+{
+  while (c != end && isspace(*c)) c++;
+}
+
+static inline bool fpScanChar(const char*& c, const char* end, char ch)
+{
+  fpSkipSpace(c, end);
+  if (c != end && ch == *c) {
+    c++;
+    return true;
+  }
+  return false;
+}
+
+static inline bool fpScanInt(const char*& c, const char* end, int& result)
+{
+  fpSkipSpace(c, end);
+  bool neg = false;
+  if (c != end && ('-' == *c || '+' == *c)) {
+    neg = ('-' == *c);
+    c++;
+  }
+  if (c == end || !isdigit(*c)) return false;
+  long long val = 0;
+  for (; c != end && isdigit(*c); c++) {
+    val = 10*val + (*c - '0');
+    if (val > INT_MAX) return false;
+  }
+  result = neg ? -val : val;
+  return true;
+}
+
+// Numbers with at most 15 significant digits and a decimal exponent of
+// magnitude at most 22 are converted with a single correctly rounded
+// multiply or divide (Clinger's fast path), which gives the same result
+// as strtod.  Anything else (long mantissas, large exponents, inf, nan,
+// hex floats) falls back to strtod on a null-terminated copy of the
+// token.
+static bool fpScanDouble(const char*& c, const char* end, double& result)
+{
+  fpSkipSpace(c, end);
+  const char* start = c;
+  const char* q = c;
+
+  bool neg = false;
+  if (q != end && ('-' == *q || '+' == *q)) {
+    neg = ('-' == *q);
+    q++;
+  }
+
+  unsigned long long mantissa = 0;
+  int numDigits = 0;
+  int exp10 = 0;
+  bool sawDigit = false;
+  bool exact = true;
+  for (; q != end && isdigit(*q); q++) {
+    sawDigit = true;
+    if (0 != mantissa || '0' != *q) {
+      if (++numDigits > 15) exact = false;
+      else mantissa = 10*mantissa + (*q - '0');
+    }
+  }
+  if (q != end && '.' == *q) {
+    q++;
+    for (; q != end && isdigit(*q); q++) {
+      sawDigit = true;
+      if (0 != mantissa || '0' != *q) {
+	if (++numDigits > 15) exact = false;
+	else mantissa = 10*mantissa + (*q - '0');
+      }
+      exp10--;
+    }
+  }
+  if (!sawDigit) exact = false;
+  if (exact && q != end && ('e' == *q || 'E' == *q)) {
+    const char* e = q+1;
+    bool expNeg = false;
+    if (e != end && ('-' == *e || '+' == *e)) {
+      expNeg = ('-' == *e);
+      e++;
+    }
+    if (e != end && isdigit(*e)) {
+      int expVal = 0;
+      for (; e != end && isdigit(*e); e++) {
+	if (expVal < 10000) expVal = 10*expVal + (*e - '0');
+      }
+      exp10 += expNeg ? -expVal : expVal;
+      q = e;
+    }
+  }
+  if (q != end && (isalnum(*q) || '.' == *q)) exact = false;
+
+  if (exact && -22 <= exp10 && exp10 <= 22) {
+    double val = (double) mantissa;
+    val = (exp10 < 0) ? (val / fpPow10[-exp10]) : (val * fpPow10[exp10]);
+    result = neg ? -val : val;
+    c = q;
+    return true;
+  }
+
+  char tok[512];
+  int n = 0;
+  for (q = start; q != end && !isspace(*q) && n < (int) sizeof(tok)-1; q++) {
+    tok[n++] = *q;
+  }
+  tok[n] = '\0';
+  char* tokEnd;
+  result = strtod(tok, &tokEnd);
+  if (tokEnd == tok) return false;
+  c = start + (tokEnd - tok);
+  return true;
+}
+
+static bool fpCheckRange(FPChunk& ch, const char* stmt, const char* what,
+			 int val, int size)
+{
+  if (0 <= val && val < size) return true;
+  std::ostringstream msg;
+  msg << what << " index " << val << " out of range in " << stmt
+      << " statement (expected 0.." << (size-1) << ")";
+  ch.errorMessage = msg.str();
+  return false;
+}
+
+// parses one body statement in the range [c,end), which has already been
+// stripped of trailing white space.  returns false and fills in
+// ch.errorMessage on error.
+static bool fpParseBodyLine(FPChunk& ch, const char* c, const char* end)
+{
+  const CassandraModel& p = *ch.p;
+  int a, s, sp, o;
+  double val;
+
+  if (end - c >= 2 && ':' == c[1]) {
+    switch (c[0]) {
+    case 'R':
+      c += 2;
+      if (fpScanInt(c, end, a) && fpScanChar(c, end, ':')
+	  && fpScanInt(c, end, s) && fpScanChar(c, end, ':')
+	  && fpScanChar(c, end, '*')
+	  && (!ch.expectPomdp || (fpScanChar(c, end, ':')
+				  && fpScanChar(c, end, '*')))
+	  && fpScanDouble(c, end, val)) {
+	if (!fpCheckRange(ch, "R", "action", a, p.numActions)) return false;
+	if (!fpCheckRange(ch, "R", "state", s, p.numStates)) return false;
+	ch.R.push_back(kmatrix_entry(s, a, val));
+	return true;
+      }
+      ch.errorMessage = std::string("syntax error in R statement\n")
+	+ "  (expected format is '"
+	+ (ch.expectPomdp
+	   ? "R: %d : %d : * : * %lf"
+	   : "R: %d : %d : * %lf")
+	+ "')";
+      return false;
+
+    case 'T':
+      c += 2;
+      if (fpScanInt(c, end, a) && fpScanChar(c, end, ':')
+	  && fpScanInt(c, end, s) && fpScanChar(c, end, ':')
+	  && fpScanInt(c, end, sp) && fpScanDouble(c, end, val)) {
+	if (!fpCheckRange(ch, "T", "action", a, p.numActions)) return false;
+	if (!fpCheckRange(ch, "T", "state", s, p.numStates)) return false;
+	if (!fpCheckRange(ch, "T", "state", sp, p.numStates)) return false;
+	ch.T[a].push_back(kmatrix_entry(s, sp, val));
+	return true;
+      }
+      ch.errorMessage = "syntax error in T statement";
+      return false;
+
+    case 'O':
+      if (!ch.expectPomdp) {
+	ch.errorMessage = "got unexpected 'O' statement in MDP";
+	return false;
+      }
+      c += 2;
+      if (fpScanInt(c, end, a) && fpScanChar(c, end, ':')
+	  && fpScanInt(c, end, s) && fpScanChar(c, end, ':')
+	  && fpScanInt(c, end, o) && fpScanDouble(c, end, val)) {
+	if (!fpCheckRange(ch, "O", "action", a, p.numActions)) return false;
+	if (!fpCheckRange(ch, "O", "state", s, p.numStates)) return false;
+	if (!fpCheckRange(ch, "O", "observation", o, p.numObservations)) return false;
+	ch.O[a].push_back(kmatrix_entry(s, o, val));
+	return true;
+      }
+      ch.errorMessage = "syntax error in O statement";
+      return false;
+    }
+  }
+
+  ch.errorMessage = "got unexpected statement type while parsing body";
+  return false;
+}
+
+static void* fpParseChunk(void* arg)
+{
+  FPChunk& ch = *((FPChunk*) arg);
+  const char* c = ch.begin;
+  while (c != ch.end) {
+    const char* lineEnd = (const char*) memchr(c, '\n', ch.end - c);
+    if (NULL == lineEnd) lineEnd = ch.end;
+    ch.numLines++;
+
+    const char* stmtEnd = lineEnd;
+    while (stmtEnd != c && isspace(stmtEnd[-1])) stmtEnd--;
+    if ('#' != *c && stmtEnd != c) {
+      if (!fpParseBodyLine(ch, c, stmtEnd)) {
+	ch.errorLine = ch.numLines;
+	return NULL;
+      }
+    }
+
+    c = (lineEnd == ch.end) ? ch.end : (lineEnd+1);
+  }
+  return NULL;
+}
+
+// the per-action matrix construction is spread over the same threads that
+// parsed the body
+struct FPBuildJob {
+  CassandraModel* p;
+  std::vector<FPChunk>* chunks;
+  bool expectPomdp;
+  int nextAction;
+};
+
+static void* fpBuildActions(void* arg)
+{
+  FPBuildJob& job = *((FPBuildJob*) arg);
+  CassandraModel& p = *job.p;
+  std::vector<FPChunk>& chunks = *job.chunks;
+  CSCBuilder builder;
+
+  while (1) {
+    int a = __sync_fetch_and_add(&job.nextAction, 1);
+    if (a >= p.numActions) break;
+
+    builder.resize(p.numStates, p.numStates);
+    FOR (k, chunks.size()) builder.addEntries(chunks[k].T[a]);
+    builder.build(p.T[a]);
+    builder.buildTranspose(p.Ttr[a]);
+    FOR (k, chunks.size()) std::vector<kmatrix_entry>().swap(chunks[k].T[a]);
+
+    if (job.expectPomdp) {
+      builder.resize(p.numStates, p.numObservations);
+      FOR (k, chunks.size()) builder.addEntries(chunks[k].O[a]);
+      builder.build(p.O[a]);
+      FOR (k, chunks.size()) std::vector<kmatrix_entry>().swap(chunks[k].O[a]);
+    }
+  }
+  return NULL;
+}
+
+// runs f on each of the args, using the current thread for the first one
+static void fpRunThreads(void* (*f)(void*), const std::vector<void*>& args)
+{
+  std::vector<pthread_t> threads(args.size());
+  for (unsigned int i=1; i < args.size(); i++) {
+    int err = pthread_create(&threads[i], NULL, f, args[i]);
+    if (0 != err) {
+      cerr << "ERROR: couldn't create parser thread: " << strerror(err) << endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  (*f)(args[0]);
+  for (unsigned int i=1; i < args.size(); i++) {
+    pthread_join(threads[i], NULL);
+  }
+}
+
 /***************************************************************************
  * POMDP FUNCTIONS
  ***************************************************************************/
 
+FPPreambleState::FPPreambleState(void) :
+  discountSet(false),
+  valuesSet(false),
+  numStatesSet(false),
+  numActionsSet(false),
+  numObservationsSet(false),
+  startSet(false)
+{}
+
+FastParser::FastParser(int _numThreads) :
+  numThreads(_numThreads)
+{}
+
 void FastParser::readGenericDiscreteMDPFromFile(CassandraModel& mdp,
 						const std::string& _fileName)
 {
@@ -80,24 +404,45 @@ void FastParser::readPomdpFromFile(CassandraModel& pomdp, const std::string& _fi
 void FastParser::readModelFromFile(CassandraModel& problem,
 				   bool expectPomdp)
 {
-  ifstream in;
-
   timeval startTime, endTime;
   if (zmdpDebugLevelG >= 1) {
-    cout << "reading problem (in fast mode) from " << problem.fileName << endl;
+    cout << "reading problem (in fast mode";
+    if (numThreads >= 1) {
+      cout << ", mapped with " << numThreads << " threads";
+    }
+    cout << ") from " << problem.fileName << endl;
     gettimeofday(&startTime,0);
   }
 
-  in.open(problem.fileName.c_str());
-  if (!in) {
-    cerr << "ERROR: couldn't open " << problem.fileName << " for reading: "
-	 << strerror(errno) << endl;
-    exit(EXIT_FAILURE);
-  }
+  if (!ByteSource::isPlainFile(problem.fileName)) {
+    // standard input, a pipe, or a compressed file
+    ByteSource* source = ByteSource::open(problem.fileName);
+    if (numThreads >= 1) {
+      std::vector<char> data;
+      source->readAll(data);
+      readModelFromBuffer(problem, data.empty() ? NULL : &data[0], data.size(),
+			  expectPomdp);
+    } else {
+      ByteSourceBuf buf(source);
+      istream in(&buf);
+      readModelFromStream(problem, in, expectPomdp);
+    }
+    delete source;
+  } else if (numThreads >= 1) {
+    readModelFromMappedFile(problem, expectPomdp);
+  } else {
+    ifstream in;
+    in.open(problem.fileName.c_str());
+    if (!in) {
+      cerr << "ERROR: couldn't open " << problem.fileName << " for reading: "
+	   << strerror(errno) << endl;
+      exit(EXIT_FAILURE);
+    }
 
-  readModelFromStream(problem, in, expectPomdp);
+    readModelFromStream(problem, in, expectPomdp);
 
-  in.close();
+    in.close();
+  }
 
   if (zmdpDebugLevelG >= 1) {
     gettimeofday(&endTime,0);
@@ -107,35 +452,132 @@ void FastParser::readModelFromFile(CassandraModel& problem,
   }
 }
 
+#define PM_PREFIX_MATCHES(X) \
+  (0 == strncmp(buf,(X),strlen(X)))
+
+// returns false if buf is not a preamble statement, meaning the body of
+// the model starts at this line
+bool FastParser::parsePreambleStatement(CassandraModel& p,
+					char *buf,
+					int lineNumber,
+					bool expectPomdp,
+					FPPreambleState& st)
+{
+  char sbuf[512];
+
+  if (PM_PREFIX_MATCHES("discount:")) {
+    if (1 != sscanf(buf,"discount: %lf", &p.discount)) {
+      cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+	   << ": syntax error in 'discount' statement"
+	   << endl;
+      exit(EXIT_FAILURE);
+    }
+    st.discountSet = true;
+  } else if (PM_PREFIX_MATCHES("values:")) {
+    if (1 != sscanf(buf,"values: %511s", sbuf)) {
+      cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+	   << ": syntax error in 'values' statement"
+	   << endl;
+      exit(EXIT_FAILURE);
+    }
+    if (0 != strcmp(sbuf,"reward")) {
+      cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+	   << ": expected 'values: reward', other types not supported by fast parser"
+	   << endl;
+      exit(EXIT_FAILURE);
+    }
+    st.valuesSet = true;
+  } else if (PM_PREFIX_MATCHES("actions:")) {
+    if (1 != sscanf(buf,"actions: %d", &p.numActions)) {
+      cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+	   << ": syntax error in 'actions' statement"
+	   << endl;
+      exit(EXIT_FAILURE);
+    }
+    st.numActionsSet = true;
+  } else if (PM_PREFIX_MATCHES("observations:")) {
+    if (expectPomdp) {
+      if (1 != sscanf(buf,"observations: %d", &p.numObservations)) {
+	cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+	     << ": syntax error in 'observations' statement"
+	     << endl;
+	exit(EXIT_FAILURE);
+      }
+      st.numObservationsSet = true;
+    } else {
+      cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+	   << ": got unexpected 'observations' statement in MDP"
+	   << endl;
+      exit(EXIT_FAILURE);
+    }
+  } else if (PM_PREFIX_MATCHES("states:")) {
+    if (1 != sscanf(buf,"states: %d", &p.numStates)) {
+      cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+	   << ": syntax error in 'states' statement"
+	   << endl;
+      exit(EXIT_FAILURE);
+    }
+    st.numStatesSet = true;
+  } else if (PM_PREFIX_MATCHES("start:")) {
+    if (!st.numStatesSet) {
+      cerr << "ERROR: " << p.fileName << ": line " << lineNumber
+	   << ": got 'start' statement before 'states' statement"
+	   << endl;
+      exit(EXIT_FAILURE);
+    }
+    readStartVector(p, buf, expectPomdp);
+    st.startSet = true;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// check that we are ready to transition to parsing the body
+void FastParser::checkPreambleComplete(CassandraModel& p,
+				       int lineNumber,
+				       bool expectPomdp,
+				       const FPPreambleState& st)
+{
+#define FP_CHECK_SET(VAR, NAME) \
+  if (!(VAR)) { \
+    cerr << "ERROR: " << p.fileName << ": line " << lineNumber \
+	 << ": at end of preamble, no '" << (NAME) << "' statement found" << endl; \
+    exit(EXIT_FAILURE); \
+  }
+
+  FP_CHECK_SET(st.discountSet,   "discount");
+  FP_CHECK_SET(st.valuesSet,     "values");
+  FP_CHECK_SET(st.numStatesSet,  "states");
+  FP_CHECK_SET(st.numActionsSet, "actions");
+  FP_CHECK_SET(st.startSet,      "start");
+  if (expectPomdp) {
+    FP_CHECK_SET(st.numObservationsSet, "observations");
+  } else {
+    p.numObservations = -1;
+  }
+}
+
 void FastParser::readModelFromStream(CassandraModel& p,
 				     std::istream& in,
 				     bool expectPomdp)
 {
   char buf[1<<20];
   int lineNumber;
-  char sbuf[512];
   bool inPreamble = true;
+  FPPreambleState st;
 
-  kmatrix Rx;
-  std::vector<kmatrix> Tx, Ox;
-
-  bool discountSet = false;
-  bool valuesSet = false;
-  bool numStatesSet = false;
-  bool numActionsSet = false;
-  bool numObservationsSet = false;
-  bool startSet = false;
+  CSCBuilder Rx;
+  std::vector<CSCBuilder> Tx, Ox;
 
   const char* rFormat = (expectPomdp
 			 ? "R: %d : %d : * : * %lf"
 			 : "R: %d : %d : * %lf");
 
-#define PM_PREFIX_MATCHES(X) \
-  (0 == strncmp(buf,(X),strlen(X)))
-
-  lineNumber = 1;
+  lineNumber = 0;
   while (!in.eof()) {
     in.getline(buf,sizeof(buf));
+    lineNumber++;
     if (in.fail() && !in.eof()) {
       cerr << "ERROR: " << p.fileName << ": line " << lineNumber << ": line too long for buffer"
 	   << " (max length " << sizeof(buf) << ")" << endl;
@@ -147,88 +589,8 @@ void FastParser::readModelFromStream(CassandraModel& p,
     if ('\0' == buf[0]) continue;
     
     if (inPreamble) {
-      if (PM_PREFIX_MATCHES("discount:")) {
-	if (1 != sscanf(buf,"discount: %lf", &p.discount)) {
-	  cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-	       << ": syntax error in 'discount' statement"
-	       << endl;
-	  exit(EXIT_FAILURE);
-	}
-	discountSet = true;
-      } else if (PM_PREFIX_MATCHES("values:")) {
-	if (1 != sscanf(buf,"values: %s", sbuf)) {
-	  cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-	       << ": syntax error in 'values' statement"
-	       << endl;
-	  exit(EXIT_FAILURE);
-	}
-	if (0 != strcmp(sbuf,"reward")) {
-	  cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-	       << ": expected 'values: reward', other types not supported by fast parser"
-	       << endl;
-	  exit(EXIT_FAILURE);
-	}
-	valuesSet = true;
-      } else if (PM_PREFIX_MATCHES("actions:")) {
-	if (1 != sscanf(buf,"actions: %d", &p.numActions)) {
-	  cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-	       << ": syntax error in 'actions' statement"
-	       << endl;
-	  exit(EXIT_FAILURE);
-	}
-	numActionsSet = true;
-      } else if (PM_PREFIX_MATCHES("observations:")) {
-	if (expectPomdp) {
-	  if (1 != sscanf(buf,"observations: %d", &p.numObservations)) {
-	    cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-		 << ": syntax error in 'observations' statement"
-		 << endl;
-	    exit(EXIT_FAILURE);
-	  }
-	  numObservationsSet = true;
-	} else {
-	  cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-	       << ": got unexpected 'observations' statement in MDP"
-	       << endl;
-	  exit(EXIT_FAILURE);
-	}
-      } else if (PM_PREFIX_MATCHES("states:")) {
-	if (1 != sscanf(buf,"states: %d", &p.numStates)) {
-	  cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-	       << ": syntax error in 'states' statement"
-	       << endl;
-	  exit(EXIT_FAILURE);
-	}
-	numStatesSet = true;
-      } else if (PM_PREFIX_MATCHES("start:")) {
-	if (!numStatesSet) {
-	  cerr << "ERROR: " << p.fileName << ": line " << lineNumber
-	       << ": got 'start' statement before 'states' statement"
-	       << endl;
-	  exit(EXIT_FAILURE);
-	}
-	readStartVector(p, buf, expectPomdp);
-	startSet = true;
-      } else {
-	// the statement is not one that is expected in the preamble,
-	// check that we are ready to transition to parsing the body
-
-#define FP_CHECK_SET(VAR, NAME) \
-	if (!(VAR)) { \
-	  cerr << "ERROR: " << p.fileName << ": line " << lineNumber \
-	       << ": at end of preamble, no '" << (NAME) << "' statement found" << endl; \
-	}
-
-	FP_CHECK_SET(discountSet,   "discount");
-	FP_CHECK_SET(valuesSet,     "values");
-	FP_CHECK_SET(numStatesSet,  "states");
-	FP_CHECK_SET(numActionsSet, "actions");
-	FP_CHECK_SET(startSet,      "start");
-	if (expectPomdp) {
-	  FP_CHECK_SET(numObservationsSet, "observations");
-	} else {
-	  p.numObservations = -1;
-	}
+      if (!parsePreambleStatement(p, buf, lineNumber, expectPomdp, st)) {
+	checkPreambleComplete(p, lineNumber, expectPomdp, st);
 	
 	// initialize data structures
 	Rx.resize(p.numStates, p.numActions);
@@ -259,7 +621,7 @@ void FastParser::readModelFromStream(CassandraModel& p,
 	       << endl;
 	  exit(EXIT_FAILURE);
 	}
-	kmatrix_set_entry(Rx, s, a, reward);
+	Rx.push_back(s, a, reward);
       } else if (PM_PREFIX_MATCHES("T:")) {
 	int s, a, sp;
 	double prob;
@@ -269,7 +631,7 @@ void FastParser::readModelFromStream(CassandraModel& p,
 	       << endl;
 	  exit(EXIT_FAILURE);
 	}
-	kmatrix_set_entry(Tx[a], s, sp, prob);
+	Tx[a].push_back(s, sp, prob);
       } else if (PM_PREFIX_MATCHES("O:")) {
 	if (expectPomdp) {
 	  int s, a, o;
@@ -280,7 +642,7 @@ void FastParser::readModelFromStream(CassandraModel& p,
 		 << endl;
 	    exit(EXIT_FAILURE);
 	  }
-	  kmatrix_set_entry(Ox[a], s, o, prob);
+	  Ox[a].push_back(s, o, prob);
 	} else {
 	  cerr << "ERROR: " << p.fileName << ": line " << lineNumber
 	       << ": got unexpected 'O' statement in MDP"
@@ -294,12 +656,10 @@ void FastParser::readModelFromStream(CassandraModel& p,
 	exit(EXIT_FAILURE);
       }
     }
-
-    lineNumber++;
   }
 
   // post-process
-  copy(p.R, Rx);
+  Rx.build(p.R);
   Rx.clear();
 
   p.T.resize(p.numActions);
@@ -308,13 +668,155 @@ void FastParser::readModelFromStream(CassandraModel& p,
     p.O.resize(p.numActions);
   }
   FOR (a, p.numActions) {
-    copy(p.T[a], Tx[a]);
-    kmatrix_transpose_in_place(Tx[a]);
-    copy(p.Ttr[a], Tx[a]);
+    Tx[a].build(p.T[a]);
+    Tx[a].buildTranspose(p.Ttr[a]);
+    Tx[a].clear();
 
+    if (expectPomdp) {
+      Ox[a].build(p.O[a]);
+      Ox[a].clear();
+    }
+  }
+
+  finishModel(p, expectPomdp);
+}
+
+void FastParser::readModelFromMappedFile(CassandraModel& p,
+					 bool expectPomdp)
+{
+  int fd = open(p.fileName.c_str(), O_RDONLY);
+  struct stat statBuf;
+  if (-1 == fd || 0 != fstat(fd, &statBuf)) {
+    cerr << "ERROR: couldn't open " << p.fileName << " for reading: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  size_t size = statBuf.st_size;
+  char* data = NULL;
+  if (size > 0) {
+    data = (char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == data) {
+      cerr << "ERROR: couldn't map " << p.fileName << " into memory: "
+	   << strerror(errno) << endl;
+      exit(EXIT_FAILURE);
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(data, size, MADV_SEQUENTIAL);
+#endif
+  }
+  close(fd);
+
+  readModelFromBuffer(p, data, size, expectPomdp);
+
+  if (size > 0) {
+    munmap(data, size);
+  }
+}
+
+void FastParser::readModelFromBuffer(CassandraModel& p,
+				     const char* data,
+				     size_t size,
+				     bool expectPomdp)
+{
+  // read the preamble sequentially, one null-terminated line at a time
+  const char* c = data;
+  const char* end = data + size;
+  int lineNumber = 0;
+  FPPreambleState st;
+  std::vector<char> buf;
+  while (c != end) {
+    const char* lineEnd = (const char*) memchr(c, '\n', end - c);
+    if (NULL == lineEnd) lineEnd = end;
+    lineNumber++;
+
+    buf.assign(c, lineEnd);
+    buf.push_back('\0');
+    if ('#' != buf[0]) {
+      trimTrailingWhiteSpace(&buf[0]);
+      if ('\0' != buf[0]) {
+	if (!parsePreambleStatement(p, &buf[0], lineNumber, expectPomdp, st)) {
+	  break;
+	}
+      }
+    }
+
+    c = (lineEnd == end) ? end : (lineEnd+1);
+  }
+  checkPreambleComplete(p, lineNumber, expectPomdp, st);
+  // c now points to the start of the first body statement
+  int bodyFirstLine = lineNumber;
+
+  // split the body into chunks at line boundaries
+  int numChunks = std::max(1, numThreads);
+  std::vector<FPChunk> chunks(numChunks);
+  const char* chunkBegin = c;
+  FOR (k, numChunks) {
+    FPChunk& ch = chunks[k];
+    const char* chunkEnd = end;
+    if ((int) k+1 < numChunks) {
+      chunkEnd = c + (end - c) * (k+1) / numChunks;
+      if (chunkEnd < chunkBegin) chunkEnd = chunkBegin;
+      const char* nl = (const char*) memchr(chunkEnd, '\n', end - chunkEnd);
+      chunkEnd = (NULL == nl) ? end : (nl+1);
+    }
+    ch.begin = chunkBegin;
+    ch.end = chunkEnd;
+    ch.p = &p;
+    ch.expectPomdp = expectPomdp;
+    ch.numLines = 0;
+    ch.errorLine = 0;
+    ch.T.resize(p.numActions);
+    if (expectPomdp) {
+      ch.O.resize(p.numActions);
+    }
+    chunkBegin = chunkEnd;
+  }
+
+  std::vector<void*> args(numChunks);
+  FOR (k, numChunks) args[k] = &chunks[k];
+  fpRunThreads(&fpParseChunk, args);
+
+  // report the first error in file order
+  int linesBefore = bodyFirstLine - 1;
+  FOR (k, numChunks) {
+    if (0 != chunks[k].errorLine) {
+      cerr << "ERROR: " << p.fileName << ": line "
+	   << (linesBefore + chunks[k].errorLine)
+	   << ": " << chunks[k].errorMessage << endl;
+      exit(EXIT_FAILURE);
+    }
+    linesBefore += chunks[k].numLines;
+  }
+
+  // post-process
+  CSCBuilder rBuilder(p.numStates, p.numActions);
+  FOR (k, numChunks) rBuilder.addEntries(chunks[k].R);
+  rBuilder.build(p.R);
+
+  p.T.resize(p.numActions);
+  p.Ttr.resize(p.numActions);
+  if (expectPomdp) {
+    p.O.resize(p.numActions);
+  }
+  FPBuildJob job;
+  job.p = &p;
+  job.chunks = &chunks;
+  job.expectPomdp = expectPomdp;
+  job.nextAction = 0;
+  std::vector<void*> jobArgs(std::min(numChunks, std::max(1, p.numActions)), &job);
+  fpRunThreads(&fpBuildActions, jobArgs);
+
+  finishModel(p, expectPomdp);
+}
+
+void FastParser::finishModel(CassandraModel& p,
+			     bool expectPomdp)
+{
 #if 1
-    // extra error checking
-    cvector checkTmp;
+  // extra error checking
+  cvector checkTmp;
+  dvector obsSums;
+  FOR (a, p.numActions) {
     FOR (s, p.numStates) {
       copy_from_column(checkTmp, p.Ttr[a], s);
       if (fabs(sum(checkTmp) - 1.0) > POMDP_READ_ERROR_EPS) {
@@ -325,35 +827,27 @@ void FastParser::readModelFromStream(CassandraModel& p,
 	exit(EXIT_FAILURE);
       }
     }
-#endif
-
-    Tx[a].clear();
 
     if (expectPomdp) {
-      copy(p.O[a], Ox[a]);
-
-#if 1
-      cmatrix checkObs;
-      
-      // extra error checking
-      kmatrix_transpose_in_place(Ox[a]);
-      copy(checkObs, Ox[a]);
-
+      // O[a] is indexed (s,o), so the observation distributions are its rows
+      obsSums.resize(p.numStates);
+      FOR (o, p.numObservations) {
+	for (unsigned int i = p.O[a].col_starts[o]; i < p.O[a].col_starts[o+1]; i++) {
+	  obsSums(p.O[a].data[i].index) += p.O[a].data[i].value;
+	}
+      }
       FOR (s, p.numStates) {
-	copy_from_column(checkTmp, checkObs, s);
-	if (fabs(sum(checkTmp) - 1.0) > POMDP_READ_ERROR_EPS) {
+	if (fabs(obsSums(s) - 1.0) > POMDP_READ_ERROR_EPS) {
 	  fprintf(stderr,
 		  "ERROR: %s: observation probabilities do not sum to 1 for:\n"
 		  "  state %d, action %d, observation sum = %.10lf\n",
-		  p.fileName.c_str(), (int)s, (int)a, sum(checkTmp));
+		  p.fileName.c_str(), (int)s, (int)a, obsSums(s));
 	  exit(EXIT_FAILURE);
 	}
       }
-#endif
-
-      Ox[a].clear();
     }
   }
+#endif
 
   p.checkForTerminalStates();
 
@@ -372,6 +866,7 @@ void FastParser::readModelFromStream(CassandraModel& p,
 
   if (zmdpDebugLevelG >= 1) {
     p.debugDensity();
+    p.debugPeakMemory();
   }
 }
 
@@ -33,16 +33,55 @@ using namespace sla;
 
 namespace zmdp {
 
+// tracks which statements have been seen while reading the preamble
+struct FPPreambleState {
+  bool discountSet;
+  bool valuesSet;
+  bool numStatesSet;
+  bool numActionsSet;
+  bool numObservationsSet;
+  bool startSet;
+
+  FPPreambleState(void);
+};
+
 struct FastParser {
+  // If numThreads is 0, the file is read line by line through an
+  // istream.  If numThreads >= 1, the file is memory-mapped and the body
+  // of the model is split into numThreads chunks that are parsed
+  // concurrently.  Models read from a ByteSource (standard input, pipes,
+  // and compressed files) are streamed in the first case and read into
+  // memory in the second.
+  FastParser(int _numThreads = 0);
+
   void readGenericDiscreteMDPFromFile(CassandraModel& mdp, const std::string& fileName);
   void readPomdpFromFile(CassandraModel& pomdp, const std::string& fileName);
 
 protected:
+  int numThreads;
+
   void readModelFromFile(CassandraModel& problem,
 			 bool expectPomdp);
   void readModelFromStream(CassandraModel& problem,
 			   std::istream& in,
 			   bool expectPomdp);
+  void readModelFromMappedFile(CassandraModel& problem,
+			       bool expectPomdp);
+  void readModelFromBuffer(CassandraModel& problem,
+			   const char* data,
+			   size_t size,
+			   bool expectPomdp);
+  bool parsePreambleStatement(CassandraModel& problem,
+			      char *buf,
+			      int lineNumber,
+			      bool expectPomdp,
+			      FPPreambleState& state);
+  void checkPreambleComplete(CassandraModel& problem,
+			     int lineNumber,
+			     bool expectPomdp,
+			     const FPPreambleState& state);
+  void finishModel(CassandraModel& problem,
+		   bool expectPomdp);
   void readStartVector(CassandraModel& problem,
 		       char *data,
 		       bool expectPomdp);
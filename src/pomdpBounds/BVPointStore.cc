@@ -0,0 +1,580 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    BVPointStore.cc
+ @brief   Contiguous point storage used to speed up SawtoothUpperBound queries.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <iostream>
+#include <algorithm>
+#include <queue>
+
+#include "zmdpThreads.h"
+#include "BVPointStore.h"
+#include "SawtoothUpperBound.h"
+
+using namespace std;
+using namespace sla;
+using namespace MatrixUtils;
+
+namespace zmdp {
+
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+// dense copy of the belief being interpolated.  getMinValue() runs
+// concurrently in the parallel search modes, so each thread has its own
+// buffer.  the buffer is all zeros between calls.
+static __thread double* denseBeliefG = NULL;
+static __thread int denseBeliefSizeG = 0;
+
+static double* getDenseBeliefBuffer(int size)
+{
+  if (denseBeliefSizeG < size) {
+    free(denseBeliefG);
+    denseBeliefG = (double*) calloc(size, sizeof(double));
+    if (NULL == denseBeliefG) {
+      fprintf(stderr, "ERROR: BVPointStore: out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+    denseBeliefSizeG = size;
+  }
+  return denseBeliefG;
+}
+
+static void markDead(BVPointStore& st, int slot)
+{
+  st.owners[slot] = NULL;
+  // innerCorner <= value means the slot is skipped by getMinValue()
+  st.values[slot] = 99e+20;
+  st.innerCorner[slot] = 0.0;
+}
+
+static void eraseSlot(std::vector<int>& slots, int slot)
+{
+  typeof(slots.begin()) pos = std::find(slots.begin(), slots.end(), slot);
+  assert(pos != slots.end());
+  slots.erase(pos);
+}
+
+static inline uint64_t getSignatureBit(unsigned int s)
+{
+  return ((uint64_t) 1) << (((s * 2654435761U) >> 26) & 63);
+}
+
+static size_t hashSupport(const std::vector<unsigned int>& support)
+{
+  size_t h = support.size();
+  FOR_EACH (si, support) {
+    h = h * 1000003 ^ *si;
+  }
+  return h;
+}
+
+/**********************************************************************
+ * BVPointStore FUNCTIONS
+ **********************************************************************/
+
+BVPointStore::BVPointStore(void) :
+  useSupportList(false),
+  useSupportIndex(false),
+  nearestK(0),
+  collectQueryStats(false),
+  numDeadSlots(0)
+{}
+
+void BVPointStore::init(int numStates, bool _useSupportList,
+			bool _useSupportIndex, int _nearestK)
+{
+  useSupportList = _useSupportList;
+  nearestK = _nearestK;
+  useSupportIndex = _useSupportIndex || (nearestK > 0);
+  collectQueryStats = useSupportIndex || (zmdpDebugLevelG >= 1);
+  clear();
+  if (useSupportList) {
+    supportList.resize(numStates);
+  }
+  if (useSupportIndex) {
+    bucketsByFirst.resize(numStates);
+  }
+}
+
+void BVPointStore::clear(void)
+{
+  entries.clear();
+  begin.clear();
+  count.clear();
+  values.clear();
+  innerCorner.clear();
+  owners.clear();
+  FOR_EACH (sp, supportList) {
+    sp->clear();
+  }
+  allSlots.clear();
+  numDeadSlots = 0;
+  rebuildIndex();
+}
+
+void BVPointStore::add(BVPair* pair)
+{
+  int slot = owners.size();
+  pair->slot = slot;
+
+  begin.push_back(entries.size());
+  FOR_EACH (bi, pair->b.data) {
+    // zero entries cannot affect the minimum ratio
+    if (0.0 != bi->value) {
+      entries.push_back(*bi);
+    }
+  }
+  count.push_back(entries.size() - begin.back());
+  values.push_back(pair->v);
+  innerCorner.push_back(pair->innerCornerCache);
+  owners.push_back(pair);
+
+  if (useSupportList) {
+    FOR_EACH (bi, pair->b.data) {
+      supportList[bi->index].push_back(slot);
+    }
+  } else {
+    allSlots.push_back(slot);
+  }
+  if (useSupportIndex) {
+    addToIndex(slot);
+  }
+}
+
+void BVPointStore::remove(BVPair* pair)
+{
+  int slot = pair->slot;
+  assert(0 <= slot && owners[slot] == pair);
+
+  if (useSupportList) {
+    FOR_EACH (bi, pair->b.data) {
+      eraseSlot(supportList[bi->index], slot);
+    }
+  } else {
+    eraseSlot(allSlots, slot);
+  }
+  if (useSupportIndex) {
+    removeFromIndex(slot);
+  }
+  markDead(*this, slot);
+  numDeadSlots++;
+  pair->slot = -1;
+}
+
+void BVPointStore::setInnerCorner(BVPair* pair, double innerCornerPtsC)
+{
+  pair->innerCornerCache = innerCornerPtsC;
+  innerCorner[pair->slot] = innerCornerPtsC;
+}
+
+const std::vector<int>& BVPointStore::getCandidates(const belief_vector& b) const
+{
+  if (useSupportList) {
+    return supportList[b.data[0].index];
+  } else {
+    return allSlots;
+  }
+}
+
+const std::vector<int>& BVPointStore::getSlotsTouching(int s) const
+{
+  if (useSupportList) {
+    return supportList[s];
+  } else {
+    return allSlots;
+  }
+}
+
+// returns the bound that slot p induces at b, or 99e+20 if p can never
+// improve on the corner point bound
+double BVPointStore::evaluateSlot(const double* x, int p,
+				  const belief_vector& b,
+				  double innerCornerPtsB) const
+{
+  double innerCornerPtsC = innerCorner[p];
+  double cVal = values[p];
+  if (innerCornerPtsC <= cVal) return 99e+20;
+
+  double minRatio = min_ratio_gather(x, ((const char*) &entries[0])
+				     + begin[p] * SLA_ENTRY_BYTES,
+				     count[p]);
+  if (minRatio > 1) {
+    if (minRatio < 1 + MIN_RATIO_EPS) {
+      // round-off error, correct it down to 1
+      minRatio = 1;
+    } else {
+      const belief_vector& c = owners[p]->b;
+      cout << "ERROR: minRatio > 1 in upperBoundInternal!" << endl;
+      cout << "  (minRatio-1)=" << (minRatio-1) << endl;
+      cout << "  normb=" << norm_1(b) << endl;
+      cout << "  b=" << sparseRep(b) << endl;
+      cout << "  normc=" << norm_1(c) << endl;
+      cout << "  c=" << sparseRep(c) << endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  return innerCornerPtsB + minRatio * (cVal - innerCornerPtsC);
+}
+
+double BVPointStore::getMinValue(const belief_vector& b,
+				 double innerCornerPtsB) const
+{
+  BVQueryStats qs;
+  const std::vector<int>& candidates = getCandidates(b);
+  qs.numScanned = candidates.size();
+
+  double minValue = innerCornerPtsB;
+  if (0 != qs.numScanned) {
+    double* x = getDenseBeliefBuffer(b.size());
+    FOR_EACH (bi, b.data) {
+      x[bi->index] = bi->value;
+    }
+
+    if (nearestK > 0) {
+      minValue = getMinValueNearest(x, b, innerCornerPtsB, qs);
+    } else if (useSupportIndex) {
+      minValue = getMinValueIndexed(x, b, innerCornerPtsB, qs);
+    } else {
+      minValue = getMinValueScan(x, candidates, b, innerCornerPtsB, qs);
+    }
+
+    FOR_EACH (bi, b.data) {
+      x[bi->index] = 0.0;
+    }
+  }
+
+  if (collectQueryStats) {
+    atomicAdd(queryStats.numQueries, 1);
+    atomicAdd(queryStats.numScanned, qs.numScanned);
+    atomicAdd(queryStats.numExamined, qs.numExamined);
+    atomicAdd(queryStats.numUseful, qs.numUseful);
+  }
+
+  return minValue;
+}
+
+// a candidate c contributes innerCornerPtsB + minRatio * (v - innerCorner),
+// where minRatio = min_j b(j)/c(j) over the non-zeros of c.  if b(j) = 0
+// for some such j, minRatio = 0 and the candidate contributes exactly
+// innerCornerPtsB, which is already the starting value.
+double BVPointStore::getMinValueScan(const double* x,
+				     const std::vector<int>& candidates,
+				     const belief_vector& b,
+				     double innerCornerPtsB,
+				     BVQueryStats& qs) const
+{
+  double minValue = innerCornerPtsB;
+  FOR_EACH (slotP, candidates) {
+    double val = evaluateSlot(x, *slotP, b, innerCornerPtsB);
+    qs.numExamined++;
+    if (val < innerCornerPtsB) qs.numUseful++;
+    if (val < minValue) minValue = val;
+  }
+  return minValue;
+}
+
+bool BVPointStore::bucketApplies(const BVSupportBucket& bucket,
+				 const double* x,
+				 uint64_t bSignature) const
+{
+  if (bucket.slots.empty()) return false;
+  if (0 != (bucket.signature & ~bSignature)) return false;
+  FOR_EACH (si, bucket.support) {
+    if (0.0 == x[*si]) return false;
+  }
+  return true;
+}
+
+// visits only the buckets whose support is contained in b's support.
+// such a bucket's first state is a non-zero state of b (with the
+// support list, it must be b's first state), so bucketsByFirst lists
+// all of them.  ignoring explicitly stored zeros, this gives the same
+// result as getMinValueScan().
+double BVPointStore::getMinValueIndexed(const double* x, const belief_vector& b,
+					double innerCornerPtsB,
+					BVQueryStats& qs) const
+{
+  uint64_t bSignature = 0;
+  FOR_EACH (bi, b.data) {
+    if (0.0 != bi->value) bSignature |= getSignatureBit(bi->index);
+  }
+
+  double minValue = innerCornerPtsB;
+  int numFirstStates = useSupportList ? 1 : b.data.size();
+  FOR (fi, numFirstStates) {
+    const std::vector<int>& bucketIds = bucketsByFirst[b.data[fi].index];
+    FOR_EACH (bidP, bucketIds) {
+      const BVSupportBucket& bucket = buckets[*bidP];
+      if (!bucketApplies(bucket, x, bSignature)) continue;
+      FOR_EACH (slotP, bucket.slots) {
+	double val = evaluateSlot(x, *slotP, b, innerCornerPtsB);
+	qs.numExamined++;
+	if (val < innerCornerPtsB) qs.numUseful++;
+	if (val < minValue) minValue = val;
+      }
+    }
+  }
+  return minValue;
+}
+
+// like getMinValueIndexed(), but only the nearestK applicable points
+// closest to b in L1 distance are evaluated.  within a bucket, points
+// are visited outward from b's position in key order; since the L1
+// distance is at least the difference in keys, the search can stop
+// once the key gap exceeds the current nearestK-th best distance.
+double BVPointStore::getMinValueNearest(const double* x, const belief_vector& b,
+					double innerCornerPtsB,
+					BVQueryStats& qs) const
+{
+  uint64_t bSignature = 0;
+  double bNorm = 0.0;
+  FOR_EACH (bi, b.data) {
+    if (0.0 != bi->value) bSignature |= getSignatureBit(bi->index);
+    bNorm += bi->value;
+  }
+
+  typedef std::pair<double,int> DistSlot;
+  std::priority_queue<DistSlot> nearest;
+
+  int numFirstStates = useSupportList ? 1 : b.data.size();
+  FOR (fi, numFirstStates) {
+    const std::vector<int>& bucketIds = bucketsByFirst[b.data[fi].index];
+    FOR_EACH (bidP, bucketIds) {
+      const BVSupportBucket& bucket = buckets[*bidP];
+      if (!bucketApplies(bucket, x, bSignature)) continue;
+
+      int n = bucket.slots.size();
+      double q = x[bucket.support[0]];
+      int hi = std::lower_bound(bucket.keys.begin(), bucket.keys.end(), q)
+	- bucket.keys.begin();
+      int lo = hi-1;
+      while (lo >= 0 || hi < n) {
+	double gapLo = (lo >= 0) ? (q - bucket.keys[lo]) : 99e+20;
+	double gapHi = (hi < n) ? (bucket.keys[hi] - q) : 99e+20;
+	bool takeHi = (gapHi <= gapLo);
+	if ((int) nearest.size() == nearestK
+	    && std::min(gapLo, gapHi) >= nearest.top().first) {
+	  break;
+	}
+	int p = takeHi ? bucket.slots[hi++] : bucket.slots[lo--];
+	qs.numExamined++;
+	if (innerCorner[p] <= values[p]) continue;
+
+	// ||b - c||_1 where supp(c) is contained in supp(b)
+	double dist = bNorm;
+	const cvector_entry* e = &entries[begin[p]];
+	FOR (i, count[p]) {
+	  double bj = x[e[i].index];
+	  dist += fabs(bj - e[i].value) - bj;
+	}
+	if ((int) nearest.size() < nearestK) {
+	  nearest.push(DistSlot(dist, p));
+	} else if (dist < nearest.top().first) {
+	  nearest.pop();
+	  nearest.push(DistSlot(dist, p));
+	}
+      }
+    }
+  }
+
+  double minValue = innerCornerPtsB;
+  while (!nearest.empty()) {
+    double val = evaluateSlot(x, nearest.top().second, b, innerCornerPtsB);
+    nearest.pop();
+    if (val < innerCornerPtsB) qs.numUseful++;
+    if (val < minValue) minValue = val;
+  }
+  return minValue;
+}
+
+void BVPointStore::addToIndex(int slot)
+{
+  std::vector<unsigned int> support;
+  FOR (i, count[slot]) {
+    support.push_back(entries[begin[slot]+i].index);
+  }
+  if (support.empty()) return;
+
+  std::vector<int>& ids = bucketLookup[hashSupport(support)];
+  int bid = -1;
+  FOR_EACH (idP, ids) {
+    if (buckets[*idP].support == support) {
+      bid = *idP;
+      break;
+    }
+  }
+  if (-1 == bid) {
+    bid = buckets.size();
+    buckets.push_back(BVSupportBucket());
+    BVSupportBucket& newBucket = buckets.back();
+    newBucket.support = support;
+    newBucket.signature = 0;
+    FOR_EACH (si, support) {
+      newBucket.signature |= getSignatureBit(*si);
+    }
+    ids.push_back(bid);
+    bucketsByFirst[support[0]].push_back(bid);
+  }
+
+  BVSupportBucket& bucket = buckets[bid];
+  double key = entries[begin[slot]].value;
+  int pos = std::upper_bound(bucket.keys.begin(), bucket.keys.end(), key)
+    - bucket.keys.begin();
+  bucket.keys.insert(bucket.keys.begin() + pos, key);
+  bucket.slots.insert(bucket.slots.begin() + pos, slot);
+
+  if ((int) slotBucket.size() <= slot) {
+    slotBucket.resize(slot+1, -1);
+  }
+  slotBucket[slot] = bid;
+}
+
+void BVPointStore::removeFromIndex(int slot)
+{
+  if ((int) slotBucket.size() <= slot || -1 == slotBucket[slot]) return;
+  BVSupportBucket& bucket = buckets[slotBucket[slot]];
+  int pos = std::find(bucket.slots.begin(), bucket.slots.end(), slot)
+    - bucket.slots.begin();
+  assert(pos < (int) bucket.slots.size());
+  bucket.slots.erase(bucket.slots.begin() + pos);
+  bucket.keys.erase(bucket.keys.begin() + pos);
+  slotBucket[slot] = -1;
+}
+
+// rebuilds the support index from the live slots, dropping empty
+// buckets
+void BVPointStore::rebuildIndex(void)
+{
+  buckets.clear();
+  bucketLookup.clear();
+  FOR_EACH (bp, bucketsByFirst) {
+    bp->clear();
+  }
+  slotBucket.clear();
+  if (!useSupportIndex) return;
+
+  FOR (p, owners.size()) {
+    if (NULL != owners[p]) addToIndex(p);
+  }
+}
+
+void BVPointStore::maybeCompact(void)
+{
+  if (numDeadSlots <= (int) owners.size() / 2) return;
+
+  // renumber the live slots in order
+  std::vector<int> newSlot(owners.size(), -1);
+  std::vector<cvector_entry> newEntries;
+  int numLive = 0;
+  FOR (p, owners.size()) {
+    if (NULL == owners[p]) continue;
+    int np = numLive++;
+    newSlot[p] = np;
+    int newBegin = newEntries.size();
+    newEntries.insert(newEntries.end(),
+		      entries.begin() + begin[p],
+		      entries.begin() + begin[p] + count[p]);
+    begin[np] = newBegin;
+    count[np] = count[p];
+    values[np] = values[p];
+    innerCorner[np] = innerCorner[p];
+    owners[np] = owners[p];
+    owners[np]->slot = np;
+  }
+  entries.swap(newEntries);
+  begin.resize(numLive);
+  count.resize(numLive);
+  values.resize(numLive);
+  innerCorner.resize(numLive);
+  owners.resize(numLive);
+
+  FOR_EACH (sp, supportList) {
+    FOR_EACH (slotP, *sp) {
+      *slotP = newSlot[*slotP];
+    }
+  }
+  FOR_EACH (slotP, allSlots) {
+    *slotP = newSlot[*slotP];
+  }
+  numDeadSlots = 0;
+  rebuildIndex();
+}
+
+size_t BVPointStore::getNumBytes(void) const
+{
+  size_t numBytes = entries.capacity() * sizeof(cvector_entry)
+    + (begin.capacity() + count.capacity()) * sizeof(int)
+    + (values.capacity() + innerCorner.capacity()) * sizeof(double)
+    + owners.capacity() * sizeof(BVPair*)
+    + allSlots.capacity() * sizeof(int)
+    + slotBucket.capacity() * sizeof(int);
+  FOR_EACH (sp, supportList) {
+    numBytes += sp->capacity() * sizeof(int);
+  }
+  FOR_EACH (bp, buckets) {
+    numBytes += sizeof(BVSupportBucket)
+      + bp->support.capacity() * sizeof(unsigned int)
+      + bp->slots.capacity() * sizeof(int)
+      + bp->keys.capacity() * sizeof(double);
+  }
+  return numBytes;
+}
+
+void BVPointStore::printQueryStats(std::ostream& out) const
+{
+  char buf[256];
+  double n = std::max(queryStats.numQueries, 1LL);
+  char mode[64];
+  if (nearestK > 0) {
+    snprintf(mode, sizeof(mode), "support index, nearest %d", nearestK);
+  } else if (useSupportIndex) {
+    snprintf(mode, sizeof(mode), "support index");
+  } else {
+    snprintf(mode, sizeof(mode), "scan");
+  }
+  snprintf(buf, sizeof(buf),
+	   "sawtooth upper bound: %lld queries (%s); per query %.1f points"
+	   " in scan lists, %.1f examined, %.1f useful\n",
+	   queryStats.numQueries, mode,
+	   queryStats.numScanned / n,
+	   queryStats.numExamined / n,
+	   queryStats.numUseful / n);
+  out << buf;
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
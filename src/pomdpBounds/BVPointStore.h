@@ -0,0 +1,170 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    BVPointStore.h
+ @brief   Contiguous point storage used to speed up SawtoothUpperBound queries.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCBVPointStore_h
+#define INCBVPointStore_h
+
+#include <stdint.h>
+
+#include <iostream>
+#include <vector>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTypes.h"
+
+namespace zmdp {
+
+struct BVPair;
+
+// Points with the same set of non-zero entries share a bucket.  A point
+// can only improve on the corner point bound at b if its support is
+// contained in b's support (otherwise its sawtooth ratio is 0), so the
+// support index tests containment once per bucket instead of once per
+// point.
+struct BVSupportBucket {
+  // sorted non-zero states of the points in the bucket
+  std::vector<unsigned int> support;
+  // one bit per hashed support state.  the bucket can only be
+  // contained in b's support if its signature is contained in b's.
+  uint64_t signature;
+  // slots in the bucket, sorted by keys[i] = belief at support[0]
+  std::vector<int> slots;
+  std::vector<double> keys;
+};
+
+// cumulative counts over getMinValue() calls
+struct BVQueryStats {
+  long long numQueries;
+  // points the support list (or full) scan checks
+  long long numScanned;
+  // points whose ratio (or, in nearest mode, distance) was computed
+  long long numExamined;
+  // points that gave a value below the corner point bound
+  long long numUseful;
+
+  BVQueryStats(void) :
+    numQueries(0),
+    numScanned(0),
+    numExamined(0),
+    numUseful(0)
+  {}
+};
+
+// Storage for the non-corner points of a SawtoothUpperBound.  The
+// non-zero entries of all points are packed into one array of
+// cvector_entry records, and each point's value and cached inner
+// product with the corner points are kept in parallel arrays indexed
+// by slot, so that interpolating at a belief walks memory in order and
+// uses the vectorized sla::min_ratio_gather() kernel.
+//
+// Removed points leave dead slots behind (which are skipped because
+// they can never give a useful bound); maybeCompact() squeezes them
+// out, preserving the order of the live slots.
+struct BVPointStore {
+  bool useSupportList;
+  bool useSupportIndex;
+  int nearestK;
+  // queryStats are shared by all search threads, so they are only
+  // collected when they will be printed: with the support index, or
+  // at debugLevel >= 1
+  bool collectQueryStats;
+
+  std::vector<sla::cvector_entry> entries;
+  // the entries of slot p are entries[begin[p]] .. entries[begin[p]+count[p]-1]
+  std::vector<int> begin;
+  std::vector<int> count;
+  std::vector<double> values;
+  // innerCorner[p] = inner_prod(cornerPts, owners[p]->b)
+  std::vector<double> innerCorner;
+  // NULL for dead slots
+  std::vector<BVPair*> owners;
+
+  // supportList[s] lists (in order of addition) the live slots whose
+  // belief has an entry at s.  if useSupportList is not set, allSlots
+  // lists every live slot instead.
+  std::vector< std::vector<int> > supportList;
+  std::vector<int> allSlots;
+
+  // support index (only maintained if useSupportIndex is set).
+  // bucketsByFirst[s] lists the buckets whose support starts at s.
+  std::vector<BVSupportBucket> buckets;
+  EXT_NAMESPACE::hash_map<size_t, std::vector<int> > bucketLookup;
+  std::vector< std::vector<int> > bucketsByFirst;
+  std::vector<int> slotBucket;
+
+  int numDeadSlots;
+  mutable BVQueryStats queryStats;
+
+  BVPointStore(void);
+
+  // nearestK > 0 turns on the support index
+  void init(int numStates, bool _useSupportList, bool _useSupportIndex,
+	    int _nearestK);
+  void clear(void);
+  // pair->innerCornerCache must be set
+  void add(BVPair* pair);
+  void remove(BVPair* pair);
+  void setInnerCorner(BVPair* pair, double innerCornerPtsC);
+
+  // the slots to check when interpolating at b
+  const std::vector<int>& getCandidates(const belief_vector& b) const;
+  // the live slots whose belief has an entry at state s (all live
+  // slots if useSupportList is not set)
+  const std::vector<int>& getSlotsTouching(int s) const;
+
+  // returns min(innerCornerPtsB, min over the candidate points of the
+  // sawtooth interpolation at b), the same value as calling
+  // SawtoothUpperBound::getBVValue() on each candidate.  in nearest
+  // mode, only the nearestK candidates closest to b in L1 distance are
+  // used, so the result is a valid but possibly looser upper bound.
+  double getMinValue(const belief_vector& b, double innerCornerPtsB) const;
+
+  void maybeCompact(void);
+  size_t getNumBytes(void) const;
+  void printQueryStats(std::ostream& out) const;
+
+protected:
+  double getMinValueScan(const double* x, const std::vector<int>& candidates,
+			 const belief_vector& b,
+			 double innerCornerPtsB, BVQueryStats& qs) const;
+  double getMinValueIndexed(const double* x, const belief_vector& b,
+			    double innerCornerPtsB, BVQueryStats& qs) const;
+  double getMinValueNearest(const double* x, const belief_vector& b,
+			    double innerCornerPtsB, BVQueryStats& qs) const;
+  bool bucketApplies(const BVSupportBucket& bucket, const double* x,
+		     uint64_t bSignature) const;
+  double evaluateSlot(const double* x, int p, const belief_vector& b,
+		      double innerCornerPtsB) const;
+  void addToIndex(int slot);
+  void removeFromIndex(int slot);
+  void rebuildIndex(void);
+};
+
+}; // namespace zmdp
+
+#endif // INCBVPointStore_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -0,0 +1,482 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    BinaryPolicy.cc
+ @brief   Binary, memory-mapped policy files for MaxPlanesLowerBound.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#include "zmdpCommonDefs.h"
+#include "MaxPlanesLowerBound.h"
+#include "BinaryPolicy.h"
+
+using namespace std;
+using namespace sla;
+
+namespace zmdp {
+
+/***************************************************************************
+ * FILE LAYOUT
+ *
+ * header
+ * actions         (int32 per plane)
+ * offsets         (uint64 per plane, into denseValues or sparseEntries)
+ * numEntries      (uint64 per plane; numStates for a dense plane)
+ * masks           (maskWords uint64 bitset words per plane)
+ * denseValues     (numStates doubles per dense plane)
+ * sparseEntries   (raw cvector entries of the sparse planes)
+ *
+ * Every array starts on an 8-byte boundary.
+ ***************************************************************************/
+
+static const char BP_MAGIC[8] = { 'Z','M','D','P','P','O','L','\0' };
+static const uint32_t BP_BYTE_ORDER_MARK = 0x01020304;
+
+struct BPHeader {
+  char magic[8];
+  int32_t version;
+  uint32_t byteOrderMark;
+  int32_t entryBytes;
+  int32_t numStates;
+  int32_t numPlanes;
+  int32_t maskWords;
+  uint64_t numDenseValues;
+  uint64_t numSparseEntries;
+  uint64_t fileSize;
+};
+
+static inline size_t bpPadded(size_t n)
+{
+  return (n + 7) & ~((size_t) 7);
+}
+
+/***************************************************************************
+ * WRITING
+ ***************************************************************************/
+
+struct BPWriter {
+  std::ofstream out;
+
+  void write(const void* buf, size_t n) {
+    static const char zeros[8] = { 0 };
+    out.write((const char*) buf, n);
+    out.write(zeros, bpPadded(n) - n);
+  }
+  template <class T>
+  void writeArray(const std::vector<T>& x) {
+    write(x.empty() ? NULL : &x[0], x.size() * sizeof(T));
+  }
+};
+
+void BinaryPolicy::writeToFile(const std::string& outFileName,
+			       int numStates,
+			       const std::vector<const LBPlane*>& planes,
+			       bool useMasking)
+{
+  int numPlanes = planes.size();
+  int maskWords = (numStates + 63) / 64;
+
+  // lay out the planes the same way the text format does: with masking,
+  // a plane has an entry for each state in its mask; without, an entry
+  // for every state
+  std::vector<int32_t> actions(numPlanes);
+  std::vector<uint64_t> offsets(numPlanes), numEntries(numPlanes);
+  std::vector<uint64_t> masks(((size_t) numPlanes) * maskWords, 0);
+  std::vector<double> denseValues;
+  // sparse entries are packed with zeroed padding, in the cvector_entry
+  // layout
+  std::vector<char> sparseEntries;
+  FOR (i, numPlanes) {
+    const LBPlane& p = *planes[i];
+    actions[i] = p.action;
+    uint64_t* mask = &masks[((size_t) i) * maskWords];
+    size_t n = useMasking ? p.mask.filled() : numStates;
+    numEntries[i] = n;
+    if ((int) n == numStates) {
+      offsets[i] = denseValues.size();
+      denseValues.resize(denseValues.size() + numStates, 0.0);
+      double* vals = &denseValues[offsets[i]];
+      FOR_CV (p.alpha) {
+	vals[CV_INDEX(p.alpha)] = CV_VAL(p.alpha);
+      }
+      FOR (s, numStates) {
+	mask[s >> 6] |= ((uint64_t) 1) << (s & 63);
+      }
+    } else {
+      offsets[i] = sparseEntries.size() / SLA_ENTRY_BYTES;
+      FOR_CV (p.mask) {
+	int s = CV_INDEX(p.mask);
+	cvector_entry e(s, p.alpha(s));
+	append_packed_entries(sparseEntries, &e, 1);
+	mask[s >> 6] |= ((uint64_t) 1) << (s & 63);
+      }
+    }
+  }
+
+  BPHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, BP_MAGIC, sizeof(h.magic));
+  h.version = ZMDP_BINARY_POLICY_VERSION;
+  h.byteOrderMark = BP_BYTE_ORDER_MARK;
+  h.entryBytes = sizeof(cvector_entry);
+  h.numStates = numStates;
+  h.numPlanes = numPlanes;
+  h.maskWords = maskWords;
+  h.numDenseValues = denseValues.size();
+  h.numSparseEntries = sparseEntries.size() / SLA_ENTRY_BYTES;
+  h.fileSize = bpPadded(sizeof(h))
+    + bpPadded(actions.size() * sizeof(int32_t))
+    + (offsets.size() + numEntries.size() + masks.size()) * sizeof(uint64_t)
+    + denseValues.size() * sizeof(double)
+    + sparseEntries.size();
+
+  BPWriter w;
+  w.out.open(outFileName.c_str(), ios::out | ios::binary);
+  if (!w.out) {
+    cerr << "ERROR: BinaryPolicy::writeToFile: couldn't open " << outFileName
+	 << " for writing: " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  w.write(&h, sizeof(h));
+  w.writeArray(actions);
+  w.writeArray(offsets);
+  w.writeArray(numEntries);
+  w.writeArray(masks);
+  w.writeArray(denseValues);
+  w.writeArray(sparseEntries);
+  w.out.close();
+  if (w.out.fail()) {
+    cerr << "ERROR: BinaryPolicy::writeToFile: error writing " << outFileName
+	 << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+/***************************************************************************
+ * READING
+ ***************************************************************************/
+
+struct BPReader {
+  const char* data;
+  size_t size;
+  size_t pos;
+  const std::string* fileName;
+
+  const void* take(size_t n) {
+    if (n > size - pos) {
+      cerr << "ERROR: " << *fileName << ": binary policy file is truncated"
+	   << endl;
+      exit(EXIT_FAILURE);
+    }
+    const void* ret = data + pos;
+    pos += std::min(bpPadded(n), size - pos);
+    return ret;
+  }
+};
+
+BinaryPolicy::BinaryPolicy(void) :
+  numStates(0),
+  numPlanes(0),
+  data(NULL),
+  size(0)
+{}
+
+BinaryPolicy::~BinaryPolicy(void)
+{
+  if (NULL != data) {
+    munmap(data, size);
+  }
+}
+
+bool BinaryPolicy::isBinaryPolicyFile(const std::string& fileName)
+{
+  const char* ext = ".policyb";
+  size_t n = strlen(ext);
+  return (fileName.size() >= n
+	  && 0 == fileName.compare(fileName.size() - n, n, ext));
+}
+
+void BinaryPolicy::readFromFile(const std::string& _fileName)
+{
+  fileName = _fileName;
+
+  int fd = open(fileName.c_str(), O_RDONLY);
+  struct stat statBuf;
+  if (-1 == fd || 0 != fstat(fd, &statBuf)) {
+    cerr << "ERROR: couldn't open " << fileName << " for reading: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  size = statBuf.st_size;
+  if (size < sizeof(BPHeader)) {
+    cerr << "ERROR: " << fileName << ": not a ZMDP binary policy file" << endl;
+    exit(EXIT_FAILURE);
+  }
+  data = (char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == data) {
+    cerr << "ERROR: couldn't map " << fileName << " into memory: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+
+  BPReader r;
+  r.data = data;
+  r.size = size;
+  r.pos = 0;
+  r.fileName = &fileName;
+
+  BPHeader h;
+  memcpy(&h, r.take(sizeof(h)), sizeof(h));
+  if (0 != memcmp(h.magic, BP_MAGIC, sizeof(h.magic))) {
+    cerr << "ERROR: " << fileName << ": not a ZMDP binary policy file" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (h.byteOrderMark != BP_BYTE_ORDER_MARK
+      || h.entryBytes != (int) sizeof(cvector_entry)) {
+    cerr << "ERROR: " << fileName << ": binary policy file was written on an "
+	 << "incompatible architecture; re-run 'zmdp convertPolicy' on this machine"
+	 << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (h.version != ZMDP_BINARY_POLICY_VERSION) {
+    cerr << "ERROR: " << fileName << ": binary policy format version "
+	 << h.version << " is not supported (expected version "
+	 << ZMDP_BINARY_POLICY_VERSION << ")" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (h.fileSize != size) {
+    cerr << "ERROR: " << fileName << ": binary policy file is truncated" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  numStates = h.numStates;
+  numPlanes = h.numPlanes;
+  maskWords = h.maskWords;
+  actions = (const int32_t*) r.take(numPlanes * sizeof(int32_t));
+  offsets = (const uint64_t*) r.take(numPlanes * sizeof(uint64_t));
+  numEntries = (const uint64_t*) r.take(numPlanes * sizeof(uint64_t));
+  masks = (const uint64_t*) r.take(((size_t) numPlanes) * maskWords * sizeof(uint64_t));
+  denseValues = (const double*) r.take(h.numDenseValues * sizeof(double));
+  sparseEntries =
+    (const cvector_entry*) r.take(h.numSparseEntries * sizeof(cvector_entry));
+
+  FOR (i, numPlanes) {
+    size_t end = offsets[i] + numEntries[i];
+    if (end > (((int) numEntries[i] == numStates)
+	       ? h.numDenseValues : h.numSparseEntries)) {
+      cerr << "ERROR: " << fileName << ": binary policy file is corrupt" << endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+void BinaryPolicy::getPlane(LBPlane& result, int i) const
+{
+  result.action = actions[i];
+  result.alpha.resize(numStates);
+  size_t n = numEntries[i];
+  if ((int) n == numStates) {
+    const double* vals = denseValues + offsets[i];
+    FOR (s, numStates) {
+      result.alpha.push_back(s, vals[s]);
+    }
+  } else {
+    const cvector_entry* e = sparseEntries + offsets[i];
+    result.alpha.data.assign(e, e + n);
+  }
+
+  // the text format has no separate mask; reading it sets the mask to
+  // the entries of the alpha vector, which is what the bits hold
+  const uint64_t* mask = masks + ((size_t) i) * maskWords;
+  result.mask.resize(numStates);
+  FOR (s, numStates) {
+    if ((mask[s >> 6] >> (s & 63)) & 1) {
+      result.mask.push_back(s, 1);
+    }
+  }
+}
+
+inline bool BinaryPolicy::isApplicable(int i, const belief_vector& b) const
+{
+  const uint64_t* mask = masks + ((size_t) i) * maskWords;
+  FOR_CV (b) {
+    unsigned int s = CV_INDEX(b);
+    if (!((mask[s >> 6] >> (s & 63)) & 1)) return false;
+  }
+  return true;
+}
+
+// the same computation as inner_prod(alpha, b), so that values (and
+// therefore tie-breaking) match MaxPlanesLowerBound exactly
+inline double BinaryPolicy::innerProd(int i, const belief_vector& b) const
+{
+  size_t n = numEntries[i];
+  if (0 == n || b.data.empty()) return 0.0;
+
+  if ((int) n == numStates) {
+    return dot_gather( denseValues + offsets[i], 0,
+		       (const char*) &b.data[0], b.data.size() );
+  }
+  const cvector_entry* e = sparseEntries + offsets[i];
+  if (b.data.size() == b.size()) {
+    return dot_gather( &b.data[0].value, 1, (const char*) e, n );
+  }
+  return inner_prod_cvector_internal( e, e + n, b.data.begin(), b.data.end() );
+}
+
+int BinaryPolicy::getBestPlane(const belief_vector& b, bool useMasking,
+			       double& value) const
+{
+  double val, maxval = -99e+20;
+  int ret = -1;
+  FOR (i, numPlanes) {
+    if (useMasking) {
+      if (!isApplicable(i, b)) continue;
+    }
+    val = innerProd(i, b);
+    if (val > maxval) {
+      maxval = val;
+      ret = i;
+    }
+  }
+  value = maxval;
+  return ret;
+}
+
+int BinaryPolicy::getBestPlaneWithMargin(const belief_vector& b, bool useMasking,
+					 double& margin) const
+{
+  double val, maxval = -99e+20, otherval = -99e+20;
+  int ret = -1;
+  FOR (i, numPlanes) {
+    if (useMasking) {
+      if (!isApplicable(i, b)) continue;
+    }
+    val = innerProd(i, b);
+    if (val > maxval) {
+      if (-1 != ret && actions[ret] != actions[i]) {
+	otherval = maxval;
+      }
+      maxval = val;
+      ret = i;
+    } else if (-1 != ret && actions[i] != actions[ret] && val > otherval) {
+      otherval = val;
+    }
+  }
+  margin = (otherval > -99e+20) ? (maxval - otherval) : 99e+20;
+  return ret;
+}
+
+/***************************************************************************
+ * BINARY POLICY LOWER BOUND
+ ***************************************************************************/
+
+BinaryPolicyLowerBound::BinaryPolicyLowerBound(const MDP* _pomdp,
+					       const ZMDPConfig* config) :
+  pomdp((const Pomdp*) _pomdp)
+{
+  useMaxPlanesMasking = config->getBool("useMaxPlanesMasking");
+}
+
+void BinaryPolicyLowerBound::readFromFile(const std::string& inFileName)
+{
+  policy.readFromFile(inFileName);
+  if (policy.numStates != pomdp->numStates) {
+    fprintf(stderr, "ERROR: %s: policy has %d states but the model has %d\n",
+	    inFileName.c_str(), policy.numStates, pomdp->numStates);
+    exit(EXIT_FAILURE);
+  }
+  if (0 == policy.numPlanes) {
+    fprintf(stderr, "ERROR: %s: policy has no planes\n", inFileName.c_str());
+    exit(EXIT_FAILURE);
+  }
+}
+
+double BinaryPolicyLowerBound::getValue(const belief_vector& b,
+					const MDPNode* cn) const
+{
+  double val;
+  int i = policy.getBestPlane(b, useMaxPlanesMasking, val);
+  assert(-1 != i);
+  return val;
+}
+
+void BinaryPolicyLowerBound::initNodeBound(MDPNode& cn)
+{
+  cn.lbVal = getValue(cn.s, &cn);
+}
+
+void BinaryPolicyLowerBound::update(MDPNode& cn)
+{
+  fprintf(stderr, "ERROR: a binary policy file can not be updated during search; "
+	  "convert it with 'zmdp convertPolicy' first\n");
+  exit(EXIT_FAILURE);
+}
+
+int BinaryPolicyLowerBound::chooseAction(const state_vector& b)
+{
+  double val;
+  int i = policy.getBestPlane(b, useMaxPlanesMasking, val);
+  assert(-1 != i);
+  return policy.getAction(i);
+}
+
+int BinaryPolicyLowerBound::chooseActionWithMargin(const state_vector& b, double& margin)
+{
+  int i = policy.getBestPlaneWithMargin(b, useMaxPlanesMasking, margin);
+  assert(-1 != i);
+  return policy.getAction(i);
+}
+
+int BinaryPolicyLowerBound::getStorage(int whichMetric) const
+{
+  switch (whichMetric) {
+  case ZMDP_S_NUM_ELTS:
+    return policy.numPlanes;
+  default:
+    /* N/A */
+    return 0;
+  }
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
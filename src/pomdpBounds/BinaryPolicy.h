@@ -0,0 +1,130 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    BinaryPolicy.h
+ @brief   Binary, memory-mapped policy files for MaxPlanesLowerBound.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCBinaryPolicy_h
+#define INCBinaryPolicy_h
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "zmdpConfig.h"
+#include "IncrementalLowerBound.h"
+#include "Pomdp.h"
+
+namespace zmdp {
+
+struct LBPlane;
+
+// Binary policy files hold the same set of planes as the text policy
+// written by MaxPlanesLowerBound::writeToFile(), laid out so that a
+// memory-mapped file can be queried in place: plane actions, offsets,
+// and masks (one bit per state) are contiguous arrays, followed by the
+// alpha values of dense planes and the raw entries of sparse planes.
+// Like binary models, the format is specific to the architecture that
+// wrote it.  Policies are written in binary format when the output
+// filename has the '.policyb' extension; 'zmdp convertPolicy' converts
+// between binary, text, and Cassandra alpha policies.
+#define ZMDP_BINARY_POLICY_VERSION (1)
+
+struct BinaryPolicy {
+  std::string fileName;
+  int numStates;
+  int numPlanes;
+
+  BinaryPolicy(void);
+  ~BinaryPolicy(void);
+
+  // maps fileName into memory; the planes are not copied
+  void readFromFile(const std::string& _fileName);
+
+  // writes planes in binary format.  if useMasking is false, each plane
+  // is written with a full alpha vector and mask, as in the text format.
+  static void writeToFile(const std::string& outFileName,
+			  int numStates,
+			  const std::vector<const LBPlane*>& planes,
+			  bool useMasking);
+
+  // true if fileName has the binary policy extension ('.policyb')
+  static bool isBinaryPolicyFile(const std::string& fileName);
+
+  int getAction(int i) const { return actions[i]; }
+  // copies plane i out of the file
+  void getPlane(LBPlane& result, int i) const;
+
+  // returns the index of the applicable plane with the highest value at
+  // b, breaking ties in favor of the plane written first, and sets
+  // value.  the choice and value are identical to those made by
+  // MaxPlanesLowerBound for the same planes.
+  int getBestPlane(const belief_vector& b, bool useMasking,
+		   double& value) const;
+  // like getBestPlane(), but sets margin to how much the best plane
+  // beats the best plane with a different action (99e+20 if none)
+  int getBestPlaneWithMargin(const belief_vector& b, bool useMasking,
+			     double& margin) const;
+
+protected:
+  char* data;
+  size_t size;
+  const int32_t* actions;
+  const uint64_t* offsets;
+  const uint64_t* numEntries;
+  const uint64_t* masks;
+  const double* denseValues;
+  const cvector_entry* sparseEntries;
+  int maskWords;
+
+  bool isApplicable(int i, const belief_vector& b) const;
+  double innerProd(int i, const belief_vector& b) const;
+};
+
+// A read-only lower bound backed by a binary policy file.  Used by
+// BoundPairExec so that 'zmdp evaluate' can run a binary policy without
+// building a MaxPlanesLowerBound; it cannot be updated by search.
+struct BinaryPolicyLowerBound : public IncrementalLowerBound {
+  const Pomdp* pomdp;
+  bool useMaxPlanesMasking;
+  BinaryPolicy policy;
+
+  BinaryPolicyLowerBound(const MDP* _pomdp, const ZMDPConfig* config);
+
+  void readFromFile(const std::string& inFileName);
+
+  void initialize(double targetPrecision) {}
+  double getValue(const belief_vector& b, const MDPNode* cn) const;
+  void initNodeBound(MDPNode& cn);
+  void update(MDPNode& cn);
+  int chooseAction(const state_vector& b);
+  int chooseActionWithMargin(const state_vector& b, double& margin);
+  int getStorage(int whichMetric) const;
+};
+
+}; // namespace zmdp
+
+#endif // INCBinaryPolicy_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
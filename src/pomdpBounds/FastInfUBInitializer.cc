@@ -24,11 +24,14 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include <iostream>
 #include <fstream>
 
 #include "zmdpCommonDefs.h"
+#include "zmdpCommonTime.h"
+#include "zmdpThreads.h"
 #include "MatrixUtils.h"
 #include "Pomdp.h"
 #include "FastInfUBInitializer.h"
@@ -43,7 +46,104 @@ using namespace MatrixUtils;
 
 namespace zmdp {
 
-FastInfUBInitializer::FastInfUBInitializer(const MDP* problem, SawtoothUpperBound* _bound)
+typedef sla::dvector dvector;
+
+// scratch space for one thread's FIB updates
+struct FIBScratch {
+  dvector tmp, ocol, beta_aoi, beta_ao;
+  cmatrix weightedTtr;
+};
+
+// shared state for one FIB iteration; threads take actions from
+// nextAction until all actions are done
+struct FIBJob {
+  const Pomdp* pomdp;
+  const std::vector<dvector>* al;
+  std::vector<dvector>* nextAl;
+  ZMDPMutex lock;
+  int nextAction;
+};
+
+// computes the FIB update for action a:
+//   beta_a(s) = R(s,a) + discount * sum_o max_i sum_s' T(s,a,s') O(s',a,o) al_i(s')
+// the product of T(.,a,.) and the column O(.,a,o) does not depend on i,
+// so it is formed once per observation and reused for each i.
+static void backupFIBAction(const Pomdp* pomdp, int a,
+			    const std::vector<dvector>& al,
+			    dvector& beta_a, FIBScratch& w)
+{
+  const cmatrix& Oa = pomdp->getO(a);
+  const cmatrix& Ttra = pomdp->getTtr(a);
+
+  beta_a.resize(pomdp->numStates);
+  w.ocol.resize(pomdp->numStates);
+
+  FOR (o, pomdp->numObservations) {
+    typeof(Oa.data.begin()) obegin = Oa.data.begin() + Oa.col_starts[o];
+    typeof(Oa.data.begin()) oend = Oa.data.begin() + Oa.col_starts[o+1];
+    // observation o is impossible after action a; contributes 0
+    if (obegin == oend) continue;
+
+    for (typeof(obegin) oi = obegin; oi != oend; oi++) {
+      w.ocol(oi->index) = oi->value;
+    }
+
+    // weightedTtr(s',s) = O(s',a,o) * Ttr(s',s)
+    cmatrix& wt = w.weightedTtr;
+    wt.resize(Ttra.size1(), Ttra.size2());
+    FOR (s, Ttra.size2()) {
+      for (unsigned int j = Ttra.col_starts[s]; j < Ttra.col_starts[s+1]; j++) {
+	const cvector_entry& e = Ttra.data[j];
+	double v = w.ocol(e.index) * e.value;
+	if (0 != v) {
+	  wt.push_back(e.index, s, v);
+	}
+      }
+    }
+    wt.canonicalize();
+
+    for (typeof(obegin) oi = obegin; oi != oend; oi++) {
+      w.ocol(oi->index) = 0;
+    }
+
+    FOR (i, pomdp->numActions) {
+      mult( w.beta_aoi, al[i], wt );
+      if (0 == i) {
+	w.beta_ao = w.beta_aoi;
+      } else {
+	max_assign( w.beta_ao, w.beta_aoi );
+      }
+    }
+    beta_a += w.beta_ao;
+  }
+
+  beta_a *= pomdp->discount;
+  copy_from_column( w.tmp, pomdp->R, a );
+  beta_a += w.tmp;
+}
+
+static void runFIBWorker(FIBJob* job)
+{
+  FIBScratch w;
+  while (1) {
+    int a;
+    {
+      ZMDPMutexGuard g(job->lock);
+      a = job->nextAction++;
+    }
+    if (a >= job->pomdp->numActions) break;
+    backupFIBAction(job->pomdp, a, *job->al, (*job->nextAl)[a], w);
+  }
+}
+
+static void* fibWorkerMain(void* arg)
+{
+  runFIBWorker((FIBJob*) arg);
+  return NULL;
+}
+
+FastInfUBInitializer::FastInfUBInitializer(const MDP* problem, SawtoothUpperBound* _bound) :
+  numThreads(1)
 {
   pomdp = (const Pomdp*) problem;
   bound = _bound;
@@ -73,13 +173,11 @@ void FastInfUBInitializer::initMDP(double targetPrecision)
 
 void FastInfUBInitializer::initFIB(double targetPrecision)
 {
-  typedef sla::dvector dvector;
   // calculates the fast informed bound (Hauskrecht, JAIR 2000)
   std::vector< dvector > al(pomdp->numActions);
   std::vector< dvector > nextAl(pomdp->numActions);
-  dvector tmp, beta_aoi, beta_ao, diff;
+  dvector diff;
   double maxResidual;
-  alpha_vector backup;
 
   initMDP(MDP_RESIDUAL);
 
@@ -94,34 +192,43 @@ void FastInfUBInitializer::initFIB(double targetPrecision)
     m.nextAlphaAction(al[a], a);
   }
 
+  int threadsToUse = std::min(numThreads, pomdp->numActions);
+  if (threadsToUse > 1 && pomdp->canEvictActions()) {
+    // another thread could evict an action's matrices while they are
+    // in use
+    fprintf(stderr, "WARNING: numFIBThreads is ignored when lazyModelMemoryBudgetMB > 0; "
+	    "using 1 thread\n");
+    threadsToUse = 1;
+  }
+
   if (zmdpDebugLevelG >= 1) {
-    cout << "starting upper bound FIB iteration";
-    cout.flush();
+    cout << "starting upper bound FIB iteration (" << threadsToUse
+	 << " thread" << ((threadsToUse > 1) ? "s" : "") << ")" << endl;
   }
 
+  timeval fibStartTime = getTime();
+  int numIterations = 0;
+  std::vector<pthread_t> helpers(threadsToUse-1);
+
   // iterate FIB update rule to approximate convergence
   do {
-    FOR (a, pomdp->numActions) {
-      dvector& beta_a = nextAl[a];
-
-      set_to_zero( beta_a );
-
-      FOR (o, pomdp->numObservations) {
-	FOR (i, pomdp->numActions) {
-	  emult_column( tmp, pomdp->O[a], o, al[i] );
-	  mult( beta_aoi, tmp, pomdp->Ttr[a] );
-	  if (0 == i) {
-	    beta_ao = beta_aoi;
-	  } else {
-	    max_assign( beta_ao, beta_aoi );
-	  }
-	}
-	beta_a += beta_ao;
+    timeval iterStartTime = getTime();
+
+    // the updates for different actions are independent
+    FIBJob job;
+    job.pomdp = pomdp;
+    job.al = &al;
+    job.nextAl = &nextAl;
+    job.nextAction = 0;
+    FOR (t, threadsToUse-1) {
+      if (0 != pthread_create(&helpers[t], NULL, &fibWorkerMain, &job)) {
+	fprintf(stderr, "ERROR: couldn't create FIB thread %d\n", (int) (t+1));
+	exit(EXIT_FAILURE);
       }
-      
-      beta_a *= pomdp->discount;
-      copy_from_column( tmp, pomdp->R, a );
-      beta_a += tmp;
+    }
+    runFIBWorker(&job);
+    FOR (t, threadsToUse-1) {
+      pthread_join(helpers[t], NULL);
     }
 
     maxResidual = 0;
@@ -132,16 +239,21 @@ void FastInfUBInitializer::initFIB(double targetPrecision)
 
       al[a] = nextAl[a];
     }
+    numIterations++;
 
     if (zmdpDebugLevelG >= 1) {
-      cout << ".";
-      cout.flush();
+      printf("FIB iteration %d: residual=%g time=%.3fs\n",
+	     numIterations, maxResidual,
+	     timevalToSeconds(getTime() - iterStartTime));
+      fflush(stdout);
     }
 
   } while ( maxResidual > targetPrecision );
 
   if (zmdpDebugLevelG >= 1) {
-    cout << endl;
+    printf("FIB converged after %d iterations in %.3fs\n",
+	   numIterations, timevalToSeconds(getTime() - fibStartTime));
+    fflush(stdout);
   }
 
   dvector dalpha;
@@ -163,8 +275,8 @@ void FastInfUBInitializer::initFIB(double targetPrecision)
   }
 
   // write out result
-  bound->pts.clear();
-  copy(bound->cornerPts, dalpha);
+  bound->clearPoints();
+  bound->setCornerPts(dalpha);
 }
 
 }; // namespace zmdp
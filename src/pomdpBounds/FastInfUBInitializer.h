@@ -33,6 +33,8 @@ struct FastInfUBInitializer {
   const Pomdp* pomdp;
   SawtoothUpperBound* bound;
   std::vector<alpha_vector> alphas;
+  // number of threads used to compute the per-action FIB updates
+  int numThreads;
 
   FastInfUBInitializer(const MDP* problem, SawtoothUpperBound* _bound);
   void initialize(double targetPrecision);
@@ -45,14 +45,14 @@ void FullObsUBInitializer::nextAlphaAction(dvector& result, int a) {
 #if 0
   alpha_vector x(numStates), y(numStates);
   x = matrix_column<bmatrix>( pomdp->R, a );
-  y = pomdp->discount * prod( pomdp->T[a], alpha );
+  y = pomdp->discount * prod( pomdp->getT(a), alpha );
   cout << "x = " << maxRep(x) << endl;
   cout << "y = " << maxRep(y) << endl;
 #endif
 #if 0
   alpha_vector sum(numStates);
   sum = matrix_column<bmatrix>( pomdp->R, a )
-    + pomdp->discount * prod( pomdp->T[a], alpha );
+    + pomdp->discount * prod( pomdp->getT(a), alpha );
   cout << "a = " << a << endl
        << "sum = " << maxRep(sum) << endl;
   return sum;
@@ -60,14 +60,14 @@ void FullObsUBInitializer::nextAlphaAction(dvector& result, int a) {
 
   dvector R_xa;
 
-  mult( result, alpha, pomdp->Ttr[a] );
+  mult( result, alpha, pomdp->getTtr(a) );
   result *= pomdp->discount;
   copy_from_column( R_xa, pomdp->R, a );
   result += R_xa;
 
 #if 0
   return matrix_column<bmatrix>( pomdp->R, a )
-    + pomdp->discount * prod( pomdp->T[a], alpha );
+    + pomdp->discount * prod( pomdp->getT(a), alpha );
 #endif
 }
 
@@ -0,0 +1,294 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    LBPlaneMatrix.cc
+ @brief   Blocked plane store used to speed up MaxPlanesLowerBound queries.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "LBPlaneMatrix.h"
+#include "MaxPlanesLowerBound.h"
+
+// the blocked evaluation sums in a different order than inner_prod(),
+// so planes within this (relative) distance of the best value are
+// re-scored exactly before one is chosen
+#define LB_MATRIX_RESCORE_TOLERANCE (1e-7)
+
+using namespace std;
+using namespace sla;
+
+namespace zmdp {
+
+/**********************************************************************
+ * LOCAL HELPER FUNCTIONS
+ **********************************************************************/
+
+struct LBPlaneCandidate {
+  const LBPlane* plane;
+  double approxVal;
+  bool isExact;
+
+  LBPlaneCandidate(const LBPlane* _plane, double _approxVal, bool _isExact) :
+    plane(_plane),
+    approxVal(_approxVal),
+    isExact(_isExact)
+  {}
+};
+
+static inline double rescoreThreshold(double bestVal)
+{
+  return bestVal - LB_MATRIX_RESCORE_TOLERANCE * (1.0 + fabs(bestVal));
+}
+
+static bool maskContains(const mvector& m, unsigned int index)
+{
+  FOR_EACH (mi, m.data) {
+    if (mi->index >= index) return (mi->index == index);
+  }
+  return false;
+}
+
+/**********************************************************************
+ * LBPLANE BLOCK
+ **********************************************************************/
+
+void LBPlaneBlock::build(LBPlane** _planes, int _numPlanes)
+{
+  assert(_numPlanes <= LB_MATRIX_BLOCK_SIZE);
+  numPlanes = _numPlanes;
+  maxNumBackupsAtCreation = -1;
+
+  cols.clear();
+  FOR (p, numPlanes) {
+    LBPlane* plane = _planes[p];
+    planes[p] = plane;
+    maxNumBackupsAtCreation = std::max(maxNumBackupsAtCreation,
+				       plane->numBackupsAtCreation);
+    FOR_EACH (ai, plane->alpha.data) {
+      cols.push_back(ai->index);
+    }
+    FOR_EACH (mi, plane->mask.data) {
+      cols.push_back(mi->index);
+    }
+  }
+  std::sort(cols.begin(), cols.end());
+  cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+
+  colMasks.assign(cols.size(), 0);
+  values.assign(cols.size() * LB_MATRIX_BLOCK_SIZE, 0.0);
+  FOR (p, numPlanes) {
+    const LBPlane* plane = planes[p];
+    FOR_EACH (ai, plane->alpha.data) {
+      int c = std::lower_bound(cols.begin(), cols.end(), ai->index) - cols.begin();
+      values[c*LB_MATRIX_BLOCK_SIZE + p] = ai->value;
+    }
+    FOR_EACH (mi, plane->mask.data) {
+      int c = std::lower_bound(cols.begin(), cols.end(), mi->index) - cols.begin();
+      colMasks[c] |= ((uint64_t) 1) << p;
+    }
+  }
+}
+
+bool LBPlaneBlock::evaluate(double* result, uint64_t& applicable,
+			    const cvector& b, bool useMasking, bool useSupport) const
+{
+  if (cols.empty()) return false;
+
+  applicable = (LB_MATRIX_BLOCK_SIZE == numPlanes)
+    ? ~((uint64_t) 0) : ((((uint64_t) 1) << numPlanes) - 1);
+
+  const unsigned int* colBegin = &cols[0];
+  const unsigned int* colEnd = colBegin + cols.size();
+  if (useSupport) {
+    unsigned int supportIndex = b.data[0].index;
+    const unsigned int* ci = std::lower_bound(colBegin, colEnd, supportIndex);
+    if (ci == colEnd || *ci != supportIndex) return false;
+    applicable &= colMasks[ci - colBegin];
+    if (0 == applicable) return false;
+  }
+
+  FOR (p, LB_MATRIX_BLOCK_SIZE) {
+    result[p] = 0.0;
+  }
+
+  const unsigned int* ci = colBegin;
+  FOR_EACH (bi, b.data) {
+    ci = std::lower_bound(ci, colEnd, bi->index);
+    if (ci == colEnd || *ci != bi->index) {
+      // no plane in the block has an entry for this state
+      if (useMasking) return false;
+      if (ci == colEnd) break;
+      continue;
+    }
+    int c = ci - colBegin;
+    if (useMasking) {
+      applicable &= colMasks[c];
+      if (0 == applicable) return false;
+    }
+    const double* col = &values[c*LB_MATRIX_BLOCK_SIZE];
+    double bval = bi->value;
+    FOR (p, LB_MATRIX_BLOCK_SIZE) {
+      result[p] += bval * col[p];
+    }
+  }
+
+  return true;
+}
+
+size_t LBPlaneBlock::getNumBytes(void) const
+{
+  return sizeof(*this)
+    + cols.capacity() * sizeof(unsigned int)
+    + colMasks.capacity() * sizeof(uint64_t)
+    + values.capacity() * sizeof(double);
+}
+
+/**********************************************************************
+ * LBPLANE MATRIX
+ **********************************************************************/
+
+LBPlaneMatrix::~LBPlaneMatrix(void)
+{
+  clear();
+}
+
+void LBPlaneMatrix::clear(void)
+{
+  FOR_EACH (blockP, blocks) {
+    delete *blockP;
+  }
+  blocks.clear();
+  pending.clear();
+  order.clear();
+}
+
+void LBPlaneMatrix::add(LBPlane* plane)
+{
+  order.push_back(plane);
+  pending.push_back(plane);
+  if (LB_MATRIX_BLOCK_SIZE == pending.size()) {
+    packPending();
+  }
+}
+
+void LBPlaneMatrix::rebuild(const std::vector<LBPlane*>& planes)
+{
+  clear();
+  FOR_EACH (planeP, planes) {
+    add(*planeP);
+  }
+}
+
+void LBPlaneMatrix::packPending(void)
+{
+  LBPlaneBlock* block = new LBPlaneBlock();
+  block->build(&pending[0], pending.size());
+  blocks.push_back(block);
+  pending.clear();
+}
+
+const LBPlane* LBPlaneMatrix::getBestPlane(const cvector& b,
+					   bool useMasking,
+					   bool useSupport,
+					   const LBPlane* currPlane,
+					   int minNumBackups) const
+{
+  double bestVal = -99e+20;
+  double currVal = -99e+20;
+  if (NULL != currPlane) {
+    currVal = inner_prod(currPlane->alpha, b);
+    bestVal = currVal;
+  }
+
+  // collect planes whose approximate value is near the best seen so far
+  std::vector<LBPlaneCandidate> candidates;
+  double vals[LB_MATRIX_BLOCK_SIZE];
+  uint64_t applicable;
+  FOR_EACH (blockP, blocks) {
+    const LBPlaneBlock* block = *blockP;
+    if (NULL != currPlane && block->maxNumBackupsAtCreation < minNumBackups) continue;
+    if (!block->evaluate(vals, applicable, b, useMasking, useSupport)) continue;
+
+    FOR (p, block->numPlanes) {
+      if (0 == (applicable & (((uint64_t) 1) << p))) continue;
+      const LBPlane* plane = block->planes[p];
+      if (NULL != currPlane && plane->numBackupsAtCreation < minNumBackups) continue;
+      if (vals[p] >= rescoreThreshold(bestVal)) {
+	candidates.push_back(LBPlaneCandidate(plane, vals[p], false));
+	if (vals[p] > bestVal) bestVal = vals[p];
+      }
+    }
+  }
+
+  // the last few planes have not been packed yet; check them the same
+  // way the list-based representation does
+  unsigned int supportIndex = b.data[0].index;
+  FOR_EACH (planeP, pending) {
+    const LBPlane* plane = *planeP;
+    if (NULL != currPlane && plane->numBackupsAtCreation < minNumBackups) continue;
+    if (useSupport && !maskContains(plane->mask, supportIndex)) continue;
+    if (useMasking && !mask_subset(b, plane->mask)) continue;
+    double val = inner_prod(plane->alpha, b);
+    if (val >= rescoreThreshold(bestVal)) {
+      candidates.push_back(LBPlaneCandidate(plane, val, true));
+      if (val > bestVal) bestVal = val;
+    }
+  }
+
+  // pick the winner using exact values, in the original plane order
+  const LBPlane* ret = currPlane;
+  double maxval = currVal;
+  double threshold = rescoreThreshold(bestVal);
+  FOR_EACH (candP, candidates) {
+    if (candP->approxVal < threshold) continue;
+    double val = candP->isExact ? candP->approxVal
+      : inner_prod(candP->plane->alpha, b);
+    if (val > maxval) {
+      maxval = val;
+      ret = candP->plane;
+    }
+  }
+
+  return ret;
+}
+
+size_t LBPlaneMatrix::getNumBytes(void) const
+{
+  size_t numBytes = sizeof(*this)
+    + (pending.capacity() + order.capacity()) * sizeof(LBPlane*);
+  FOR_EACH (blockP, blocks) {
+    numBytes += (*blockP)->getNumBytes();
+  }
+  return numBytes;
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
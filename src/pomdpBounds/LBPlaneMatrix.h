@@ -0,0 +1,116 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    LBPlaneMatrix.h
+ @brief   Blocked plane store used to speed up MaxPlanesLowerBound queries.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCLBPlaneMatrix_h
+#define INCLBPlaneMatrix_h
+
+#include <stdint.h>
+
+#include <vector>
+#include <list>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTypes.h"
+#include "sla_mask.h"
+
+// number of planes packed into each block; one bit per plane in a
+// uint64_t applicability word
+#define LB_MATRIX_BLOCK_SIZE (64)
+
+namespace zmdp {
+
+struct LBPlane;
+
+// A group of up to LB_MATRIX_BLOCK_SIZE planes stored column-major over
+// the union of their supports.  Row p of column c holds plane p's alpha
+// value at state cols[c], so evaluating the whole block against a
+// belief is one axpy per belief entry.
+struct LBPlaneBlock {
+  int numPlanes;
+  int maxNumBackupsAtCreation;
+  LBPlane* planes[LB_MATRIX_BLOCK_SIZE];
+
+  // sorted states covered by at least one plane's alpha or mask
+  std::vector<unsigned int> cols;
+  // colMasks[c] has bit p set if plane p's mask includes cols[c]
+  std::vector<uint64_t> colMasks;
+  // values[c*LB_MATRIX_BLOCK_SIZE + p] = planes[p]->alpha(cols[c])
+  std::vector<double> values;
+
+  void build(LBPlane** _planes, int _numPlanes);
+  // returns false if no plane of the block is applicable to b
+  bool evaluate(double* result, uint64_t& applicable,
+		const sla::cvector& b, bool useMasking, bool useSupport) const;
+  size_t getNumBytes(void) const;
+};
+
+// An alternate plane store for MaxPlanesLowerBound.  Planes are
+// appended in the order they are added to the lower bound; every
+// LB_MATRIX_BLOCK_SIZE pending planes are packed into a new block.
+// Masks are kept as one bit per (state, plane) so that the
+// mask_subset() test for a whole block reduces to ANDing one word per
+// belief entry.
+//
+// Queries return exactly the plane the list-based scan would return:
+// the blocked evaluation only selects candidates, which are then
+// re-scored with the same inner_prod() call and tie-breaking order.
+struct LBPlaneMatrix {
+  std::vector<LBPlaneBlock*> blocks;
+  std::vector<LBPlane*> pending;
+  // all planes in block order, used to rebuild after pruning
+  std::vector<LBPlane*> order;
+
+  LBPlaneMatrix(void) {}
+  ~LBPlaneMatrix(void);
+
+  void clear(void);
+  void add(LBPlane* plane);
+  // replaces the contents with the given planes, in order
+  void rebuild(const std::vector<LBPlane*>& planes);
+
+  // returns the applicable plane with the highest value at b, breaking
+  // ties in favor of the plane added first.  if currPlane is non-NULL,
+  // only planes created at or after minNumBackups that beat currPlane
+  // strictly are considered, and currPlane is returned otherwise.
+  // if useSupport is set, planes whose mask does not include the first
+  // non-zero entry of b are skipped.
+  const LBPlane* getBestPlane(const sla::cvector& b,
+			      bool useMasking,
+			      bool useSupport,
+			      const LBPlane* currPlane,
+			      int minNumBackups) const;
+
+  size_t getNumBytes(void) const;
+
+protected:
+  void packPending(void);
+};
+
+}; // namespace zmdp
+
+#endif // INCLBPlaneMatrix_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -35,13 +35,23 @@
 
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTime.h"
+#include "zmdpThreads.h"
 #include "MatrixUtils.h"
+#include "SimplexSolver.h"
 #include "MaxPlanesLowerBound.h"
+#include "BinaryPolicy.h"
+#include "PolicyLog.h"
 #include "BlindLBInitializer.h"
+#include "WarmStartInitializer.h"
 
 #define PRUNE_PLANES_INCREMENT (10)
 #define PRUNE_PLANES_FACTOR (1.1)
 
+// limits for the LP filter in prunePlanesLP().  a plane is kept if
+// either limit is reached before its status is decided.
+#define LP_PRUNE_MAX_CUTS (100)
+#define LP_PRUNE_MAX_PIVOTS_PER_VAR (20)
+
 using namespace std;
 using namespace MatrixUtils;
 using namespace sla;
@@ -51,13 +61,57 @@ namespace zmdp {
 struct MaxPlanesData {
   LBPlane* bestPlane;
   int lastSetPlaneNumBackups;
+  MDPNode* node;
 
   MaxPlanesData(void) :
     bestPlane(NULL),
-    lastSetPlaneNumBackups(-1)
+    lastSetPlaneNumBackups(-1),
+    node(NULL)
   {}
 };
 
+// state for one two-phase pruning pass.  the pairwise dominance checks
+// only read the planes in the snapshot, so they can run on several
+// threads, or in the background while the search continues; the
+// deletions are applied later by finishPruneJob().
+struct LBPruneJob {
+  std::vector<LBPlane*> planes;
+  // planes created at or before this many backups were compared with
+  // each other during an earlier pass
+  int lastPruneNumBackups;
+  int numBackups;
+  bool useMaxPlanesMasking;
+  int numThreads;
+  int numRefCountDeletions;
+
+  // output: dominator[i] is the index of a plane that dominates
+  // planes[i], or -1
+  std::vector<int> dominator;
+  double computeSeconds;
+
+  bool hasThread;
+  pthread_t thread;
+  ZMDPMutex doneLock;
+  bool done;
+
+  LBPruneJob(void) :
+    numRefCountDeletions(0),
+    computeSeconds(0.0),
+    hasThread(false),
+    done(false)
+  {}
+
+  bool isDone(void) {
+    ZMDPMutexGuard guard(doneLock);
+    return done;
+  }
+};
+
+struct LBPruneWorkerArgs {
+  LBPruneJob* job;
+  int threadIndex;
+};
+
 /**********************************************************************
  * LOCAL HELPER FUNCTIONS
  **********************************************************************/
@@ -85,6 +139,79 @@ static bool dominates(const LBPlane* a, const LBPlane* b, bool useMaxPlanesMaski
   }
 }
 
+// plane i is removed in favor of plane j if j dominates i.  if they
+// dominate each other, the plane later in the snapshot is kept, which
+// matches the sequential pass.
+static void findDominators(LBPruneJob* job, int threadIndex)
+{
+  int n = job->planes.size();
+  std::vector<int> newIndices;
+  FOR (j, n) {
+    if (job->planes[j]->numBackupsAtCreation > job->lastPruneNumBackups) {
+      newIndices.push_back(j);
+    }
+  }
+
+  // interleave the candidates across threads, since old planes (which
+  // only need to be compared with new ones) are cheaper to check
+  for (int i = threadIndex; i < n; i += job->numThreads) {
+    const LBPlane* pi = job->planes[i];
+    bool iIsOld = (pi->numBackupsAtCreation <= job->lastPruneNumBackups);
+    int numToCheck = iIsOld ? newIndices.size() : n;
+    FOR (k, numToCheck) {
+      int j = iIsOld ? newIndices[k] : k;
+      if (j == i) continue;
+      const LBPlane* pj = job->planes[j];
+      if (dominates(pj, pi, job->useMaxPlanesMasking)
+	  && (j > i || !dominates(pi, pj, job->useMaxPlanesMasking))) {
+	job->dominator[i] = j;
+	break;
+      }
+    }
+  }
+}
+
+static void* pruneWorkerMain(void* args)
+{
+  LBPruneWorkerArgs* wargs = (LBPruneWorkerArgs*) args;
+  findDominators(wargs->job, wargs->threadIndex);
+  return NULL;
+}
+
+// runs the dominance checks for job, using job->numThreads threads
+// (counting the caller)
+static void runPruneJob(LBPruneJob* job)
+{
+  timeval startTime = getTime();
+  job->dominator.assign(job->planes.size(), -1);
+
+  int numHelpers = job->numThreads - 1;
+  std::vector<pthread_t> helpers(numHelpers);
+  std::vector<LBPruneWorkerArgs> helperArgs(numHelpers);
+  FOR (t, numHelpers) {
+    helperArgs[t].job = job;
+    helperArgs[t].threadIndex = t+1;
+    if (0 != pthread_create(&helpers[t], NULL, &pruneWorkerMain, &helperArgs[t])) {
+      fprintf(stderr, "ERROR: couldn't create pruning thread %d\n", (int) (t+1));
+      exit(EXIT_FAILURE);
+    }
+  }
+  findDominators(job, 0);
+  FOR (t, numHelpers) {
+    pthread_join(helpers[t], NULL);
+  }
+
+  job->computeSeconds = timevalToSeconds(getTime() - startTime);
+  ZMDPMutexGuard guard(job->doneLock);
+  job->done = true;
+}
+
+static void* pruneJobMain(void* args)
+{
+  runPruneJob((LBPruneJob*) args);
+  return NULL;
+}
+
 /**********************************************************************
  * LBPLANE
  **********************************************************************/
@@ -143,6 +270,8 @@ MaxPlanesLowerBound::MaxPlanesLowerBound(const MDP* _pomdp,
   pomdp((const Pomdp*) _pomdp),
   config(_config),
   core(NULL),
+  numPlanesCreated(0),
+  pruneJob(NULL),
   initialized(false)
 {
   lastPruneNumPlanes = 0;
@@ -151,6 +280,12 @@ MaxPlanesLowerBound::MaxPlanesLowerBound(const MDP* _pomdp,
   useMaxPlanesSupportList = config->getBool("useMaxPlanesSupportList");
   useMaxPlanesCache = config->getBool("useMaxPlanesCache");
   useMaxPlanesExtraPruning = config->getBool("useMaxPlanesExtraPruning");
+  useMaxPlanesMatrix = config->getBool("useMaxPlanesMatrix");
+  numPruneThreads = std::max(1, config->getInt("numPruneThreads"));
+  useBackgroundPruning = config->getBool("useBackgroundPruning");
+  useMaxPlanesLPPruning = config->getBool("useMaxPlanesLPPruning");
+  maxPlanesLPPruneInterval = config->getInt("maxPlanesLPPruneInterval");
+  numPassesSinceLPPrune = 0;
 
   if (useMaxPlanesSupportList) {
     supportList.resize(pomdp->getBeliefSize());
@@ -159,6 +294,13 @@ MaxPlanesLowerBound::MaxPlanesLowerBound(const MDP* _pomdp,
 
 MaxPlanesLowerBound::~MaxPlanesLowerBound(void)
 {
+  if (NULL != pruneJob) {
+    // discard the results of a background pass
+    if (pruneJob->hasThread) {
+      pthread_join(pruneJob->thread, NULL);
+    }
+    delete pruneJob;
+  }
   FOR_EACH (planeP, planes) {
     delete *planeP;
   }
@@ -171,6 +313,12 @@ void MaxPlanesLowerBound::initialize(double targetPrecision)
   BlindLBInitializer blb(pomdp, this);
   blb.initialize(targetPrecision);
 
+  std::string warmStartFile = config->getString("lowerBoundWarmStartFile");
+  if (warmStartFile != "none") {
+    WarmStartLBInitializer wlb(pomdp, this);
+    wlb.initialize(warmStartFile, targetPrecision);
+  }
+
   if (useMaxPlanesCache) {
     // planes from initialization should have their 'age' set appropriately
     FOR_EACH (planeP, planes) {
@@ -225,12 +373,12 @@ void MaxPlanesLowerBound::getNewLBPlaneQ(LBPlane& result, MDPNode& cn, int a)
       betaAO = defaultBetaAO;
     }
 
-    emult_column( tmp, pomdp->O[a], o, *betaAO );
+    emult_column( tmp, pomdp->getO(a), o, *betaAO );
     if (useMaxPlanesMasking) {
-      mult( tmp3, pomdp->T[a], tmp );
+      mult( tmp3, pomdp->getT(a), tmp );
       mask_copy( tmp2, tmp3, cn.s );
     } else {
-      mult( tmp2, tmp, pomdp->Ttr[a] );
+      mult( tmp2, tmp, pomdp->getTtr(a) );
     }
     betaA += tmp2;
   }
@@ -282,8 +430,9 @@ void MaxPlanesLowerBound::getNewLBPlane(LBPlane& result, MDPNode& cn)
 void MaxPlanesLowerBound::initNodeBound(MDPNode& cn)
 {
   if (useMaxPlanesCache) {
-    MaxPlanesData* bdata = new MaxPlanesData();
+    MaxPlanesData* bdata = core->nodeStore->newData<MaxPlanesData>();
     bdata->bestPlane = NULL;
+    bdata->node = &cn;
     cn.boundsData = bdata;
   }
 
@@ -295,9 +444,23 @@ void MaxPlanesLowerBound::initNodeBound(MDPNode& cn)
 }
 
 void MaxPlanesLowerBound::update(MDPNode& cn)
+{
+  commitUpdate(cn, computeUpdate(cn));
+}
+
+// calculates the backed up plane for cn without modifying the plane set
+void* MaxPlanesLowerBound::computeUpdate(MDPNode& cn)
 {
   LBPlane* newPlane = new LBPlane();
   getNewLBPlane(*newPlane, cn);
+  return newPlane;
+}
+
+// adds the plane returned by computeUpdate() to the plane set
+void MaxPlanesLowerBound::commitUpdate(MDPNode& cn, void* updateData)
+{
+  LBPlane* newPlane = (LBPlane*) updateData;
+  newPlane->numBackupsAtCreation = core->numBackups;
 
   setPlaneForNode(cn, newPlane);
 
@@ -310,6 +473,41 @@ int MaxPlanesLowerBound::chooseAction(const state_vector& b)
   return getBestLBPlaneConst(b).action; 
 }
 
+int MaxPlanesLowerBound::chooseActionWithMargin(const state_vector& b, double& margin)
+{
+  const PlaneSet* planesToCheck;
+  if (useMaxPlanesSupportList) {
+    planesToCheck = &supportList[b.data[0].index];
+  } else {
+    planesToCheck = &planes;
+  }
+
+  // same scan and tie-breaking as getBestLBPlaneConst(), also tracking
+  // the best value among planes whose action differs from the leader's
+  double val, maxval = -99e+20, otherval = -99e+20;
+  const LBPlane* ret = NULL;
+  FOR_EACH (pr, *planesToCheck) {
+    const LBPlane* al = *pr;
+    if (useMaxPlanesMasking) {
+      if (!mask_subset( b, al->mask )) continue;
+    }
+    val = inner_prod( al->alpha, b );
+    if (val > maxval) {
+      if (NULL != ret && ret->action != al->action) {
+	otherval = maxval;
+      }
+      maxval = val;
+      ret = al;
+    } else if (NULL != ret && al->action != ret->action && val > otherval) {
+      otherval = val;
+    }
+  }
+
+  assert(NULL != ret);
+  margin = (otherval > -99e+20) ? (maxval - otherval) : 99e+20;
+  return ret->action;
+}
+
 void MaxPlanesLowerBound::setPlaneForNode(MDPNode& cn, LBPlane* newPlane)
 {
   double newLB = inner_prod(newPlane->alpha, cn.s);
@@ -329,17 +527,17 @@ void MaxPlanesLowerBound::setPlaneForNode(MDPNode& cn, LBPlane* newPlane)
     MaxPlanesData* bdata = (MaxPlanesData*) cn.boundsData;
     LBPlane* oldPlane = bdata->bestPlane;
     if (NULL != oldPlane) {
-      // remove &bdata->bestPlane from oldPlane->backPointers
-      std::list<LBPlane**>& backPointers = oldPlane->backPointers;
+      // remove bdata from oldPlane->backPointers
+      std::list<MaxPlanesData*>& backPointers = oldPlane->backPointers;
       typeof(backPointers.begin()) eraseList =
-	std::remove(backPointers.begin(), backPointers.end(), &bdata->bestPlane);
+	std::remove(backPointers.begin(), backPointers.end(), bdata);
       backPointers.erase(eraseList);
     }
     
     cn.lbVal = newLB;
     bdata->bestPlane = newPlane;
     bdata->lastSetPlaneNumBackups = core->numBackups;
-    newPlane->backPointers.push_back(&bdata->bestPlane);
+    newPlane->backPointers.push_back(bdata);
   } else {
     cn.lbVal = newLB;
   }
@@ -370,6 +568,14 @@ const LBPlane& MaxPlanesLowerBound::getPlaneForNode(MDPNode& cn)
 // return the alpha such that alpha * b has the highest value
 const LBPlane& MaxPlanesLowerBound::getBestLBPlaneConst(const belief_vector& b) const
 {
+  if (useMaxPlanesMatrix) {
+    const LBPlane* ret = planeMatrix.getBestPlane(b, useMaxPlanesMasking,
+						  useMaxPlanesSupportList,
+						  NULL, 0);
+    assert(NULL != ret);
+    return *ret;
+  }
+
   const PlaneSet* planesToCheck;
   if (useMaxPlanesSupportList) {
     planesToCheck = &supportList[b.data[0].index];
@@ -406,6 +612,12 @@ LBPlane& MaxPlanesLowerBound::getBestLBPlaneWithCache(const belief_vector& b,
 						      LBPlane* currPlane,
 						      int lastSetPlaneNumBackups)
 {
+  if (useMaxPlanesMatrix) {
+    return (LBPlane&) *planeMatrix.getBestPlane(b, useMaxPlanesMasking,
+						useMaxPlanesSupportList,
+						currPlane, lastSetPlaneNumBackups);
+  }
+
   const PlaneSet* planesToCheck;
   if (useMaxPlanesSupportList) {
     planesToCheck = &supportList[b.data[0].index];
@@ -434,7 +646,11 @@ LBPlane& MaxPlanesLowerBound::getBestLBPlaneWithCache(const belief_vector& b,
 
 void MaxPlanesLowerBound::addLBPlane(LBPlane* av)
 {
+  av->creationIndex = numPlanesCreated++;
   planes.push_back(av);
+  if (useMaxPlanesMatrix) {
+    planeMatrix.add(av);
+  }
 
   if (useMaxPlanesSupportList) {
     // add new plane to supportList
@@ -444,7 +660,27 @@ void MaxPlanesLowerBound::addLBPlane(LBPlane* av)
   }
 }
 
+// runs a full pruning pass immediately
 void MaxPlanesLowerBound::prunePlanes(int numBackups)
+{
+  if (NULL != pruneJob) {
+    // apply the pass already in progress first
+    finishPruneJob();
+  }
+
+  if (numPruneThreads > 1) {
+    startPruneJob(numBackups, /* inBackground = */ false);
+    finishPruneJob();
+  } else {
+    timeval startTime = getTime();
+    int oldNum = planes.size();
+    prunePlanesSequential(numBackups);
+    pruneStats.addPass(oldNum - planes.size(),
+		       timevalToSeconds(getTime() - startTime));
+  }
+}
+
+void MaxPlanesLowerBound::prunePlanesSequential(int numBackups)
 {
   int oldNum = -1;
   int numRefCountDeletions = 0;
@@ -493,8 +729,16 @@ void MaxPlanesLowerBound::prunePlanes(int numBackups)
   nextCandidate: ;
   }
 
+  if (useMaxPlanesMatrix) {
+    rebuildPlaneMatrix();
+  }
+
   if (zmdpDebugLevelG >= 1) {
     cout << "... pruned # planes from " << oldNum << " down to " << planes.size() << endl;
+    if (useMaxPlanesMatrix) {
+      printf("[lower bound] plane matrix has %d blocks, %d kbytes\n",
+	     (int) planeMatrix.blocks.size(), (int) (planeMatrix.getNumBytes() / 1024));
+    }
     if (useMaxPlanesExtraPruning) {
       printf("[lower bound] refCount was used for %d of %d deletions\n",
 	     numRefCountDeletions, (int) (oldNum - planes.size()));
@@ -504,21 +748,363 @@ void MaxPlanesLowerBound::prunePlanes(int numBackups)
   lastPruneNumBackups = numBackups;
 }
 
+// snapshots the plane set and starts the dominance checks for a
+// two-phase pruning pass, either in the calling thread or in a
+// background thread.  the caller must later call finishPruneJob().
+void MaxPlanesLowerBound::startPruneJob(int numBackups, bool inBackground)
+{
+  assert(NULL == pruneJob);
+  LBPruneJob* job = new LBPruneJob();
+
+  if (useMaxPlanesExtraPruning) {
+    // planes that are not the best plane for any node can be dropped
+    // without comparing them against anything
+    typeof(planes.begin()) planeP = planes.begin();
+    while (planeP != planes.end()) {
+      if ((*planeP)->backPointers.empty()) {
+	deleteAndForward(*planeP, NULL);
+	planeP = eraseElement(planes, planeP);
+	job->numRefCountDeletions++;
+      } else {
+	planeP++;
+      }
+    }
+    if (useMaxPlanesMatrix && job->numRefCountDeletions > 0) {
+      rebuildPlaneMatrix();
+    }
+  }
+
+  job->planes.assign(planes.begin(), planes.end());
+  job->lastPruneNumBackups = lastPruneNumBackups;
+  job->numBackups = numBackups;
+  job->useMaxPlanesMasking = useMaxPlanesMasking;
+  job->numThreads = numPruneThreads;
+  pruneJob = job;
+
+  if (inBackground) {
+    job->hasThread = true;
+    if (0 != pthread_create(&job->thread, NULL, &pruneJobMain, job)) {
+      fprintf(stderr, "ERROR: couldn't create background pruning thread\n");
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    runPruneJob(job);
+  }
+}
+
+// waits for the current pruning pass to finish its dominance checks,
+// then deletes the dominated planes.  must be called at a point where
+// no other thread is reading the plane set.
+void MaxPlanesLowerBound::finishPruneJob(void)
+{
+  LBPruneJob* job = pruneJob;
+  if (job->hasThread) {
+    pthread_join(job->thread, NULL);
+  }
+  timeval startTime = getTime();
+  int n = job->planes.size();
+
+  // follow chains of dominators so that back pointers are forwarded to
+  // a plane that survives.  with a nonzero tolerance, dominance is not
+  // quite transitive; if a chain loops, the plane where the loop is
+  // detected survives.
+  std::vector<int> root(n, -1);
+  std::vector<int> path;
+  FOR (i, n) {
+    if (-1 != root[i]) continue;
+    path.clear();
+    int k = i;
+    int r;
+    while (1) {
+      if (root[k] >= 0) {
+	r = root[k];
+	break;
+      }
+      if (-2 == root[k]) {
+	job->dominator[k] = -1;
+	r = k;
+	break;
+      }
+      if (-1 == job->dominator[k]) {
+	r = k;
+	break;
+      }
+      root[k] = -2; // on the current path
+      path.push_back(k);
+      k = job->dominator[k];
+    }
+    FOR_EACH (pathP, path) {
+      root[*pathP] = r;
+    }
+    root[r] = r;
+  }
+
+  std::vector<bool> isDominator(n, false);
+  int numDeleted = 0;
+  FOR (i, n) {
+    if (root[i] != (int) i) {
+      deleteAndForward(job->planes[i], job->planes[root[i]]);
+      isDominator[root[i]] = true;
+      numDeleted++;
+    }
+  }
+
+  // as in the sequential pass, move planes that dominated others to
+  // the front.  planes added since the snapshot are still at the end.
+  PlaneSet newPlanes;
+  FOR (i, n) {
+    if (root[i] == (int) i && isDominator[i]) newPlanes.push_back(job->planes[i]);
+  }
+  FOR (i, n) {
+    if (root[i] == (int) i && !isDominator[i]) newPlanes.push_back(job->planes[i]);
+  }
+  typeof(planes.begin()) planeP = planes.begin();
+  FOR (i, n) {
+    planeP++;
+  }
+  newPlanes.insert(newPlanes.end(), planeP, planes.end());
+  int oldNum = planes.size() + job->numRefCountDeletions;
+  planes.swap(newPlanes);
+
+  lastPruneNumPlanes = planes.size();
+  lastPruneNumBackups = job->numBackups;
+  if (useMaxPlanesMatrix) {
+    rebuildPlaneMatrix();
+  }
+
+  double applySeconds = timevalToSeconds(getTime() - startTime);
+  pruneStats.addPass(numDeleted + job->numRefCountDeletions,
+		     job->computeSeconds + applySeconds);
+  if (zmdpDebugLevelG >= 1) {
+    printf("... pruned # planes from %d down to %d (%d threads%s, %.3lfs checking, %.3lfs applying)\n",
+	   oldNum, (int) planes.size(), job->numThreads,
+	   job->hasThread ? ", background" : "",
+	   job->computeSeconds, applySeconds);
+    if (useMaxPlanesExtraPruning) {
+      printf("[lower bound] refCount was used for %d of %d deletions\n",
+	     job->numRefCountDeletions, numDeleted + job->numRefCountDeletions);
+    }
+  }
+
+  delete job;
+  pruneJob = NULL;
+}
+
 // prune points and planes if the number has grown significantly
 // since the last check
 void MaxPlanesLowerBound::maybePrune(int numBackups)
 {
+  if (NULL != pruneJob) {
+    // a background pass is running; apply its results once it is done
+    if (!pruneJob->isDone()) return;
+    finishPruneJob();
+    numPassesSinceLPPrune++;
+  }
+
   unsigned int nextPruneNumPlanes = max(lastPruneNumPlanes + PRUNE_PLANES_INCREMENT,
 					(int) (lastPruneNumPlanes * PRUNE_PLANES_FACTOR));
   if (planes.size() > nextPruneNumPlanes) {
-    prunePlanes(numBackups);
+    if (useBackgroundPruning) {
+      startPruneJob(numBackups, /* inBackground = */ true);
+    } else {
+      prunePlanes(numBackups);
+      numPassesSinceLPPrune++;
+    }
+  }
+
+  if (useMaxPlanesLPPruning
+      && maxPlanesLPPruneInterval > 0
+      && numPassesSinceLPPrune >= maxPlanesLPPruneInterval
+      && NULL == pruneJob) {
+    prunePlanesLP(numBackups);
   }
 }
 
-void MaxPlanesLowerBound::deleteAndForward(LBPlane* victim, LBPlane* dominator)
+// returns true if there is a belief in the region where w applies at
+// which w beats all of the competitors by more than
+// ZMDP_BOUNDS_PRUNE_EPS.  this is the LP filter of Lark and White,
+// with the competitors added to the LP one at a time as they are
+// needed (at each step, the competitor that is best at the LP's
+// current optimal belief is added).
+bool MaxPlanesLowerBound::hasWitnessBelief(const LBPlane* w,
+					   const std::vector<LBPlane*>& competitors)
+{
+  if (competitors.empty()) return true;
+
+  // the states where beliefs in w's region can be non-zero
+  std::vector<int> region;
+  if (useMaxPlanesMasking) {
+    FOR_EACH (mi, w->mask.data) {
+      region.push_back(mi->index);
+    }
+  } else {
+    FOR (s, pomdp->numStates) {
+      region.push_back(s);
+    }
+  }
+  int n = region.size();
+  if (0 == n) return true;
+
+  dvector wd;
+  copy(wd, w->alpha);
+
+  // start the search at the uniform belief over the region
+  cvector b(pomdp->numStates);
+  FOR (k, n) {
+    b.push_back(region[k], 1.0 / n);
+  }
+
+  std::vector<const LBPlane*> cuts;
+  std::vector< std::vector<double> > cutCoeffs;
+  std::vector<double> x;
+  dvector ud;
+  SimplexSolver lp;
+  while (1) {
+    // find the competitor that is best at b
+    const LBPlane* bestU = NULL;
+    double bestVal = -99e+20;
+    FOR_EACH (uP, competitors) {
+      double val = inner_prod((*uP)->alpha, b);
+      if (val > bestVal) {
+	bestVal = val;
+	bestU = *uP;
+      }
+    }
+    if (inner_prod(w->alpha, b) - bestVal > ZMDP_BOUNDS_PRUNE_EPS) {
+      // b is a witness
+      return true;
+    }
+    if (cuts.size() >= LP_PRUNE_MAX_CUTS
+	|| cuts.end() != std::find(cuts.begin(), cuts.end(), bestU)) {
+      // out of cuts, or numerical trouble; keep w to be safe
+      return true;
+    }
+    cuts.push_back(bestU);
+    copy(ud, bestU->alpha);
+    cutCoeffs.push_back(std::vector<double>(n));
+    FOR (k, n) {
+      cutCoeffs.back()[k] = ud(region[k]) - wd(region[k]);
+    }
+
+    // maximize d
+    //   subject to  d + sum_k b_k (u(k) - w(k)) <= 0  for each cut u
+    //               sum_k b_k <= 1
+    //               b, d >= 0
+    // the optimum is positive exactly when some belief in the region
+    // has w beating every cut
+    int m = cuts.size() + 1;
+    lp.setSize(n+1, m);
+    lp.setObjective(n, 1.0);
+    FOR (c, cuts.size()) {
+      const std::vector<double>& coeffs = cutCoeffs[c];
+      FOR (k, n) {
+	lp.setConstraint(c, k, coeffs[k]);
+      }
+      lp.setConstraint(c, n, 1.0);
+      lp.setBound(c, 0.0);
+    }
+    FOR (k, n) {
+      lp.setConstraint(m-1, k, 1.0);
+    }
+    lp.setBound(m-1, 1.0);
+
+    if (SIMPLEX_OPTIMAL != lp.solve(LP_PRUNE_MAX_PIVOTS_PER_VAR * (n+m))) {
+      return true;
+    }
+    if (lp.getObjectiveValue() <= ZMDP_BOUNDS_PRUNE_EPS) {
+      // w is dominated by the upper envelope of the cuts
+      return false;
+    }
+
+    // check the LP's optimal belief against all of the competitors
+    lp.getSolution(x);
+    double sum = 0.0;
+    FOR (k, n) {
+      sum += x[k];
+    }
+    if (sum <= 0.0) return true;
+    b.resize(pomdp->numStates);
+    FOR (k, n) {
+      if (x[k] > 0.0) {
+	b.push_back(region[k], x[k] / sum);
+      }
+    }
+  }
+}
+
+// removes planes that are not the best plane anywhere in their region,
+// even if no single other plane dominates them.  much slower than
+// prunePlanes(), so it runs only occasionally (see
+// maxPlanesLPPruneInterval) and before writing a policy.
+void MaxPlanesLowerBound::prunePlanesLP(int numBackups)
+{
+  if (NULL != pruneJob) {
+    finishPruneJob();
+  }
+  timeval startTime = getTime();
+  int oldNum = planes.size();
+
+  std::vector<LBPlane*> candidates(planes.begin(), planes.end());
+  int n = candidates.size();
+  std::vector<bool> removed(n, false);
+  std::vector<LBPlane*> victims;
+  std::vector<LBPlane*> competitors;
+  FOR (i, n) {
+    LBPlane* w = candidates[i];
+    // with masking, only planes that apply wherever w applies can be
+    // used to rule w out
+    competitors.clear();
+    FOR (j, n) {
+      if (j == i || removed[j]) continue;
+      if (useMaxPlanesMasking && !mask_subset(w->mask, candidates[j]->mask)) continue;
+      competitors.push_back(candidates[j]);
+    }
+    if (!hasWitnessBelief(w, competitors)) {
+      removed[i] = true;
+      victims.push_back(w);
+    }
+  }
+
+  // take the victims out of the plane set before looking up new best
+  // planes for the nodes that pointed to them
+  PlaneSet newPlanes;
+  FOR (i, n) {
+    if (!removed[i]) newPlanes.push_back(candidates[i]);
+  }
+  planes.swap(newPlanes);
+  FOR_EACH (victimP, victims) {
+    removeFromSupportList(*victimP);
+  }
+  if (useMaxPlanesMatrix) {
+    rebuildPlaneMatrix();
+  }
+
+  FOR_EACH (victimP, victims) {
+    if (useMaxPlanesCache) {
+      FOR_EACH (bpP, (*victimP)->backPointers) {
+	MaxPlanesData* bdata = *bpP;
+	LBPlane* newPlane = &getBestLBPlane(bdata->node->s);
+	bdata->bestPlane = newPlane;
+	newPlane->backPointers.push_back(bdata);
+      }
+    }
+    delete *victimP;
+  }
+
+  lastPruneNumPlanes = planes.size();
+  numPassesSinceLPPrune = 0;
+
+  double elapsed = timevalToSeconds(getTime() - startTime);
+  pruneStats.addPass(victims.size(), elapsed);
+  if (zmdpDebugLevelG >= 1) {
+    printf("... LP pruning reduced # planes from %d down to %d (%.3lfs)\n",
+	   oldNum, (int) planes.size(), elapsed);
+  }
+}
+
+void MaxPlanesLowerBound::removeFromSupportList(LBPlane* victim)
 {
   if (useMaxPlanesSupportList) {
-    // remove victim from supportList
     FOR_EACH (ai, victim->mask.data) {
       PlaneSet& pi = supportList[ai->index];
       FOR_EACH (eltP, pi) {
@@ -529,20 +1115,51 @@ void MaxPlanesLowerBound::deleteAndForward(LBPlane* victim, LBPlane* dominator)
       }
     }
   }
+}
+
+void MaxPlanesLowerBound::deleteAndForward(LBPlane* victim, LBPlane* dominator)
+{
+  removeFromSupportList(victim);
   if (useMaxPlanesCache) {
     // forward backPointers from victim to dominator
     FOR_EACH (bpP, victim->backPointers) {
-      LBPlane** bp = *bpP;
-      *bp = dominator;
-      dominator->backPointers.push_back(bp);
+      MaxPlanesData* bdata = *bpP;
+      bdata->bestPlane = dominator;
+      dominator->backPointers.push_back(bdata);
     }
   }
 
   delete victim;
 }
 
+// repacks planeMatrix after pruning.  the matrix must visit planes in
+// the same order as the list-based queries so that ties are broken the
+// same way: the order of the support lists (creation order) if they are
+// in use, otherwise the order of the planes list.
+void MaxPlanesLowerBound::rebuildPlaneMatrix(void)
+{
+  std::vector<LBPlane*> newOrder;
+  if (useMaxPlanesSupportList) {
+    std::vector<LBPlane*> live(planes.begin(), planes.end());
+    std::sort(live.begin(), live.end());
+    FOR_EACH (planeP, planeMatrix.order) {
+      if (std::binary_search(live.begin(), live.end(), *planeP)) {
+	newOrder.push_back(*planeP);
+      }
+    }
+  } else {
+    newOrder.assign(planes.begin(), planes.end());
+  }
+  planeMatrix.rebuild(newOrder);
+}
+
 void MaxPlanesLowerBound::writeToFile(const std::string& outFileName) const
 {
+  if (BinaryPolicy::isBinaryPolicyFile(outFileName)) {
+    writeToBinaryFile(outFileName);
+    return;
+  }
+
   ofstream out(outFileName.c_str());
   if (!out) {
     cerr << "ERROR: MaxPlanesLowerBound::writeToFile: couldn't open " << outFileName
@@ -597,6 +1214,15 @@ void MaxPlanesLowerBound::writeToFile(const std::string& outFileName) const
 
 void MaxPlanesLowerBound::readFromFile(const std::string& inFileName)
 {
+  if (BinaryPolicy::isBinaryPolicyFile(inFileName)) {
+    readFromBinaryFile(inFileName);
+    return;
+  }
+  if (PolicyLog::isPolicyLogFile(inFileName)) {
+    readFromPolicyLog(inFileName);
+    return;
+  }
+
   ifstream inFile(inFileName.c_str());
   if (!inFile) {
     cerr << "ERROR: couldn't open " << inFileName << " for reading: "
@@ -694,6 +1320,50 @@ void MaxPlanesLowerBound::readFromFile(const std::string& inFileName)
   initialized = true;
 }
 
+void MaxPlanesLowerBound::writeToBinaryFile(const std::string& outFileName) const
+{
+  std::vector<const LBPlane*> planeVec(planes.begin(), planes.end());
+  BinaryPolicy::writeToFile(outFileName, pomdp->numStates, planeVec,
+			    useMaxPlanesMasking);
+}
+
+void MaxPlanesLowerBound::readFromBinaryFile(const std::string& inFileName)
+{
+  BinaryPolicy policy;
+  policy.readFromFile(inFileName);
+  if (policy.numStates != pomdp->numStates) {
+    fprintf(stderr, "ERROR: %s: policy has %d states but the model has %d\n",
+	    inFileName.c_str(), policy.numStates, pomdp->numStates);
+    exit(EXIT_FAILURE);
+  }
+
+  LBPlane plane;
+  FOR (i, policy.numPlanes) {
+    policy.getPlane(plane, i);
+    addLBPlane(new LBPlane(plane));
+  }
+
+  // the set of planes should have been pruned before it was written out
+  lastPruneNumPlanes = planes.size();
+  lastPruneNumBackups = -1;
+
+  initialized = true;
+}
+
+void MaxPlanesLowerBound::readFromPolicyLog(const std::string& inFileName)
+{
+  std::vector<LBPlane*> logPlanes;
+  PolicyLog::readPlanes(inFileName, pomdp->numStates, logPlanes);
+  FOR_EACH (planeP, logPlanes) {
+    addLBPlane(*planeP);
+  }
+
+  lastPruneNumPlanes = planes.size();
+  lastPruneNumBackups = -1;
+
+  initialized = true;
+}
+
 void MaxPlanesLowerBound::readFromCassandraAlphaFile(const std::string& inFileName)
 {
   ifstream inFile(inFileName.c_str());
@@ -710,12 +1380,17 @@ void MaxPlanesLowerBound::readFromCassandraAlphaFile(const std::string& inFileNa
   mask_set_all(plane.mask, pomdp->numStates);
   plane.numBackupsAtCreation = -1;
 
-  while (!inFile.eof()) {
-    inFile >> plane.action;
+  // checking the extraction rather than eof() avoids adding a bogus
+  // plane when the file ends with whitespace
+  while (inFile >> plane.action) {
     plane.alpha.clear();
     plane.alpha.resize(pomdp->numStates);
     for (int i=0; i < pomdp->numStates; i++) {
-      inFile >> val;
+      if (!(inFile >> val)) {
+	fprintf(stderr, "ERROR: %s: expected %d alpha vector entries after action %d\n",
+		inFileName.c_str(), pomdp->numStates, plane.action);
+	exit(EXIT_FAILURE);
+      }
       plane.alpha.push_back(i, val);
     }
     addLBPlane(new LBPlane(plane));
@@ -730,6 +1405,143 @@ void MaxPlanesLowerBound::readFromCassandraAlphaFile(const std::string& inFileNa
   initialized = true;
 }
 
+// the Cassandra alpha format has no masks, so masked planes are written
+// with zeros outside their masks and lose their restricted domain
+void MaxPlanesLowerBound::writeToCassandraAlphaFile(const std::string& outFileName) const
+{
+  FILE* out = fopen(outFileName.c_str(), "w");
+  if (NULL == out) {
+    fprintf(stderr, "ERROR: MaxPlanesLowerBound::writeToCassandraAlphaFile: couldn't open %s for writing: %s\n",
+	    outFileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  int numMasked = 0;
+  dvector alpha;
+  FOR_EACH (pr, planes) {
+    const LBPlane& p = **pr;
+    if (useMaxPlanesMasking && (int) p.mask.filled() < pomdp->numStates) {
+      numMasked++;
+    }
+    copy(alpha, p.alpha);
+    fprintf(out, "%d\n", p.action);
+    FOR (s, pomdp->numStates) {
+      fprintf(out, "%.17g ", alpha(s));
+    }
+    fprintf(out, "\n\n");
+  }
+  fclose(out);
+
+  if (numMasked > 0) {
+    fprintf(stderr, "WARNING: %s: %d of %d planes were masked; the Cassandra alpha format can not represent masks, so they were written with 0 outside their masks and may not be valid lower bounds there\n",
+	    outFileName.c_str(), numMasked, (int) planes.size());
+  }
+}
+
+// writes the plane set in order, then (if useMaxPlanesCache is set) the
+// cached plane of each search graph node
+void MaxPlanesLowerBound::writeCheckpoint(SolverCheckpointWriter& out)
+{
+  if (NULL != pruneJob) {
+    // apply the pass in progress so the plane set is settled
+    finishPruneJob();
+  }
+
+  out.beginSection("MAXPLANE");
+  out.writeInt(numPlanesCreated);
+  out.writeInt(lastPruneNumPlanes);
+  out.writeInt(lastPruneNumBackups);
+  out.writeInt(numPassesSinceLPPrune);
+  out.write(&pruneStats, sizeof(pruneStats));
+
+  EXT_NAMESPACE::hash_map<const LBPlane*, long long> planeIds;
+  out.writeInt(planes.size());
+  FOR_EACH (planeP, planes) {
+    const LBPlane& plane = **planeP;
+    long long id = planeIds.size();
+    planeIds[&plane] = id;
+    out.writeCVector(plane.alpha);
+    out.writeInt(plane.action);
+    out.writeCVector(plane.mask);
+    out.writeInt(plane.numBackupsAtCreation);
+    out.writeInt(plane.creationIndex);
+  }
+
+  out.writeInt(useMaxPlanesCache);
+  if (useMaxPlanesCache) {
+    FOR (i, core->nodeStore->numNodes) {
+      const MaxPlanesData* bdata =
+	(const MaxPlanesData*) core->nodeStore->getNode(i)->boundsData;
+      long long id = -1;
+      if (NULL != bdata->bestPlane) {
+	typeof(planeIds.begin()) pr = planeIds.find(bdata->bestPlane);
+	assert(planeIds.end() != pr);
+	id = pr->second;
+      }
+      out.writeInt(id);
+      out.writeInt(bdata->lastSetPlaneNumBackups);
+    }
+  }
+}
+
+void MaxPlanesLowerBound::readCheckpoint(SolverCheckpointReader& in,
+					 double targetPrecision)
+{
+  in.expectSection("MAXPLANE");
+  long long savedNumPlanesCreated = in.readInt();
+  lastPruneNumPlanes = in.readInt();
+  lastPruneNumBackups = in.readInt();
+  numPassesSinceLPPrune = in.readInt();
+  in.read(&pruneStats, sizeof(pruneStats));
+
+  long long numPlanes = in.readInt();
+  if (numPlanes < 0) {
+    in.fail("checkpoint is corrupted");
+  }
+  std::vector<LBPlane*> planeVec(numPlanes);
+  FOR (i, numPlanes) {
+    LBPlane* plane = new LBPlane();
+    in.readCVector(plane->alpha);
+    plane->action = in.readInt();
+    in.readCVector(plane->mask);
+    plane->numBackupsAtCreation = in.readInt();
+    long long creationIndex = in.readInt();
+    addLBPlane(plane);
+    plane->creationIndex = creationIndex;
+    planeVec[i] = plane;
+  }
+  numPlanesCreated = savedNumPlanesCreated;
+
+  if ((bool) in.readInt() != useMaxPlanesCache) {
+    in.fail("checkpoint was written with a different useMaxPlanesCache setting");
+  }
+  if (useMaxPlanesCache) {
+    FOR (i, core->nodeStore->numNodes) {
+      MDPNode& cn = *core->nodeStore->getNode(i);
+      MaxPlanesData* bdata = core->nodeStore->newData<MaxPlanesData>();
+      long long id = in.readInt();
+      if (id < -1 || id >= numPlanes) {
+	in.fail("checkpoint is corrupted");
+      }
+      bdata->bestPlane = (-1 == id) ? NULL : planeVec[id];
+      bdata->lastSetPlaneNumBackups = in.readInt();
+      bdata->node = &cn;
+      cn.boundsData = bdata;
+      if (NULL != bdata->bestPlane) {
+	bdata->bestPlane->backPointers.push_back(bdata);
+      }
+    }
+  }
+
+  initialized = true;
+}
+
+bool MaxPlanesLowerBound::getPruneStats(BoundPruneStats& stats) const
+{
+  stats = pruneStats;
+  return true;
+}
+
 int MaxPlanesLowerBound::getStorage(int whichMetric) const
 {
   switch (whichMetric) {
@@ -39,6 +39,7 @@
 #include "zmdpCommonTypes.h"
 #include "zmdpConfig.h"
 #include "sla_mask.h"
+#include "LBPlaneMatrix.h"
 #include "IncrementalLowerBound.h"
 #include "BoundPairCore.h"
 #include "Pomdp.h"
@@ -49,12 +50,18 @@
 
 namespace zmdp {
 
+struct MaxPlanesData;
+
 struct LBPlane {
   alpha_vector alpha;
   int action;
   sla::mvector mask;
   int numBackupsAtCreation;
-  std::list<LBPlane**> backPointers;
+  // assigned in the order planes are added to the bound; identifies the
+  // plane in policy checkpoint logs
+  long long creationIndex;
+  // bound data of the nodes whose cached best plane is this one
+  std::list<MaxPlanesData*> backPointers;
 
   LBPlane(void);
   LBPlane(const alpha_vector& _alpha, int _action, const sla::mvector& _mask);
@@ -63,11 +70,14 @@ struct LBPlane {
 
 typedef std::list< LBPlane* > PlaneSet;
 
+struct LBPruneJob;
+
 struct MaxPlanesLowerBound : public IncrementalLowerBound {
   const Pomdp* pomdp;
   const ZMDPConfig* config;
   BoundPairCore* core;
   PlaneSet planes;
+  long long numPlanesCreated;
   int lastPruneNumPlanes;
   int lastPruneNumBackups;
   std::vector<PlaneSet> supportList;
@@ -75,6 +85,16 @@ struct MaxPlanesLowerBound : public IncrementalLowerBound {
   bool useMaxPlanesSupportList;
   bool useMaxPlanesCache;
   bool useMaxPlanesExtraPruning;
+  bool useMaxPlanesMatrix;
+  LBPlaneMatrix planeMatrix;
+  int numPruneThreads;
+  bool useBackgroundPruning;
+  bool useMaxPlanesLPPruning;
+  int maxPlanesLPPruneInterval;
+  int numPassesSinceLPPrune;
+  // pruning pass in progress, or NULL
+  LBPruneJob* pruneJob;
+  BoundPruneStats pruneStats;
   bool initialized;
   
   MaxPlanesLowerBound(const MDP* _pomdp,
@@ -85,7 +105,10 @@ struct MaxPlanesLowerBound : public IncrementalLowerBound {
   double getValue(const belief_vector& b, const MDPNode* cn) const;
   void initNodeBound(MDPNode& cn);
   void update(MDPNode& cn);
+  void* computeUpdate(MDPNode& cn);
+  void commitUpdate(MDPNode& cn, void* updateData);
   int chooseAction(const state_vector& b);
+  int chooseActionWithMargin(const state_vector& b, double& margin);
 
   void getNewLBPlaneQ(LBPlane& result, MDPNode& cn, int a);
   void getNewLBPlane(LBPlane& result, MDPNode& cn);
@@ -99,13 +122,31 @@ struct MaxPlanesLowerBound : public IncrementalLowerBound {
 				   int lastSetPlaneNumBackups);
   void addLBPlane(LBPlane* av);
   void prunePlanes(int numBackups);
+  void prunePlanesSequential(int numBackups);
+  void startPruneJob(int numBackups, bool inBackground);
+  void finishPruneJob(void);
   void maybePrune(int numBackups);
+  bool hasWitnessBelief(const LBPlane* w, const std::vector<LBPlane*>& competitors);
+  void prunePlanesLP(int numBackups);
+  void removeFromSupportList(LBPlane* victim);
   void deleteAndForward(LBPlane* victim, LBPlane* dominator);
+  void rebuildPlaneMatrix(void);
 
+  // these read and write binary policies if the filename has the
+  // '.policyb' extension (see BinaryPolicy.h) and text policies
+  // otherwise.  readFromFile() also accepts a '.policylog' checkpoint log.
   void writeToFile(const std::string& outFileName) const;
   void readFromFile(const std::string& inFileName);
+  void writeToBinaryFile(const std::string& outFileName) const;
+  void readFromBinaryFile(const std::string& inFileName);
   void readFromCassandraAlphaFile(const std::string& inFileName);
+  // replays a policy checkpoint log (see PolicyLog.h)
+  void readFromPolicyLog(const std::string& inFileName);
+  void writeToCassandraAlphaFile(const std::string& outFileName) const;
   int getStorage(int whichMetric) const;
+  bool getPruneStats(BoundPruneStats& stats) const;
+  void writeCheckpoint(SolverCheckpointWriter& out);
+  void readCheckpoint(SolverCheckpointReader& in, double targetPrecision);
 };
 
 }; // namespace zmdp
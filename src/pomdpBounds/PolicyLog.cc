@@ -0,0 +1,510 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    PolicyLog.cc
+ @brief   Append-only policy checkpoint logs for MaxPlanesLowerBound.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+/***************************************************************************
+ * INCLUDES
+ ***************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <algorithm>
+#include <map>
+
+#include "zmdpCommonDefs.h"
+#include "MaxPlanesLowerBound.h"
+#include "PolicyLog.h"
+
+using namespace std;
+using namespace sla;
+
+namespace zmdp {
+
+/***************************************************************************
+ * FILE LAYOUT
+ *
+ * header
+ * for each checkpoint:
+ *   record header
+ *   deleted plane ids       (uint64 per plane)
+ *   for each added plane:
+ *     plane header
+ *     alpha entries         (raw cvector entries)
+ *     mask indices          (uint32 per entry)
+ *   plane order             (uint64 per plane, only if it changed)
+ *   record trailer          (repeats the record size)
+ *
+ * Every field starts on an 8-byte boundary.  Planes are identified by
+ * their creationIndex.  Without an explicit order, the plane order is
+ * the surviving planes in their previous order followed by the added
+ * planes in creation order.
+ ***************************************************************************/
+
+static const char PL_MAGIC[8] = { 'Z','M','D','P','L','O','G','\0' };
+static const uint32_t PL_BYTE_ORDER_MARK = 0x01020304;
+static const uint32_t PL_RECORD_MAGIC = 0x54504b43; // "CKPT"
+
+struct PLHeader {
+  char magic[8];
+  int32_t version;
+  uint32_t byteOrderMark;
+  int32_t entryBytes;
+  int32_t numStates;
+};
+
+struct PLRecordHeader {
+  uint32_t magic;
+  int32_t checkpointIndex;
+  uint64_t recordBytes;
+  double timeSoFar;
+  uint64_t numDeleted;
+  uint64_t numAdded;
+  uint64_t orderSize;
+};
+
+struct PLPlaneHeader {
+  int64_t id;
+  int32_t action;
+  int32_t reserved;
+  uint64_t numAlphaEntries;
+  uint64_t numMaskEntries;
+};
+
+struct PLRecordTrailer {
+  uint64_t recordBytes;
+  uint32_t magic;
+  uint32_t reserved;
+};
+
+static inline size_t plPadded(size_t n)
+{
+  return (n + 7) & ~((size_t) 7);
+}
+
+bool PolicyLog::isPolicyLogFile(const std::string& fileName)
+{
+  const char* ext = ".policylog";
+  size_t n = strlen(ext);
+  return (fileName.size() >= n
+	  && 0 == fileName.compare(fileName.size() - n, n, ext));
+}
+
+/***************************************************************************
+ * WRITING
+ ***************************************************************************/
+
+static void plAppend(std::vector<char>& buf, const void* x, size_t n)
+{
+  size_t pos = buf.size();
+  buf.resize(pos + plPadded(n), 0);
+  if (n > 0) memcpy(&buf[pos], x, n);
+}
+
+static void plAppendPlane(std::vector<char>& buf, const LBPlane& p)
+{
+  PLPlaneHeader ph;
+  memset(&ph, 0, sizeof(ph));
+  ph.id = p.creationIndex;
+  ph.action = p.action;
+  ph.numAlphaEntries = p.alpha.data.size();
+  ph.numMaskEntries = p.mask.data.size();
+  plAppend(buf, &ph, sizeof(ph));
+
+  // copy the entries field by field so the padding after each index
+  // stays zeroed
+  size_t pos = buf.size();
+  buf.resize(pos + ph.numAlphaEntries * sizeof(cvector_entry), 0);
+  cvector_entry* e = (cvector_entry*) &buf[pos];
+  FOR (i, ph.numAlphaEntries) {
+    e[i].index = p.alpha.data[i].index;
+    e[i].value = p.alpha.data[i].value;
+  }
+
+  pos = buf.size();
+  buf.resize(pos + plPadded(ph.numMaskEntries * sizeof(uint32_t)), 0);
+  uint32_t* m = (uint32_t*) &buf[pos];
+  FOR (i, ph.numMaskEntries) {
+    m[i] = p.mask.data[i].index;
+  }
+}
+
+static bool compareCreationIndex(const LBPlane* a, const LBPlane* b)
+{
+  return a->creationIndex < b->creationIndex;
+}
+
+PolicyLogWriter::PolicyLogWriter(const std::string& _fileName) :
+  fileName(_fileName),
+  outFile(NULL),
+  threadRunning(false),
+  closing(false),
+  numCheckpoints(0),
+  lastNumPlanesCreated(0)
+{}
+
+PolicyLogWriter::~PolicyLogWriter(void)
+{
+  close();
+}
+
+void PolicyLogWriter::open(int numStates)
+{
+  outFile = fopen(fileName.c_str(), "wb");
+  if (NULL == outFile) {
+    fprintf(stderr, "ERROR: couldn't open %s for writing: %s\n",
+	    fileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  PLHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, PL_MAGIC, sizeof(h.magic));
+  h.version = ZMDP_POLICY_LOG_VERSION;
+  h.byteOrderMark = PL_BYTE_ORDER_MARK;
+  h.entryBytes = sizeof(cvector_entry);
+  h.numStates = numStates;
+  if (1 != fwrite(&h, sizeof(h), 1, outFile) || 0 != fflush(outFile)) {
+    fprintf(stderr, "ERROR: error writing %s: %s\n",
+	    fileName.c_str(), strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  closing = false;
+  int err = pthread_create(&thread, NULL, &PolicyLogWriter::threadMain, this);
+  if (0 != err) {
+    fprintf(stderr, "ERROR: couldn't start policy log writer thread: %s\n",
+	    strerror(err));
+    exit(EXIT_FAILURE);
+  }
+  threadRunning = true;
+}
+
+void PolicyLogWriter::checkpoint(const MaxPlanesLowerBound& lb,
+				 double timeSoFar)
+{
+  assert(NULL != outFile);
+
+  // current order, and the same ids sorted for lookups
+  std::vector<long long> order;
+  order.reserve(lb.planes.size());
+  FOR_EACH (planeP, lb.planes) {
+    order.push_back((*planeP)->creationIndex);
+  }
+  std::vector<long long> sorted(order);
+  std::sort(sorted.begin(), sorted.end());
+
+  std::vector<uint64_t> deleted;
+  std::vector<long long> expectedOrder;
+  FOR_EACH (idP, lastOrder) {
+    if (std::binary_search(sorted.begin(), sorted.end(), *idP)) {
+      expectedOrder.push_back(*idP);
+    } else {
+      deleted.push_back(*idP);
+    }
+  }
+
+  // planes created since the last checkpoint have larger indices than
+  // any plane it recorded
+  std::vector<const LBPlane*> added;
+  FOR_EACH (planeP, lb.planes) {
+    if ((*planeP)->creationIndex >= lastNumPlanesCreated) {
+      added.push_back(*planeP);
+    }
+  }
+  std::sort(added.begin(), added.end(), compareCreationIndex);
+  FOR_EACH (planeP, added) {
+    expectedOrder.push_back((*planeP)->creationIndex);
+  }
+  bool writeOrder = (expectedOrder != order);
+
+  std::vector<char>* buf = new std::vector<char>();
+  PLRecordHeader rh;
+  memset(&rh, 0, sizeof(rh));
+  rh.magic = PL_RECORD_MAGIC;
+  rh.checkpointIndex = numCheckpoints;
+  rh.timeSoFar = timeSoFar;
+  rh.numDeleted = deleted.size();
+  rh.numAdded = added.size();
+  rh.orderSize = writeOrder ? order.size() : 0;
+  plAppend(*buf, &rh, sizeof(rh));
+  plAppend(*buf, deleted.empty() ? NULL : &deleted[0],
+	   deleted.size() * sizeof(uint64_t));
+  FOR_EACH (planeP, added) {
+    plAppendPlane(*buf, **planeP);
+  }
+  if (writeOrder) {
+    plAppend(*buf, &order[0], order.size() * sizeof(long long));
+  }
+  PLRecordTrailer rt;
+  memset(&rt, 0, sizeof(rt));
+  rt.magic = PL_RECORD_MAGIC;
+  rt.recordBytes = buf->size() + sizeof(rt);
+  plAppend(*buf, &rt, sizeof(rt));
+  rh.recordBytes = rt.recordBytes;
+  memcpy(&(*buf)[0], &rh, sizeof(rh));
+
+  if (zmdpDebugLevelG >= 1) {
+    printf("policy log: checkpoint %d: %d planes, %d added, %d deleted, %d kbytes%s\n",
+	   numCheckpoints, (int) order.size(), (int) added.size(),
+	   (int) deleted.size(), (int) (buf->size() / 1024),
+	   writeOrder ? " (order changed)" : "");
+  }
+
+  lastOrder.swap(order);
+  lastNumPlanesCreated = lb.numPlanesCreated;
+  numCheckpoints++;
+
+  queueLock.lock();
+  queue.push_back(buf);
+  queueChanged.broadcast();
+  queueLock.unlock();
+}
+
+void* PolicyLogWriter::threadMain(void* arg)
+{
+  ((PolicyLogWriter*) arg)->writeRecords();
+  return NULL;
+}
+
+void PolicyLogWriter::writeRecords(void)
+{
+  while (1) {
+    queueLock.lock();
+    while (queue.empty() && !closing) {
+      queueChanged.wait(queueLock);
+    }
+    if (queue.empty()) {
+      queueLock.unlock();
+      break;
+    }
+    std::vector<char>* buf = queue.front();
+    queue.pop_front();
+    queueLock.unlock();
+
+    // each record is flushed to disk before the next one is started, so
+    // an interrupted run loses at most the record being written
+    if (1 != fwrite(&(*buf)[0], buf->size(), 1, outFile)
+	|| 0 != fflush(outFile)
+	|| 0 != fdatasync(fileno(outFile))) {
+      fprintf(stderr, "ERROR: error writing %s: %s\n",
+	      fileName.c_str(), strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    delete buf;
+  }
+}
+
+void PolicyLogWriter::close(void)
+{
+  if (threadRunning) {
+    queueLock.lock();
+    closing = true;
+    queueChanged.broadcast();
+    queueLock.unlock();
+    pthread_join(thread, NULL);
+    threadRunning = false;
+  }
+  if (NULL != outFile) {
+    fclose(outFile);
+    outFile = NULL;
+  }
+}
+
+/***************************************************************************
+ * READING
+ ***************************************************************************/
+
+struct PLReader {
+  const char* data;
+  size_t size;
+  size_t pos;
+
+  const void* take(size_t n) {
+    assert(n <= size - pos);
+    const void* ret = data + pos;
+    pos += std::min(plPadded(n), size - pos);
+    return ret;
+  }
+};
+
+void PolicyLog::readPlanes(const std::string& fileName, int numStates,
+			   std::vector<LBPlane*>& result)
+{
+  int fd = open(fileName.c_str(), O_RDONLY);
+  struct stat statBuf;
+  if (-1 == fd || 0 != fstat(fd, &statBuf)) {
+    cerr << "ERROR: couldn't open " << fileName << " for reading: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  size_t size = statBuf.st_size;
+  if (size < sizeof(PLHeader)) {
+    cerr << "ERROR: " << fileName << ": not a ZMDP policy log file" << endl;
+    exit(EXIT_FAILURE);
+  }
+  char* data = (char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == data) {
+    cerr << "ERROR: couldn't map " << fileName << " into memory: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+
+  PLReader r;
+  r.data = data;
+  r.size = size;
+  r.pos = 0;
+
+  PLHeader h;
+  memcpy(&h, r.take(sizeof(h)), sizeof(h));
+  if (0 != memcmp(h.magic, PL_MAGIC, sizeof(h.magic))) {
+    cerr << "ERROR: " << fileName << ": not a ZMDP policy log file" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (h.byteOrderMark != PL_BYTE_ORDER_MARK
+      || h.entryBytes != (int) sizeof(cvector_entry)) {
+    cerr << "ERROR: " << fileName << ": policy log was written on an "
+	 << "incompatible architecture" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (h.version != ZMDP_POLICY_LOG_VERSION) {
+    cerr << "ERROR: " << fileName << ": policy log format version "
+	 << h.version << " is not supported (expected version "
+	 << ZMDP_POLICY_LOG_VERSION << ")" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (h.numStates != numStates) {
+    cerr << "ERROR: " << fileName << ": policy log has " << h.numStates
+	 << " states but the model has " << numStates << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::map<long long, LBPlane*> planesById;
+  std::vector<long long> order, newOrder;
+  int numRecords = 0;
+  double timeSoFar = 0;
+  while (r.pos < size) {
+    // only apply records that were completely written
+    PLRecordHeader rh;
+    PLRecordTrailer rt;
+    size_t start = r.pos;
+    if (size - start < sizeof(rh) + sizeof(rt)) break;
+    memcpy(&rh, data + start, sizeof(rh));
+    if (rh.magic != PL_RECORD_MAGIC
+	|| rh.recordBytes < sizeof(rh) + sizeof(rt)
+	|| rh.recordBytes > size - start) {
+      break;
+    }
+    memcpy(&rt, data + start + rh.recordBytes - sizeof(rt), sizeof(rt));
+    if (rt.magic != PL_RECORD_MAGIC || rt.recordBytes != rh.recordBytes) break;
+    r.take(sizeof(rh));
+
+    const uint64_t* deleted =
+      (const uint64_t*) r.take(rh.numDeleted * sizeof(uint64_t));
+    if (rh.numDeleted > 0) {
+      std::vector<long long> deletedIds(deleted, deleted + rh.numDeleted);
+      std::sort(deletedIds.begin(), deletedIds.end());
+      newOrder.clear();
+      FOR_EACH (idP, order) {
+	if (std::binary_search(deletedIds.begin(), deletedIds.end(), *idP)) {
+	  delete planesById[*idP];
+	  planesById.erase(*idP);
+	} else {
+	  newOrder.push_back(*idP);
+	}
+      }
+      order.swap(newOrder);
+    }
+
+    FOR (i, rh.numAdded) {
+      PLPlaneHeader ph;
+      memcpy(&ph, r.take(sizeof(ph)), sizeof(ph));
+      LBPlane* p = new LBPlane();
+      p->action = ph.action;
+      p->numBackupsAtCreation = -1;
+      p->alpha.resize(numStates);
+      const cvector_entry* e =
+	(const cvector_entry*) r.take(ph.numAlphaEntries * sizeof(cvector_entry));
+      p->alpha.data.assign(e, e + ph.numAlphaEntries);
+      const uint32_t* m =
+	(const uint32_t*) r.take(ph.numMaskEntries * sizeof(uint32_t));
+      p->mask.resize(numStates);
+      FOR (j, ph.numMaskEntries) {
+	p->mask.push_back(m[j], 1);
+      }
+      planesById[ph.id] = p;
+      order.push_back(ph.id);
+    }
+
+    if (rh.orderSize > 0) {
+      const long long* o =
+	(const long long*) r.take(rh.orderSize * sizeof(long long));
+      order.assign(o, o + rh.orderSize);
+    }
+    if (order.size() != planesById.size()) {
+      cerr << "ERROR: " << fileName << ": policy log is corrupt (checkpoint "
+	   << rh.checkpointIndex << ")" << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    r.pos = start + rh.recordBytes;
+    timeSoFar = rh.timeSoFar;
+    numRecords++;
+  }
+  if (r.pos < size) {
+    fprintf(stderr, "WARNING: %s: ignoring incomplete checkpoint at end of log\n",
+	    fileName.c_str());
+  }
+  munmap(data, size);
+
+  if (zmdpDebugLevelG >= 1) {
+    printf("policy log: replayed %d checkpoints, last at time %lf, %d planes\n",
+	   numRecords, timeSoFar, (int) order.size());
+  }
+
+  result.clear();
+  FOR_EACH (idP, order) {
+    typeof(planesById.begin()) pi = planesById.find(*idP);
+    if (pi == planesById.end()) {
+      cerr << "ERROR: " << fileName << ": policy log is corrupt" << endl;
+      exit(EXIT_FAILURE);
+    }
+    result.push_back(pi->second);
+  }
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
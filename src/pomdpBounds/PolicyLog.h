@@ -0,0 +1,103 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    PolicyLog.h
+ @brief   Append-only policy checkpoint logs for MaxPlanesLowerBound.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCPolicyLog_h
+#define INCPolicyLog_h
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <list>
+
+#include "zmdpThreads.h"
+
+namespace zmdp {
+
+struct LBPlane;
+struct MaxPlanesLowerBound;
+
+// A policy checkpoint log is a binary file with one record per
+// checkpoint.  Each record holds the planes deleted from and added to
+// the lower bound since the previous checkpoint (plus the plane order,
+// if pruning changed it), so a checkpoint costs time proportional to
+// the change in the policy rather than its size.  Replaying the log up
+// to its last complete record gives exactly the policy the bound held
+// at that checkpoint; a record cut short by an interrupted run is
+// ignored.  Logs have the extension '.policylog' and are specific to
+// the architecture that wrote them.  'zmdp convertPolicy' compacts a
+// log into a standard policy file.
+#define ZMDP_POLICY_LOG_VERSION (1)
+
+struct PolicyLog {
+  // true if fileName has the policy log extension ('.policylog')
+  static bool isPolicyLogFile(const std::string& fileName);
+
+  // replays the log, returning the planes of the last complete
+  // checkpoint in policy order.  the caller owns the planes.
+  static void readPlanes(const std::string& fileName, int numStates,
+			 std::vector<LBPlane*>& result);
+};
+
+// Records are serialized by checkpoint(), which must be called while
+// the bound is not being modified, and written to disk by a background
+// thread so the solver can continue while the write is in progress.
+struct PolicyLogWriter {
+  std::string fileName;
+
+  PolicyLogWriter(const std::string& _fileName);
+  ~PolicyLogWriter(void);
+
+  // creates the file and starts the writer thread
+  void open(int numStates);
+  bool isOpen(void) const { return NULL != outFile; }
+  void checkpoint(const MaxPlanesLowerBound& lb, double timeSoFar);
+  // waits for pending records to be written, then closes the file
+  void close(void);
+
+protected:
+  FILE* outFile;
+  pthread_t thread;
+  bool threadRunning;
+  bool closing;
+  ZMDPMutex queueLock;
+  ZMDPCondition queueChanged;
+  std::list<std::vector<char>*> queue;
+
+  int numCheckpoints;
+  // plane order and next creation index as of the last checkpoint
+  std::vector<long long> lastOrder;
+  long long lastNumPlanesCreated;
+
+  static void* threadMain(void* arg);
+  void writeRecords(void);
+};
+
+}; // namespace zmdp
+
+#endif // INCPolicyLog_h
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -29,15 +29,19 @@
 #include <unistd.h>
 #include <stdio.h>
 
+#include <string.h>
+#include <errno.h>
+
 #include <iostream>
+#include <fstream>
 #include <list>
 
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTime.h"
 #include "SawtoothUpperBound.h"
 #include "FastInfUBInitializer.h"
+#include "WarmStartInitializer.h"
 
-#define MIN_RATIO_EPS (1e-10)
 #define PRUNE_PTS_INCREMENT (10)
 #define PRUNE_PTS_FACTOR (2.0)
 #define CORNER_EPS (1e-6)
@@ -57,10 +61,11 @@ SawtoothUpperBound::SawtoothUpperBound(const MDP* _pomdp,
   lastPruneNumPts = 0;
   lastPruneNumBackups = -1;
   useSawtoothSupportList = config->getBool("useSawtoothSupportList");
+  useSawtoothSupportIndex = config->getBool("useSawtoothSupportIndex");
+  sawtoothNearestK = config->getInt("sawtoothNearestK");
 
-  if (useSawtoothSupportList) {
-    supportList.resize(pomdp->getBeliefSize());
-  }
+  store.init(numStates, useSawtoothSupportList, useSawtoothSupportIndex,
+	     sawtoothNearestK);
 }
 
 SawtoothUpperBound::~SawtoothUpperBound(void)
@@ -70,10 +75,29 @@ SawtoothUpperBound::~SawtoothUpperBound(void)
   }
 }
 
+static std::string stripWhiteSpace(const std::string& s)
+{
+  string::size_type p1, p2;
+  p1 = s.find_first_not_of(" \t");
+  if (string::npos == p1) {
+    return s;
+  } else {
+    p2 = s.find_last_not_of(" \t")+1;
+    return s.substr(p1, p2-p1);
+  }
+}
+
 void SawtoothUpperBound::initialize(double targetPrecision)
 {
   FastInfUBInitializer fib(pomdp, this);
+  fib.numThreads = std::max(1, config->getInt("numFIBThreads"));
   fib.initialize(targetPrecision);
+
+  std::string warmStartFile = config->getString("upperBoundWarmStartFile");
+  if (warmStartFile != "none") {
+    WarmStartUBInitializer wub(pomdp, this);
+    wub.initialize(warmStartFile, targetPrecision);
+  }
 }
 
 void SawtoothUpperBound::initNodeBound(MDPNode& cn)
@@ -87,8 +111,26 @@ void SawtoothUpperBound::initNodeBound(MDPNode& cn)
 
 void SawtoothUpperBound::update(MDPNode& cn, int* maxUBActionP)
 {
-  double newUBVal = getNewUBValue(cn, maxUBActionP);
-  setUBForNode(cn, newUBVal, true);
+  commitUpdate(cn, computeUpdate(cn, maxUBActionP), maxUBActionP);
+}
+
+// calculates the backed up value for cn without modifying the point set
+void* SawtoothUpperBound::computeUpdate(MDPNode& cn, int* maxUBActionP)
+{
+  return new BVPair(cn.s, getNewUBValue(cn, maxUBActionP));
+}
+
+// adds the point returned by computeUpdate() to the point set
+void SawtoothUpperBound::commitUpdate(MDPNode& cn, void* updateData,
+				      int* maxUBActionP)
+{
+  BVPair* newBV = (BVPair*) updateData;
+  newBV->numBackupsAtCreation = core->numBackups;
+
+  cn.ubVal = newBV->v;
+
+  addPoint(newBV);
+  maybePrune(core->numBackups);
 }
 
 // returns the upper bound that the (belief,value) pair c induces on b.
@@ -175,38 +217,13 @@ bool SawtoothUpperBound::dominates(const BVPair* xPair,
 
 double SawtoothUpperBound::getValue(const belief_vector& b, const MDPNode* cn) const
 {
-  const BVList* ptsToCheck;
-  if (useSawtoothSupportList) {
-    ptsToCheck = &supportList[b.data[0].index];
-  } else {
-    ptsToCheck = &pts;
-  }
-
-  double innerCornerPtsB = inner_prod(cornerPts, b);
-  double minValue = innerCornerPtsB;
-  FOR_EACH (cPairP, *ptsToCheck) {
-    double innerCornerPtsC = inner_prod(cornerPts, (*cPairP)->b);
-    minValue = std::min(minValue, getBVValue(b, *cPairP, innerCornerPtsB, innerCornerPtsC));
-  }
-  return minValue;
+  return store.getMinValue(b, inner_prod(cornerPts, b));
 }
 
 void SawtoothUpperBound::deleteAndForward(BVPair* victim,
 					  BVPair* dominator)
 {
-  if (useSawtoothSupportList) {
-    // remove victim from supportList
-    FOR_EACH (bi, victim->b.data) {
-      BVList& bvl = supportList[bi->index];
-      FOR_EACH (eltP, bvl) {
-	if (victim == *eltP) {
-	  eraseElement(bvl, eltP);
-	  break;
-	}
-      }
-    }
-  }
-
+  store.remove(victim);
   delete victim;
 }
 
@@ -216,23 +233,12 @@ void SawtoothUpperBound::prune(int numBackups) {
     oldNum = pts.size();
   }
 
-  FOR_EACH (ptP, pts) {
-    BVPair* pt = *ptP;
-    pt->innerCornerCache = inner_prod(cornerPts, pt->b);
-  }
-
   typeof(pts.begin()) candidateP = pts.begin();
   while (candidateP != pts.end()) {
     BVPair* candidate = *candidateP;
-    const BVList* ptsToCheck;
-    if (useSawtoothSupportList) {
-      ptsToCheck = &supportList[candidate->b.data[0].index];
-    } else {
-      ptsToCheck = &pts;
-    }
-    typeof(ptsToCheck->begin()) opponentP = ptsToCheck->begin();
-    while (opponentP != ptsToCheck->end()) {
-      BVPair* opponent = *opponentP;
+    const std::vector<int>& opponents = store.getCandidates(candidate->b);
+    FOR_EACH (opponentSlotP, opponents) {
+      BVPair* opponent = store.owners[*opponentSlotP];
       if (candidate == opponent) {
 	// duh, can't dominate yourself
       } else if (candidate->numBackupsAtCreation <= lastPruneNumBackups
@@ -245,11 +251,11 @@ void SawtoothUpperBound::prune(int numBackups) {
 	candidateP = eraseElement(pts, candidateP);
 	goto nextCandidate;
       }
-      opponentP++;
     }
     candidateP++;
   nextCandidate: ;
   }
+  store.maybeCompact();
 
   if (zmdpDebugLevelG >= 1) {
     cout << "... pruned # pts from " << oldNum << " down to " << pts.size() << endl;
@@ -288,40 +294,50 @@ int SawtoothUpperBound::whichCornerPoint(const belief_vector& b) const {
   }
 }
 
+// recomputes innerCornerCache for the points that depend on cornerPts(s)
+void SawtoothUpperBound::updateInnerCornerCache(int s)
+{
+  FOR_EACH (slotP, store.getSlotsTouching(s)) {
+    BVPair* pt = store.owners[*slotP];
+    store.setInnerCorner(pt, inner_prod(cornerPts, pt->b));
+  }
+}
+
+void SawtoothUpperBound::setCornerPts(const dvector& _cornerPts)
+{
+  copy(cornerPts, _cornerPts);
+  FOR_EACH (ptP, pts) {
+    BVPair* pt = *ptP;
+    store.setInnerCorner(pt, inner_prod(cornerPts, pt->b));
+  }
+}
+
+void SawtoothUpperBound::clearPoints(void)
+{
+  FOR_EACH (ptP, pts) {
+    delete *ptP;
+  }
+  pts.clear();
+  store.clear();
+}
+
 void SawtoothUpperBound::addPoint(BVPair* bv)
 {
   int wc = whichCornerPoint(bv->b);
   if (-1 == wc) {
-    if (useSawtoothSupportList) {
-      // add new point to supportList
-      FOR_EACH (bi, bv->b.data) {
-	supportList[bi->index].push_back(bv);
-      }
-    }
+    bv->innerCornerCache = inner_prod(cornerPts, bv->b);
     pts.push_back(bv);
+    store.add(bv);
   } else {
     cornerPts(wc) = bv->v;
+    updateInnerCornerCache(wc);
     delete bv;
   }
 }
 
 void SawtoothUpperBound::addPoint(const belief_vector& b, double val)
 {
-  int wc = whichCornerPoint(b);
-  if (-1 == wc) {
-    BVPair* bv = new BVPair(b,val);
-
-    if (useSawtoothSupportList) {
-      // add new point to supportList
-      FOR_EACH (bi, b.data) {
-	supportList[bi->index].push_back(bv);
-      }
-    }
-
-    pts.push_back(bv);
-  } else {
-    cornerPts(wc) = val;
-  }
+  addPoint(new BVPair(b,val));
 }
 
 void SawtoothUpperBound::printToStream(ostream& out) const
@@ -338,6 +354,189 @@ void SawtoothUpperBound::printToStream(ostream& out) const
   out << "}" << endl;
 }
 
+void SawtoothUpperBound::writeToFile(const std::string& outFileName) const
+{
+  ofstream out(outFileName.c_str());
+  if (!out) {
+    cerr << "ERROR: SawtoothUpperBound::writeToFile: couldn't open " << outFileName
+	 << " for writing: " << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  out <<
+"# This file is an upper bound on the value function of a POMDP,\n"
+"# represented as a set of corner point values (the bound at each\n"
+"# state) and a set of belief/value points.  The bound at a belief b is\n"
+"# the sawtooth interpolation of these points.  It can be passed to a\n"
+"# later run with the upperBoundWarmStartFile parameter, which re-backs\n"
+"# up the beliefs under that run's model; the values recorded here are\n"
+"# only valid for the model that produced them.\n"
+"\n"
+    ;
+  out << "{" << endl;
+  out << "  upperBoundType => \"SawtoothUpperBound\"," << endl;
+  out << "  numStates => " << numStates << "," << endl;
+  out << "  cornerPoints => [" << endl;
+  FOR (i, numStates) {
+    out << "    " << i << ", " << cornerPts(i)
+	<< ((((int) i) < numStates-1) ? "," : "") << endl;
+  }
+  out << "  ]," << endl;
+  out << "  numPoints => " << pts.size() << "," << endl;
+  out << "  points => [" << endl;
+
+  int i = 0;
+  FOR_EACH (ptP, pts) {
+    const BVPair* pt = *ptP;
+    out << "    {" << endl;
+    out << "      value => " << pt->v << "," << endl;
+    out << "      numEntries => " << pt->b.filled() << "," << endl;
+    out << "      entries => [" << endl;
+    bool firstEntry = true;
+    FOR_CV (pt->b) {
+      if (!firstEntry) {
+	out << "," << endl;
+      }
+      out << "        " << CV_INDEX(pt->b) << ", " << CV_VAL(pt->b);
+      firstEntry = false;
+    }
+    out << endl;
+    out << "      ]" << endl;
+    out << "    }" << ((i < ((int) pts.size())-1) ? "," : "") << endl;
+    i++;
+  }
+
+  out << "  ]" << endl;
+  out << "}" << endl;
+
+  out.close();
+}
+
+void SawtoothUpperBound::readPointsFromFile(const std::string& inFileName,
+					    int numStates,
+					    std::vector<BVPair*>& result)
+{
+  ifstream inFile(inFileName.c_str());
+  if (!inFile) {
+    cerr << "ERROR: couldn't open " << inFileName << " for reading: "
+	 << strerror(errno) << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  char buf[1024];
+  std::string s;
+  BVPair* pt = NULL;
+  int fileNumStates;
+  int entryIndex;
+  double entryVal;
+  int parseState = 0;
+  int lnum = 0;
+  while (!inFile.eof()) {
+    inFile.getline(buf, sizeof(buf));
+    lnum++;
+
+    // strip whitespace, ignore empty lines and comments
+    s = stripWhiteSpace(buf);
+    if (0 == s.size()) continue;
+    if ('#' == s[0]) continue;
+
+    // ignore these types of lines because they contain redundant information
+    if (s == "{") continue;
+    if (s == "}" or s == "},") continue;
+    if (s == "[") continue;
+    if (s == "]" or s == "],") continue;
+    if (string::npos != s.find("numPoints")) continue;
+    if (string::npos != s.find("numEntries")) continue;
+    if (string::npos != s.find("entries")) continue;
+
+    switch (parseState) {
+    case 0:
+      /* at the beginning of the file, check that this is the right type of bound */
+      if (string::npos != s.find("upperBoundType")
+	  && string::npos != s.find("SawtoothUpperBound")) {
+	parseState = 1;
+      } else {
+	fprintf(stderr, "ERROR: %s: line %d: expected 'upperBoundType => \"SawtoothUpperBound\"'\n",
+		inFileName.c_str(), lnum);
+	exit(EXIT_FAILURE);
+      }
+      break;
+    case 1:
+      /* check the number of states */
+      if (1 == sscanf(s.c_str(), "numStates => %d", &fileNumStates)) {
+	if (fileNumStates != numStates) {
+	  fprintf(stderr, "ERROR: %s: upper bound has %d states, but the model has %d\n",
+		  inFileName.c_str(), fileNumStates, numStates);
+	  exit(EXIT_FAILURE);
+	}
+	parseState = 2;
+      } else {
+	fprintf(stderr, "ERROR: %s: line %d: expected 'numStates => <int>'\n",
+		inFileName.c_str(), lnum);
+	exit(EXIT_FAILURE);
+      }
+      break;
+    case 2:
+      /* the corner point values are specific to the model that wrote the
+	 file; skip them */
+      if (string::npos != s.find("points")) {
+	parseState = 3;
+      }
+      break;
+    case 3:
+    case 4:
+      if (string::npos != s.find("value")) {
+	/* start of a point */
+	pt = new BVPair();
+	pt->b.resize(numStates);
+	pt->numBackupsAtCreation = 0;
+	if (1 != sscanf(s.c_str(), "value => %lf", &pt->v)) {
+	  fprintf(stderr, "ERROR: %s: line %d: expected 'value => <double>'\n",
+		  inFileName.c_str(), lnum);
+	  exit(EXIT_FAILURE);
+	}
+	result.push_back(pt);
+	parseState = 4;
+      } else if (4 == parseState
+		 && 2 == sscanf(s.c_str(), "%d, %lf", &entryIndex, &entryVal)) {
+	/* push another entry into the current point */
+	if (entryIndex < 0 || entryIndex >= numStates) {
+	  fprintf(stderr, "ERROR: %s: line %d: state index %d out of range\n",
+		  inFileName.c_str(), lnum, entryIndex);
+	  exit(EXIT_FAILURE);
+	}
+	pt->b.push_back(entryIndex, entryVal);
+      } else {
+	fprintf(stderr, "ERROR: %s: line %d: expected 'value => <double>' or entry '<int>, <double>'\n",
+		inFileName.c_str(), lnum);
+	exit(EXIT_FAILURE);
+      }
+      break;
+    default:
+      assert(0); // never reach this point
+    }
+  }
+  inFile.close();
+
+  if (parseState < 2) {
+    fprintf(stderr, "ERROR: %s: unexpected end of file\n", inFileName.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  // values are written with limited precision; make sure each belief
+  // still sums to 1
+  FOR_EACH (ptP, result) {
+    BVPair* p = *ptP;
+    double total = sum(p->b);
+    if (total <= 0.0) {
+      fprintf(stderr, "ERROR: %s: point with no probability mass\n",
+	      inFileName.c_str());
+      exit(EXIT_FAILURE);
+    }
+    p->b *= (1.0/total);
+  }
+}
+
 // upper bound on long-term reward for taking action a
 double SawtoothUpperBound::getNewUBValueQ(MDPNode& cn, int a)
 {
@@ -347,7 +546,13 @@ double SawtoothUpperBound::getNewUBValueQ(MDPNode& cn, int a)
   FOR (o, Qa.getNumOutcomes()) {
     MDPEdge* e = Qa.outcomes[o];
     if (NULL != e) {
-      val += e->obsProb * getValue(e->nextState->s, NULL);
+      double nextVal = getValue(e->nextState->s, NULL);
+      if (sawtoothNearestK > 0) {
+	// the nearest-point interpolation can rise as points are added,
+	// so make sure the backup never exceeds the successor's bound
+	nextVal = std::min(nextVal, e->nextState->ubVal);
+      }
+      val += e->obsProb * nextVal;
     }
   }
   val = Qa.immediateReward + pomdp->getDiscount() * val;
@@ -456,6 +661,40 @@ void SawtoothUpperBound::setUBForNode(MDPNode& cn, double newUB, bool addBV)
   }
 }
 
+void SawtoothUpperBound::writeCheckpoint(SolverCheckpointWriter& out)
+{
+  out.beginSection("SAWTOOTH");
+  out.writeInt(lastPruneNumPts);
+  out.writeInt(lastPruneNumBackups);
+  out.writeDVector(cornerPts);
+  out.writeInt(pts.size());
+  FOR_EACH (ptP, pts) {
+    const BVPair* pt = *ptP;
+    out.writeCVector(pt->b);
+    out.writeDouble(pt->v);
+    out.writeInt(pt->numBackupsAtCreation);
+  }
+}
+
+void SawtoothUpperBound::readCheckpoint(SolverCheckpointReader& in,
+					double targetPrecision)
+{
+  in.expectSection("SAWTOOTH");
+  lastPruneNumPts = in.readInt();
+  lastPruneNumBackups = in.readInt();
+  dvector savedCornerPts;
+  in.readDVector(savedCornerPts);
+  setCornerPts(savedCornerPts);
+  long long numPts = in.readInt();
+  FOR (i, numPts) {
+    BVPair* pt = new BVPair();
+    in.readCVector(pt->b);
+    pt->v = in.readDouble();
+    pt->numBackupsAtCreation = in.readInt();
+    addPoint(pt);
+  }
+}
+
 int SawtoothUpperBound::getStorage(int whichMetric) const
 {
   switch (whichMetric) {
@@ -480,6 +719,13 @@ int SawtoothUpperBound::getStorage(int whichMetric) const
   }
 }
 
+void SawtoothUpperBound::printQueryStats(std::ostream& out) const
+{
+  if (store.collectQueryStats) {
+    store.printQueryStats(out);
+  }
+}
+
 }; // namespace zmdp
 
 /***************************************************************************
@@ -24,25 +24,32 @@
 #define INCSawtoothUpperBound_h
 
 #include <list>
+#include <string>
+#include <vector>
 
 #include "zmdpConfig.h"
 #include "MatrixUtils.h"
 #include "Pomdp.h"
 #include "IncrementalUpperBound.h"
 #include "BoundPairCore.h"
+#include "BVPointStore.h"
 
 #define PRUNE_EPS (1e-10)
+#define MIN_RATIO_EPS (1e-10)
 
 namespace zmdp {
 
 struct BVPair {
   belief_vector b;
   double v;
+  // inner_prod(cornerPts, b), kept up to date as cornerPts changes
   double innerCornerCache;
   int numBackupsAtCreation;
+  // index of the point in SawtoothUpperBound::store
+  int slot;
 
-  BVPair(void) {}
-  BVPair(const belief_vector& _b, double _v) : b(_b), v(_v) {}
+  BVPair(void) : slot(-1) {}
+  BVPair(const belief_vector& _b, double _v) : b(_b), v(_v), slot(-1) {}
 };
 
 typedef std::list<BVPair*> BVList;
@@ -56,8 +63,10 @@ struct SawtoothUpperBound : public IncrementalUpperBound {
   int lastPruneNumBackups;
   BVList pts;
   sla::dvector cornerPts;
-  std::vector<BVList> supportList;
+  BVPointStore store;
   bool useSawtoothSupportList;
+  bool useSawtoothSupportIndex;
+  int sawtoothNearestK;
 
   SawtoothUpperBound(const MDP* _pomdp,
 		     const ZMDPConfig* _config);
@@ -67,6 +76,8 @@ struct SawtoothUpperBound : public IncrementalUpperBound {
   double getValue(const belief_vector& b, const MDPNode* cn) const;
   void initNodeBound(MDPNode& cn);
   void update(MDPNode& cn, int* maxUBActionP);
+  void* computeUpdate(MDPNode& cn, int* maxUBActionP);
+  void commitUpdate(MDPNode& cn, void* updateData, int* maxUBActionP);
 
   static double getBVValue(const belief_vector& b,
 			   const BVPair* cPair,
@@ -81,10 +92,21 @@ struct SawtoothUpperBound : public IncrementalUpperBound {
   void maybePrune(int numBackups);
 
   int whichCornerPoint(const belief_vector& b) const;
+  void setCornerPts(const sla::dvector& _cornerPts);
+  void updateInnerCornerCache(int s);
+  void clearPoints(void);
   void addPoint(const belief_vector& b, double val);
   void addPoint(BVPair* bv);
   void printToStream(std::ostream& out) const;
 
+  // writes the corner points and the point set to a text 'upper bound
+  // file', in the same style as text policy files
+  void writeToFile(const std::string& outFileName) const;
+  // reads the points of an upper bound file, renormalizing each belief.
+  // the caller owns the points.
+  static void readPointsFromFile(const std::string& inFileName, int numStates,
+				 std::vector<BVPair*>& result);
+
   double getNewUBValueQ(MDPNode& cn, int a);
   double getNewUBValueSimple(MDPNode& cn, int* maxUBActionP);
   double getNewUBValueUseCache(MDPNode& cn, int* maxUBActionP);
@@ -92,6 +114,9 @@ struct SawtoothUpperBound : public IncrementalUpperBound {
   void setUBForNode(MDPNode& cn, double newUB, bool addBV);
   double getUBForNode(MDPNode& cn);
   int getStorage(int whichMetric) const;
+  void printQueryStats(std::ostream& out) const;
+  void writeCheckpoint(SolverCheckpointWriter& out);
+  void readCheckpoint(SolverCheckpointReader& in, double targetPrecision);
 };
 
 }; // namespace zmdp
@@ -0,0 +1,292 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    WarmStartInitializer.cc
+ @brief   No brief
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include <iostream>
+#include <fstream>
+
+#include "zmdpCommonDefs.h"
+#include "zmdpCommonTime.h"
+#include "MatrixUtils.h"
+#include "Pomdp.h"
+#include "WarmStartInitializer.h"
+
+using namespace std;
+using namespace sla;
+using namespace MatrixUtils;
+
+// cap on controller evaluation sweeps.  the values only increase from
+// the worst-case bound, so stopping early still gives a valid (looser)
+// lower bound; this matters with discount 1, where convergence can be
+// arbitrarily slow.
+#define WS_MAX_EVALUATION_SWEEPS (10000)
+
+namespace zmdp {
+
+static bool isTerminalBelief(const Pomdp* pomdp, const belief_vector& b)
+{
+  double nonTerminalSum = 0.0;
+  FOR_CV (b) {
+    if (!pomdp->isTerminalState[CV_INDEX(b)]) {
+      nonTerminalSum += CV_VAL(b);
+    }
+  }
+  return (nonTerminalSum < 1e-10);
+}
+
+/**********************************************************************
+ * WarmStartLBInitializer
+ **********************************************************************/
+
+WarmStartLBInitializer::WarmStartLBInitializer(const MDP* _pomdp,
+					       MaxPlanesLowerBound* _bound) :
+  BlindLBInitializer(_pomdp, _bound)
+{}
+
+// returns the index of the old plane that is best at b, or -1 if no
+// plane applies to b
+int WarmStartLBInitializer::getBestOldPlane(const std::vector<LBPlane*>& oldPlanes,
+					    bool useMaxPlanesMasking,
+					    const belief_vector& b) const
+{
+  double val, maxVal = -99e+20;
+  int ret = -1;
+  FOR (i, oldPlanes.size()) {
+    const LBPlane* al = oldPlanes[i];
+    if (useMaxPlanesMasking) {
+      if (!mask_subset( b, al->mask )) continue;
+    }
+    val = inner_prod( al->alpha, b );
+    if (val > maxVal) {
+      maxVal = val;
+      ret = i;
+    }
+  }
+  return ret;
+}
+
+void WarmStartLBInitializer::initialize(const std::string& policyFileName,
+					double targetPrecision)
+{
+  timeval startTime = getTime();
+
+  // a scratch bound takes care of reading any of the policy formats
+  MaxPlanesLowerBound oldBound(pomdp, bound->config);
+  oldBound.readFromFile(policyFileName);
+  std::vector<LBPlane*> oldPlanes(oldBound.planes.begin(), oldBound.planes.end());
+  FOR (i, oldPlanes.size()) {
+    const LBPlane* al = oldPlanes[i];
+    if (al->action < 0 || al->action >= pomdp->numActions
+	|| (int) al->alpha.size() != pomdp->numStates) {
+      fprintf(stderr, "ERROR: warm start policy %s does not match the model (plane %d has action %d and %d entries; the model has %d actions and %d states)\n",
+	      policyFileName.c_str(), (int) i, al->action, (int) al->alpha.size(),
+	      pomdp->numActions, pomdp->numStates);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // unroll the old policy into a controller.  node k executes the action
+  // of old plane nodePlane[k]; after observation o it moves to the node
+  // whose plane is best at the next belief from its witness belief.
+  // observations that are impossible at the witness belief loop back to
+  // node k (any choice of successor gives a valid bound).
+  int numObs = pomdp->getNumObservations();
+  std::vector<int> nodeOfPlane(oldPlanes.size(), -1);
+  std::vector<int> nodePlane;
+  std::vector<belief_vector> witness;
+  std::vector< std::vector<int> > succ;
+
+  const belief_vector& b0 = pomdp->getInitialBelief();
+  int p0 = getBestOldPlane(oldPlanes, oldBound.useMaxPlanesMasking, b0);
+  if (-1 == p0) {
+    cerr << "WARNING: no plane of warm start policy " << policyFileName
+	 << " applies to the initial belief; ignoring it" << endl;
+    return;
+  }
+  nodeOfPlane[p0] = 0;
+  nodePlane.push_back(p0);
+  witness.push_back(b0);
+
+  obs_prob_vector opv;
+  std::vector<belief_vector> nextBeliefs;
+  for (unsigned int k = 0; k < nodePlane.size(); k++) {
+    int a = oldPlanes[nodePlane[k]]->action;
+    succ.push_back(std::vector<int>(numObs, k));
+    if (isTerminalBelief(pomdp, witness[k])) continue;
+
+    pomdp->getAllNextBeliefs(opv, nextBeliefs, witness[k], a);
+    FOR (o, numObs) {
+      if (opv(o) <= OBS_IS_ZERO_EPS) continue;
+      int j = getBestOldPlane(oldPlanes, oldBound.useMaxPlanesMasking,
+			      nextBeliefs[o]);
+      if (-1 == j) continue;
+      if (-1 == nodeOfPlane[j]) {
+	nodeOfPlane[j] = nodePlane.size();
+	nodePlane.push_back(j);
+	witness.push_back(nextBeliefs[o]);
+      }
+      succ[k][o] = nodeOfPlane[j];
+    }
+  }
+  int numNodes = nodePlane.size();
+
+  // evaluate the controller under the current model, updating the node
+  // values in place.  starting from the worst-case bound, every sweep
+  // can only increase the values, and they never pass the controller's
+  // true value.
+  alpha_vector weakAl;
+  initBlindWorstCase(weakAl);
+  std::vector<alpha_vector> vals(numNodes, weakAl);
+  alpha_vector betaA(pomdp->numStates);
+  alpha_vector tmp, tmp2, Rxa, diff;
+  double maxResidual;
+  int numSweeps = 0;
+  do {
+    maxResidual = 0.0;
+    FOR (k, numNodes) {
+      int a = oldPlanes[nodePlane[k]]->action;
+      set_to_zero(betaA);
+      FOR (o, numObs) {
+	emult_column( tmp, pomdp->getO(a), o, vals[succ[k][o]] );
+	mult( tmp2, pomdp->getT(a), tmp );
+	betaA += tmp2;
+      }
+      betaA *= pomdp->discount;
+      copy_from_column( Rxa, pomdp->R, a );
+      betaA += Rxa;
+
+      diff = betaA;
+      diff -= vals[k];
+      maxResidual = std::max(maxResidual, norm_inf(diff));
+      vals[k] = betaA;
+    }
+    numSweeps++;
+  } while (maxResidual > targetPrecision && numSweeps < WS_MAX_EVALUATION_SWEEPS);
+  if (maxResidual > targetPrecision) {
+    fprintf(stderr, "WARNING: warm start policy evaluation did not converge after %d sweeps "
+	    "(residual=%g); using the partially evaluated lower bound\n",
+	    numSweeps, maxResidual);
+  }
+
+  alpha_vector default_mask;
+  if (bound->useMaxPlanesMasking) {
+    mask_set_all( default_mask, pomdp->numStates );
+  }
+  FOR (k, numNodes) {
+    bound->addLBPlane(new LBPlane(vals[k], oldPlanes[nodePlane[k]]->action,
+				  default_mask));
+  }
+
+  if (zmdpDebugLevelG >= 1) {
+    cout << "WarmStartLBInitializer: added " << numNodes << " planes (of "
+	 << oldPlanes.size() << " in " << policyFileName << ") after "
+	 << numSweeps << " evaluation sweeps, "
+	 << timevalToSeconds(getTime() - startTime) << " seconds" << endl;
+  }
+}
+
+/**********************************************************************
+ * WarmStartUBInitializer
+ **********************************************************************/
+
+WarmStartUBInitializer::WarmStartUBInitializer(const MDP* _pomdp,
+					       SawtoothUpperBound* _bound) :
+  pomdp((const Pomdp*) _pomdp),
+  bound(_bound)
+{}
+
+// Bellman backup of the current bound at b
+double WarmStartUBInitializer::getBackedUpValue(const belief_vector& b) const
+{
+  obs_prob_vector opv;
+  std::vector<belief_vector> nextBeliefs;
+  double val, maxVal = -99e+20;
+  FOR (a, pomdp->numActions) {
+    pomdp->getAllNextBeliefs(opv, nextBeliefs, b, a);
+    val = 0.0;
+    FOR (o, pomdp->getNumObservations()) {
+      if (opv(o) > OBS_IS_ZERO_EPS) {
+	val += opv(o) * bound->getValue(nextBeliefs[o], NULL);
+      }
+    }
+    val = inner_prod_column( pomdp->R, a, b ) + pomdp->discount * val;
+    maxVal = std::max(maxVal, val);
+  }
+  return maxVal;
+}
+
+void WarmStartUBInitializer::initialize(const std::string& upperBoundFileName,
+					double targetPrecision)
+{
+  timeval startTime = getTime();
+
+  std::vector<BVPair*> oldPts;
+  SawtoothUpperBound::readPointsFromFile(upperBoundFileName, pomdp->numStates,
+					 oldPts);
+
+  int maxSweeps = bound->config->getInt("upperBoundWarmStartSweeps");
+  int numSweeps = 0;
+  int numAdded = 0;
+  double maxImprovement = 99e+20;
+  while (numSweeps < maxSweeps && maxImprovement > targetPrecision) {
+    maxImprovement = 0.0;
+    FOR_EACH (ptP, oldPts) {
+      const belief_vector& b = (*ptP)->b;
+      if (isTerminalBelief(pomdp, b)) continue;
+
+      double oldVal = bound->getValue(b, NULL);
+      double newVal = getBackedUpValue(b);
+      if (newVal < oldVal - PRUNE_EPS) {
+	BVPair* pt = new BVPair(b, newVal);
+	pt->numBackupsAtCreation = 0;
+	bound->addPoint(pt);
+	numAdded++;
+	maxImprovement = std::max(maxImprovement, oldVal - newVal);
+      }
+    }
+    bound->maybePrune(-1);
+    numSweeps++;
+  }
+
+  FOR_EACH (ptP, oldPts) {
+    delete *ptP;
+  }
+
+  if (zmdpDebugLevelG >= 1) {
+    cout << "WarmStartUBInitializer: " << numSweeps << " sweeps over "
+	 << oldPts.size() << " beliefs from " << upperBoundFileName
+	 << " added " << numAdded << " points, "
+	 << timevalToSeconds(getTime() - startTime) << " seconds" << endl;
+  }
+}
+
+}; // namespace zmdp
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
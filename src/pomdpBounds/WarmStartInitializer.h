@@ -0,0 +1,84 @@
+/********** tell emacs we use -*- c++ -*- style comments *******************
+ $Revision$  $Author$  $Date$
+   
+ @file    WarmStartInitializer.h
+ @brief   Warm-start initialization of the bounds from the output of an earlier run.
+
+ Copyright (c) 2007, Trey Smith. All rights reserved.
+
+ Licensed under the Apache License, Version 2.0 (the "License"); you may
+ not use this file except in compliance with the License.  You may
+ obtain a copy of the License at
+
+   http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ implied.  See the License for the specific language governing
+ permissions and limitations under the License.
+
+ ***************************************************************************/
+
+#ifndef INCWarmStartInitializer_h
+#define INCWarmStartInitializer_h
+
+#include <string>
+#include <vector>
+
+#include "MatrixUtils.h"
+#include "Pomdp.h"
+#include "MaxPlanesLowerBound.h"
+#include "SawtoothUpperBound.h"
+#include "BlindLBInitializer.h"
+
+namespace zmdp {
+
+// Adds planes derived from a policy written by an earlier run (possibly
+// for a slightly different model).  The old planes' values are not
+// trusted.  Instead, the policy is unrolled from the initial belief into
+// a finite-state controller, with one node per old plane that is best
+// at some belief the controller reaches, and the controller is evaluated
+// under the current model starting from the worst-case bound.  The
+// evaluation increases monotonically towards the controller's value, so
+// the resulting planes are valid lower bounds even though the old ones
+// are not.  Run after BlindLBInitializer.
+struct WarmStartLBInitializer : public BlindLBInitializer {
+  WarmStartLBInitializer(const MDP* _pomdp, MaxPlanesLowerBound* _bound);
+  void initialize(const std::string& policyFileName, double targetPrecision);
+
+protected:
+  int getBestOldPlane(const std::vector<LBPlane*>& oldPlanes,
+		      bool useMaxPlanesMasking,
+		      const belief_vector& b) const;
+};
+
+// Adds points at the beliefs of an upper bound file written by an
+// earlier run (see SawtoothUpperBound::writeToFile()).  Each belief's
+// value is recalculated with a Bellman backup against the current
+// bound, which is valid for the current model, so the old values are
+// never used.  The beliefs are swept in file order (roughly deepest
+// first, the order in which the earlier run updated them) until no
+// value improves by more than targetPrecision or
+// upperBoundWarmStartSweeps sweeps are done.  Run after
+// FastInfUBInitializer.
+struct WarmStartUBInitializer {
+  const Pomdp* pomdp;
+  SawtoothUpperBound* bound;
+
+  WarmStartUBInitializer(const MDP* _pomdp, SawtoothUpperBound* _bound);
+  void initialize(const std::string& upperBoundFileName, double targetPrecision);
+
+protected:
+  double getBackedUpValue(const belief_vector& b) const;
+};
+
+}; // namespace zmdp
+
+#endif /* INCWarmStartInitializer_h */
+
+/***************************************************************************
+ * REVISION HISTORY:
+ * $Log: not supported by cvs2svn $
+ *
+ ***************************************************************************/
@@ -41,6 +41,7 @@
 #include "SawtoothUpperBound.h"
 #include "FastParser.h"
 #include "CassandraParser.h"
+#include "BinaryModelParser.h"
 
 using namespace std;
 using namespace MatrixUtils;
@@ -51,13 +52,20 @@ Pomdp::Pomdp(const std::string& fileName,
 	     const ZMDPConfig* config)
 {
   bool useFastModelParser = config->getBool("useFastModelParser");
-  if (useFastModelParser) {
-    FastParser parser;
+  bool useLazyModelLoading = config->getBool("useLazyModelLoading");
+  if (BinaryModelParser::isBinaryModelFile(fileName)) {
+    BinaryModelParser parser(useLazyModelLoading);
+    parser.readPomdpFromFile(*this, fileName);
+  } else if (useFastModelParser) {
+    FastParser parser(config->getInt("fastModelParserThreads"));
     parser.readPomdpFromFile(*this, fileName);
   } else {
     CassandraParser parser;
     parser.readPomdpFromFile(*this, fileName);
   }
+  if (useLazyModelLoading) {
+    initLazyLoading(*config);
+  }
 
   maxHorizon = config->getInt("maxHorizon");
 
@@ -79,9 +87,9 @@ obs_prob_vector& Pomdp::getObsProbVector(obs_prob_vector& result,
   dvector tmp; // FIX: for efficiency, should tmp be a cvector?
   // --- overall: result = O_a' * T_a' * b
   // tmp = T_a' * b
-  mult( tmp, Ttr[a], b );
+  mult( tmp, getTtr(a), b );
   // result = O_a' * tmp
-  mult( result, tmp, O[a] );
+  mult( result, tmp, getO(a) );
   
   return result;
 }
@@ -93,8 +101,8 @@ belief_vector& Pomdp::getNextBelief(belief_vector& result,
   belief_vector tmp;
 
   // result = O_a(:,o) .* (T_a * b)
-  mult( tmp, Ttr[a], b );
-  emult_column( result, O[a], o, tmp );
+  mult( tmp, getTtr(a), b );
+  emult_column( result, getO(a), o, tmp );
 
   // renormalize
   result *= (1.0/sum(result));
@@ -102,6 +110,52 @@ belief_vector& Pomdp::getNextBelief(belief_vector& result,
   return result;
 }
 
+void Pomdp::getAllNextBeliefs(obs_prob_vector& result,
+			      std::vector<belief_vector>& nextBeliefs,
+			      const belief_vector& b,
+			      int a) const
+{
+  dvector tmp;
+  // tmp = T_a * b, shared by all observations
+  mult( tmp, getTtr(a), b );
+
+  // a single pass through the columns of O_a gives both
+  //   result(o) = O_a(:,o)' * tmp and
+  //   nextBeliefs[o] = O_a(:,o) .* tmp (before renormalizing).
+  // the results match getObsProbVector() and getNextBelief() up to
+  // rounding: the vectorized kernels those use may sum the products in
+  // a different order.
+  const cmatrix& Oa = getO(a);
+  typeof(Oa.data.begin()) Oi, col_end;
+  double x, val, obsProb, beliefSum;
+
+  result.resize( numObservations );
+  nextBeliefs.resize( numObservations );
+  FOR (o, numObservations) {
+    belief_vector& bp = nextBeliefs[o];
+    bp.resize( numStates );
+    obsProb = 0.0;
+    beliefSum = 0.0;
+    col_end = Oa.data.begin() + Oa.col_starts[o+1];
+    for (Oi = Oa.data.begin() + Oa.col_starts[o]; Oi != col_end; Oi++) {
+      x = tmp(Oi->index);
+      obsProb += x * Oi->value;
+      // matches the sparsity of the cvector T_a * b in getNextBelief()
+      if (fabs(x) > SPARSE_EPS) {
+	val = Oi->value * x;
+	bp.push_back( Oi->index, val );
+	beliefSum += val;
+      }
+    }
+    result(o) = obsProb;
+
+    // renormalize
+    if (obsProb > OBS_IS_ZERO_EPS) {
+      bp *= (1.0/beliefSum);
+    }
+  }
+}
+
 double Pomdp::getReward(const belief_vector& b, int a)
 {
   return inner_prod_column( R, a, b );
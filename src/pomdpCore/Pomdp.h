@@ -50,6 +50,15 @@ struct Pomdp : public CassandraModel {
   belief_vector& getNextBelief(belief_vector& result, const belief_vector& b,
 			       int a, int o) const;
 
+  // sets result to be the vector of observation probabilities and
+  // nextBeliefs[o] to be the next belief for each observation o with
+  // non-negligible probability.  this is equivalent to calling
+  // getObsProbVector() and then getNextBelief() for each o, but T_a * b
+  // is only calculated once.
+  void getAllNextBeliefs(obs_prob_vector& result,
+			 std::vector<belief_vector>& nextBeliefs,
+			 const belief_vector& b, int a) const;
+
   // returns the expected immediate reward when from belief b action a is selected
   double getReward(const belief_vector& b, int a);
 
@@ -71,6 +80,10 @@ struct Pomdp : public CassandraModel {
   state_vector& getNextState(state_vector& result, const state_vector& s,
 			     int a, int o)
     { return getNextBelief(result,s,a,o); }
+  void getAllOutcomes(outcome_prob_vector& opv,
+		      std::vector<state_vector>& nextStates,
+		      const state_vector& s, int a)
+    { getAllNextBeliefs(opv,nextStates,s,a); }
   
 protected:
   void readFromFileCassandra(const std::string& fileName);
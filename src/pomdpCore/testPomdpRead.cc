@@ -83,10 +83,10 @@ int main(int argc, char *argv[]) {
   cout << endl;
 
   for (a=0; a < p.getNumActions(); a++) {
-    printf("T_%d(s,sp) matrix (%d x %d) =\n", a, p.T[a].size1(), p.T[a].size2());
+    printf("T_%d(s,sp) matrix (%d x %d) =\n", a, p.getT(a).size1(), p.getT(a).size2());
     for (s=0; s < p.getBeliefSize(); s++) {
       for (sp=0; sp < p.getBeliefSize(); sp++) {
-	printf("%5.3f ", p.T[a](s,sp));
+	printf("%5.3f ", p.getT(a)(s,sp));
       }
       cout << endl;
     }
@@ -94,10 +94,10 @@ int main(int argc, char *argv[]) {
   }
 
   for (a=0; a < p.getNumActions(); a++) {
-    printf("Ttr_%d(sp,s) matrix (%d x %d) =\n", a, p.Ttr[a].size1(), p.Ttr[a].size2());
+    printf("Ttr_%d(sp,s) matrix (%d x %d) =\n", a, p.getTtr(a).size1(), p.getTtr(a).size2());
     for (sp=0; sp < p.getBeliefSize(); sp++) {
       for (s=0; s < p.getBeliefSize(); s++) {
-	printf("%5.3f ", p.Ttr[a](sp,s));
+	printf("%5.3f ", p.getTtr(a)(sp,s));
       }
       cout << endl;
     }
@@ -105,10 +105,10 @@ int main(int argc, char *argv[]) {
   }
 
   for (a=0; a < p.getNumActions(); a++) {
-    printf("O_%d(sp,o) matrix (%d x %d) =\n", a, p.O[a].size1(), p.O[a].size2());
+    printf("O_%d(sp,o) matrix (%d x %d) =\n", a, p.getO(a).size1(), p.getO(a).size2());
     for (sp=0; sp < p.getBeliefSize(); sp++) {
       for (o=0; o < p.getNumObservations(); o++) {
-	printf("%5.3f ", p.O[a](sp,o));
+	printf("%5.3f ", p.getO(a)(sp,o));
       }
       cout << endl;
     }
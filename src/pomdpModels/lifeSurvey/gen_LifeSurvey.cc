@@ -78,7 +78,8 @@ void usage(const char* argv0) {
     "  -f or --full         Use verbose identifiers in output model instead of numbers\n"
     "                        (useful only for debugging -- full identifiers are not\n"
     "                         compatible with the fast parser 'zmdp solve -f')\n"
-    "  -t or --target-list  Specify known list of targets\n";
+    "  -t or --target-list  Specify known list of targets\n"
+    "  If my.pomdp is '-', the model is written to standard output.\n";
   exit(EXIT_FAILURE);
 }
 
@@ -147,7 +148,9 @@ int main(int argc, char *argv[]) {
     m.setTargetList(targetListFileName);
   }
 
-  FILE* pomdpFile = fopen(pomdpFileName.c_str(), "w");
+  // '-' writes the model to stdout so it can be piped into 'zmdp solve -'
+  bool useStdout = (pomdpFileName == "-");
+  FILE* pomdpFile = useStdout ? stdout : fopen(pomdpFileName.c_str(), "w");
   if (NULL == pomdpFile) {
     fprintf(stderr, "ERROR: couldn't open '%s' for writing: %s\n",
 	    pomdpFileName.c_str(), strerror(errno));
@@ -155,7 +158,12 @@ int main(int argc, char *argv[]) {
   }
   m.writeToFile(pomdpFile, fullIdentifiers);
 
-  printf("done writing %s\n", pomdpFileName.c_str());
+  if (useStdout) {
+    fflush(stdout);
+  } else {
+    fclose(pomdpFile);
+    printf("done writing %s\n", pomdpFileName.c_str());
+  }
 }
 
 /***************************************************************************
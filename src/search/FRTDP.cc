@@ -53,7 +53,8 @@ FRTDP::FRTDP(void)
 
 void FRTDP::getNodeHandler(MDPNode& cn)
 {
-  FRTDPExtraNodeData* searchData = new FRTDPExtraNodeData;
+  FRTDPExtraNodeData* searchData =
+    bounds->nodeStore->newData<FRTDPExtraNodeData>();
   cn.searchData = searchData;
   double excessWidth = cn.ubVal - cn.lbVal - RT_PRIO_IMPROVEMENT_CONSTANT * targetPrecision;
   searchData->prio = (excessWidth <= 0) ? RT_PRIO_MINUS_INFINITY : log(excessWidth);
@@ -79,7 +80,8 @@ void FRTDP::getMaxPrioOutcome(MDPNode& cn, int a, FRTDPUpdateResult& r) const
   FOR (o, Qa.getNumOutcomes()) {
     MDPEdge* e = Qa.outcomes[o];
     if (NULL != e) {
-      prio = log(problem->getDiscount() * e->obsProb) + getPrio(*e->nextState);
+      prio = log(problem->getDiscount() * e->obsProb)
+	+ atomicLoadDouble(getPrio(*e->nextState));
       if (prio > r.maxPrio) {
 	r.maxPrio = prio;
 	r.maxPrioOutcome = o;
@@ -98,29 +100,37 @@ void FRTDP::getMaxPrioOutcome(MDPNode& cn, int a, FRTDPUpdateResult& r) const
   }
 }
 
-void FRTDP::update(MDPNode& cn, FRTDPUpdateResult& r)
+void FRTDP::update(MDPNode& cn, FRTDPUpdateResult& r, FRTDPTrialState& ts)
 {
+  // in parallel trial mode, another thread may be updating the same node
+  ZMDPMutexGuard g(bounds->getNodeLock(cn), numSearchThreads > 1);
+
   double oldUBVal = cn.ubVal;
   bounds->update(cn, &r.maxUBAction);
   trackBackup(cn);
+  ts.stats->numBackups++;
   
   r.ubResidual = oldUBVal - cn.ubVal;
+  r.lbVal = cn.lbVal;
+  r.ubVal = cn.ubVal;
 
   getMaxPrioOutcome(cn, r.maxUBAction, r);
 
   double excessWidth = cn.ubVal - cn.lbVal - RT_PRIO_IMPROVEMENT_CONSTANT * targetPrecision;
-  getPrio(cn) = std::min(r.maxPrio, (excessWidth <= 0)
-			 ? RT_PRIO_MINUS_INFINITY : log(excessWidth));
+  atomicStoreDouble(getPrio(cn),
+		    std::min(r.maxPrio, (excessWidth <= 0)
+			     ? RT_PRIO_MINUS_INFINITY : log(excessWidth)));
 
   //getPrio(cn) = r.maxPrio;
 }
 
-void FRTDP::trialRecurse(MDPNode& cn, double logOcc, int depth)
+void FRTDP::trialRecurse(MDPNode& cn, double logOcc, int depth,
+			 FRTDPTrialState& ts)
 {
   FRTDPUpdateResult r;
-  update(cn, r);
+  update(cn, r, ts);
 
-  double excessWidth = cn.ubVal - cn.lbVal - RT_PRIO_IMPROVEMENT_CONSTANT * targetPrecision;
+  double excessWidth = r.ubVal - r.lbVal - RT_PRIO_IMPROVEMENT_CONSTANT * targetPrecision;
   double occ = (logOcc < -50) ? 0 : exp(logOcc);
   double updateQuality = r.ubResidual * occ;
 
@@ -132,7 +142,7 @@ void FRTDP::trialRecurse(MDPNode& cn, double logOcc, int depth)
 
   if (zmdpDebugLevelG >= 1) {
     printf("  trialRecurse: depth=%d [%g .. %g] a=%d o=%d\n",
-	   depth, cn.lbVal, cn.ubVal, r.maxUBAction, r.maxPrioOutcome);
+	   depth, r.lbVal, r.ubVal, r.maxUBAction, r.maxPrioOutcome);
     printf("  trialRecurse: s=%s\n", sparseRep(cn.s).c_str());
   }
 
@@ -143,15 +153,15 @@ void FRTDP::trialRecurse(MDPNode& cn, double logOcc, int depth)
 	 r.maxPrioOutcome, r.maxPrio);
 #endif
 
-  if (depth > oldMaxDepth) {
-    newQualitySum += updateQuality;
-    newNumUpdates++;
+  if (depth > ts.oldMaxDepth) {
+    ts.newQualitySum += updateQuality;
+    ts.newNumUpdates++;
   } else {
-    oldQualitySum += updateQuality;
-    oldNumUpdates++;
+    ts.oldQualitySum += updateQuality;
+    ts.oldNumUpdates++;
   }
 
-  if (excessWidth <= 0 || depth > maxDepth) {
+  if (excessWidth <= 0 || depth > ts.maxDepth) {
     if (zmdpDebugLevelG >= 1) {
       printf("  trialRecurse: depth=%d excessWidth=%g (terminating)\n",
 	     depth, excessWidth);
@@ -167,37 +177,58 @@ void FRTDP::trialRecurse(MDPNode& cn, double logOcc, int depth)
   double weight = problem->getDiscount() * obsProb;
   double nextLogOcc = logOcc + log(weight);
   trialRecurse(cn.getNextState(r.maxUBAction, r.maxPrioOutcome),
-	       nextLogOcc, depth+1);
+	       nextLogOcc, depth+1, ts);
 
-  update(cn, r);
+  update(cn, r, ts);
 }
 
 bool FRTDP::doTrial(MDPNode& cn)
 {
-  if (zmdpDebugLevelG >= 1) {
-    printf("-*- doTrial: trial %d\n", (numTrials+1));
-  }
+  return doThreadTrial(cn, threadStats[0]);
+}
 
-  oldQualitySum = 0;
-  oldNumUpdates = 0;
-  newQualitySum = 0;
-  newNumUpdates = 0;
+bool FRTDP::doThreadTrial(MDPNode& cn, RTDPThreadStats& stats)
+{
+  bool parallel = (numSearchThreads > 1);
+  FRTDPTrialState ts;
+  ts.stats = &stats;
+  ts.oldQualitySum = 0;
+  ts.oldNumUpdates = 0;
+  ts.newQualitySum = 0;
+  ts.newNumUpdates = 0;
+  {
+    ZMDPMutexGuard g(searchLock, parallel);
+    if (zmdpDebugLevelG >= 1) {
+      printf("-*- doTrial: trial %d\n", (numTrials+1));
+    }
+    ts.oldMaxDepth = oldMaxDepth;
+    ts.maxDepth = maxDepth;
+  }
 
   trialRecurse(cn,
 	       /* logOcc = */ log(1.0),
-	       /* depth = */ 0);
+	       /* depth = */ 0,
+	       ts);
 
   double updateQualityDiff;
-  if (0 == oldQualitySum) {
+  if (0 == ts.oldQualitySum) {
     updateQualityDiff = 1000;
-  } else if (0 == newNumUpdates) {
+  } else if (0 == ts.newNumUpdates) {
     updateQualityDiff = -1000;
   } else {
-    double oldMean = oldQualitySum / oldNumUpdates;
-    double newMean = newQualitySum / newNumUpdates;
+    double oldMean = ts.oldQualitySum / ts.oldNumUpdates;
+    double newMean = ts.newQualitySum / ts.newNumUpdates;
     updateQualityDiff = newMean - oldMean;
   }
-  
+
+  bool done;
+  {
+    ZMDPMutexGuard ng(bounds->getNodeLock(cn), parallel);
+    done = (cn.ubVal - cn.lbVal < targetPrecision);
+  }
+
+  // adjust the depth limit shared by all trials
+  ZMDPMutexGuard g(searchLock, parallel);
   if (updateQualityDiff > -FRTDP_QUALITY_MARGIN) {
     oldMaxDepth = maxDepth;
     maxDepth *= FRTDP_MAX_DEPTH_ADJUST_RATIO;
@@ -214,12 +245,33 @@ bool FRTDP::doTrial(MDPNode& cn)
 
 #if 0
   printf("endTrial: oldQualitySum=%g oldNumUpdates=%d newQualitySum=%g newNumUpdates=%d\n",
-	 oldQualitySum, oldNumUpdates, newQualitySum, newNumUpdates);
+	 ts.oldQualitySum, ts.oldNumUpdates, ts.newQualitySum, ts.newNumUpdates);
 #endif
 
   numTrials++;
+  stats.numTrials++;
 
-  return (cn.ubVal - cn.lbVal < targetPrecision);
+  return done;
+}
+
+void FRTDP::writeSearchCheckpoint(SolverCheckpointWriter& out)
+{
+  out.beginSection("FRTDP");
+  out.writeDouble(oldMaxDepth);
+  out.writeDouble(maxDepth);
+  FOR (i, bounds->nodeStore->numNodes) {
+    out.writeDouble(getPrio(*bounds->nodeStore->getNode(i)));
+  }
+}
+
+void FRTDP::readSearchCheckpoint(SolverCheckpointReader& in)
+{
+  in.expectSection("FRTDP");
+  oldMaxDepth = in.readDouble();
+  maxDepth = in.readDouble();
+  FOR (i, bounds->nodeStore->numNodes) {
+    getPrio(*bounds->nodeStore->getNode(i)) = in.readDouble();
+  }
 }
 
 void FRTDP::derivedClassInit(void)
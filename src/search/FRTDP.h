@@ -32,19 +32,28 @@ struct FRTDPUpdateResult {
   double ubResidual;
   int maxPrioOutcome;
   double maxPrio;
+  double lbVal, ubVal; // bounds of the node after the update
 };
 
 struct FRTDPExtraNodeData {
   double prio;
 };
 
-struct FRTDP : public RTDPCore {
+// state of a single trial.  kept separate from the FRTDP object so
+// that several trials can run at once in parallel trial mode.
+struct FRTDPTrialState {
+  RTDPThreadStats* stats;
   double oldMaxDepth;
   double maxDepth;
   double oldQualitySum;
   int oldNumUpdates;
   double newQualitySum;
   int newNumUpdates;
+};
+
+struct FRTDP : public RTDPCore {
+  double oldMaxDepth;
+  double maxDepth;
 
   FRTDP(void);
 
@@ -52,10 +61,14 @@ struct FRTDP : public RTDPCore {
   static void staticGetNodeHandler(MDPNode& cn, void* handlerData);
   static double& getPrio(const MDPNode& cn);
   void getMaxPrioOutcome(MDPNode& cn, int a, FRTDPUpdateResult& result) const;
-  void update(MDPNode& cn, FRTDPUpdateResult& result);
-  void trialRecurse(MDPNode& cn, double logOcc, int depth);
+  void update(MDPNode& cn, FRTDPUpdateResult& result, FRTDPTrialState& ts);
+  void trialRecurse(MDPNode& cn, double logOcc, int depth, FRTDPTrialState& ts);
   bool doTrial(MDPNode& cn);
+  bool supportsParallelTrials(void) const { return true; }
+  bool doThreadTrial(MDPNode& cn, RTDPThreadStats& stats);
   void derivedClassInit(void);
+  void writeSearchCheckpoint(SolverCheckpointWriter& out);
+  void readSearchCheckpoint(SolverCheckpointReader& in);
 };
 
 }; // namespace zmdp
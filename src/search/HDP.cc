@@ -63,7 +63,8 @@ HDP::HDP(void)
 
 void HDP::getNodeHandler(MDPNode& cn)
 {
-  HDPExtraNodeData* searchData = new HDPExtraNodeData;
+  HDPExtraNodeData* searchData =
+    bounds->nodeStore->newData<HDPExtraNodeData>();
   cn.searchData = searchData;
   searchData->isSolved = cn.isTerminal;
   searchData->idx = RT_IDX_PLUS_INFINITY;
@@ -219,6 +220,28 @@ bool HDP::doTrial(MDPNode& cn)
   return false;
 }
 
+void HDP::writeSearchCheckpoint(SolverCheckpointWriter& out)
+{
+  out.beginSection("HDP");
+  FOR (i, bounds->nodeStore->numNodes) {
+    const MDPNode& cn = *bounds->nodeStore->getNode(i);
+    out.writeInt(getIsSolved(cn));
+    out.writeInt(getLow(cn));
+    out.writeInt(getIdx(cn));
+  }
+}
+
+void HDP::readSearchCheckpoint(SolverCheckpointReader& in)
+{
+  in.expectSection("HDP");
+  FOR (i, bounds->nodeStore->numNodes) {
+    const MDPNode& cn = *bounds->nodeStore->getNode(i);
+    getIsSolved(cn) = in.readInt();
+    getLow(cn) = in.readInt();
+    getIdx(cn) = in.readInt();
+  }
+}
+
 void HDP::derivedClassInit(void)
 {
   bounds->addGetNodeHandler(&HDP::staticGetNodeHandler, this);
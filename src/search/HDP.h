@@ -53,6 +53,8 @@ struct HDP : public RTDPCore {
   bool trialRecurse(MDPNode& cn, int depth);
   bool doTrial(MDPNode& cn);
   void derivedClassInit(void);
+  void writeSearchCheckpoint(SolverCheckpointWriter& out);
+  void readSearchCheckpoint(SolverCheckpointReader& in);
 };
 
 }; // namespace zmdp
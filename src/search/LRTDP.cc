@@ -61,7 +61,8 @@ LRTDP::LRTDP(void)
 
 void LRTDP::getNodeHandler(MDPNode& cn)
 {
-  LRTDPExtraNodeData* searchData = new LRTDPExtraNodeData;
+  LRTDPExtraNodeData* searchData =
+    bounds->nodeStore->newData<LRTDPExtraNodeData>();
   cn.searchData = searchData;
   searchData->isSolved = cn.isTerminal;
 }
@@ -204,6 +205,22 @@ bool LRTDP::doTrial(MDPNode& cn)
   return getIsSolved(cn);
 }
 
+void LRTDP::writeSearchCheckpoint(SolverCheckpointWriter& out)
+{
+  out.beginSection("LRTDP");
+  FOR (i, bounds->nodeStore->numNodes) {
+    out.writeInt(getIsSolved(*bounds->nodeStore->getNode(i)));
+  }
+}
+
+void LRTDP::readSearchCheckpoint(SolverCheckpointReader& in)
+{
+  in.expectSection("LRTDP");
+  FOR (i, bounds->nodeStore->numNodes) {
+    getIsSolved(*bounds->nodeStore->getNode(i)) = in.readInt();
+  }
+}
+
 void LRTDP::derivedClassInit(void)
 {
   bounds->addGetNodeHandler(&LRTDP::staticGetNodeHandler, this);
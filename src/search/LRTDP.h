@@ -45,6 +45,8 @@ struct LRTDP : public RTDPCore {
   bool trialRecurse(MDPNode& cn, int depth);
   bool doTrial(MDPNode& cn);
   void derivedClassInit(void);
+  void writeSearchCheckpoint(SolverCheckpointWriter& out);
+  void readSearchCheckpoint(SolverCheckpointReader& in);
 };
 
 }; // namespace zmdp
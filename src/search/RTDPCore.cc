@@ -47,9 +47,21 @@ namespace zmdp {
 
 RTDPCore::RTDPCore(void) :
   boundsFile(NULL),
-  initialized(false)
+  initialized(false),
+  numSearchThreads(1),
+  roundNumber(0),
+  numWorkersRunning(0),
+  roundReachedPrecision(false),
+  shutdownWorkers(false),
+  roundRoot(NULL),
+  parallelSeconds(0)
 {}
 
+RTDPCore::~RTDPCore(void)
+{
+  stopWorkers();
+}
+
 void RTDPCore::setBounds(BoundPairCore* _bounds)
 {
   bounds = _bounds;
@@ -57,13 +69,21 @@ void RTDPCore::setBounds(BoundPairCore* _bounds)
 
 void RTDPCore::init(void)
 {
-  bounds->initialize(problem, config);
-
   previousElapsedTime = secondsToTimeval(0.0);
   lastPrintTime = 0;
 
   numTrials = 0;
 
+  if ("none" == resumeFrom) {
+    bounds->initialize(problem, config);
+    derivedClassInit();
+  } else {
+    // the get node handlers installed by derivedClassInit() must be in
+    // place before the search graph is restored
+    derivedClassInit();
+    readCheckpoint(resumeFrom);
+  }
+
   if (NULL != boundsFile) {
     (*boundsFile) << "# wallclock time"
 		  << ", lower bound"
@@ -72,11 +92,27 @@ void RTDPCore::init(void)
 		  << ", # states expanded"
 		  << ", # trials"
 		  << ", # backups"
+		  << ", # lb prune passes"
+		  << ", lb prune seconds"
+		  << ", # lb planes pruned"
 		  << endl;
     boundsFile->flush();
   }
 
-  derivedClassInit();
+  threadStats.clear();
+  threadStats.resize(numSearchThreads);
+  if (numSearchThreads > 1) {
+    if (!supportsParallelTrials()) {
+      fprintf(stderr, "ERROR: numSearchThreads > 1 is not supported by the selected search strategy (use searchStrategy=frtdp)\n");
+      exit(EXIT_FAILURE);
+    }
+    if (!zmdpUseFingerprintStateKeysG) {
+      fprintf(stderr, "ERROR: numSearchThreads > 1 requires useFingerprintStateKeys=1\n");
+      exit(EXIT_FAILURE);
+    }
+    bounds->enableConcurrentUpdates();
+    startWorkers();
+  }
 
   initialized = true;
 }
@@ -92,6 +128,7 @@ void RTDPCore::planInit(MDP* _problem,
   if (terminateNumBackups < 0) {
     terminateNumBackups = INT_MAX;
   }
+  numSearchThreads = std::max(1, config->getInt("numSearchThreads"));
   bool useTimeWithoutHeuristic = config->getBool("useTimeWithoutHeuristic");
 
   // backup logging setup
@@ -100,6 +137,7 @@ void RTDPCore::planInit(MDP* _problem,
   backupsOutputFile = config->getString("backupsOutputFile");
   boundValuesOutputFile = config->getString("boundValuesOutputFile");
   qValuesOutputFile = config->getString("qValuesOutputFile");
+  resumeFrom = config->getString("resumeFrom");
 
   if (useTimeWithoutHeuristic) {
     init();
@@ -115,11 +153,18 @@ bool RTDPCore::planFixedTime(const state_vector& s,
   if (!initialized) {
     boundsStartTime = getTime();
     init();
+    // a resumed run picks up the clock where the checkpointed run left it
+    boundsStartTime = boundsStartTime - previousElapsedTime;
   }
 
   // disable this termination check for now
   //if (root->ubVal - root->lbVal < targetPrecision) return true;
-  bool done = doTrial(*bounds->getRootNode());
+  bool done;
+  if (numSearchThreads > 1) {
+    done = doParallelTrials(*bounds->getRootNode());
+  } else {
+    done = doTrial(*bounds->getRootNode());
+  }
   done = done || (bounds->numBackups >= terminateNumBackups);
 
   previousElapsedTime = getTime() - boundsStartTime;
@@ -127,6 +172,8 @@ bool RTDPCore::planFixedTime(const state_vector& s,
   if (NULL != boundsFile) {
     double elapsed = timevalToSeconds(getTime() - boundsStartTime);
     if (done || (0 == lastPrintTime) || elapsed / lastPrintTime >= (1+1e-4)) {
+      BoundPruneStats pruneStats;
+      bounds->getLowerBoundPruneStats(pruneStats);
       (*boundsFile) << timevalToSeconds(getTime() - boundsStartTime)
 		    << " " << bounds->getRootNode()->lbVal
 		    << " " << bounds->getRootNode()->ubVal
@@ -134,6 +181,9 @@ bool RTDPCore::planFixedTime(const state_vector& s,
 		    << " " << bounds->numStatesExpanded
 		    << " " << numTrials
 		    << " " << bounds->numBackups
+		    << " " << pruneStats.numPasses
+		    << " " << pruneStats.pruneSeconds
+		    << " " << pruneStats.numPruned
 		    << endl;
       boundsFile->flush();
       lastPrintTime = elapsed;
@@ -164,6 +214,7 @@ ValueInterval RTDPCore::getValueAt(const state_vector& s) const
 void RTDPCore::trackBackup(const MDPNode& backedUpNode)
 {
   if (useLogBackups) {
+    ZMDPMutexGuard g(searchLock, numSearchThreads > 1);
     backedUpNodes.push_back(&backedUpNode);
   }
 }
@@ -199,6 +250,167 @@ void RTDPCore::maybeLogBackups(void)
 void RTDPCore::finishLogging(void)
 {
   maybeLogBackups();
+  bounds->printBoundStats(cout);
+  if (numSearchThreads > 1) {
+    printThreadStats(cout);
+  }
+}
+
+// the checkpoint is only written between calls to planFixedTime(), when
+// no trials are running
+bool RTDPCore::writeCheckpoint(const std::string& fileName)
+{
+  if (!initialized) return false;
+
+  SolverCheckpointWriter out(fileName);
+  out.beginSection("RTDPCORE");
+  out.writeInt(problem->getNumStateDimensions());
+  out.writeInt(problem->getNumActions());
+  out.writeInt(numTrials);
+  out.writeDouble(timevalToSeconds(previousElapsedTime));
+  bounds->writeCheckpoint(out);
+  writeSearchCheckpoint(out);
+  out.close();
+
+  return true;
+}
+
+void RTDPCore::readCheckpoint(const std::string& fileName)
+{
+  SolverCheckpointReader in(fileName);
+  in.expectSection("RTDPCORE");
+  long long numStateDimensions = in.readInt();
+  long long numActions = in.readInt();
+  if (numStateDimensions != problem->getNumStateDimensions()
+      || numActions != problem->getNumActions()) {
+    in.fail("checkpoint was written for a different model");
+  }
+  numTrials = in.readInt();
+  previousElapsedTime = secondsToTimeval(in.readDouble());
+  bounds->readCheckpoint(problem, config, in);
+  readSearchCheckpoint(in);
+  in.close();
+}
+
+// the worker threads are started once and then wait between calls to
+// planFixedTime(), so that the cost of thread creation is not paid on
+// every trial
+void RTDPCore::startWorkers(void)
+{
+  shutdownWorkers = false;
+  workers.resize(numSearchThreads);
+  workerArgs.resize(numSearchThreads);
+  FOR (i, numSearchThreads) {
+    workerArgs[i].core = this;
+    workerArgs[i].threadIndex = i;
+    if (0 != pthread_create(&workers[i], NULL, &RTDPCore::workerMain,
+			    &workerArgs[i])) {
+      fprintf(stderr, "ERROR: couldn't create search thread %d\n", (int) i);
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+void RTDPCore::stopWorkers(void)
+{
+  if (workers.empty()) return;
+
+  poolLock.lock();
+  shutdownWorkers = true;
+  roundStartCondition.broadcast();
+  poolLock.unlock();
+
+  FOR_EACH (threadP, workers) {
+    pthread_join(*threadP, NULL);
+  }
+  workers.clear();
+}
+
+void* RTDPCore::workerMain(void* args)
+{
+  RTDPWorkerArgs* wargs = (RTDPWorkerArgs*) args;
+  wargs->core->workerLoop(wargs->threadIndex);
+  return NULL;
+}
+
+void RTDPCore::workerLoop(int threadIndex)
+{
+  int lastRoundNumber = 0;
+  RTDPThreadStats& stats = threadStats[threadIndex];
+  while (1) {
+    poolLock.lock();
+    while (roundNumber == lastRoundNumber && !shutdownWorkers) {
+      roundStartCondition.wait(poolLock);
+    }
+    if (shutdownWorkers) {
+      poolLock.unlock();
+      return;
+    }
+    lastRoundNumber = roundNumber;
+    MDPNode* root = roundRoot;
+    poolLock.unlock();
+
+    timeval trialStartTime = getTime();
+    bool done = doThreadTrial(*root, stats);
+    stats.trialSeconds += timevalToSeconds(getTime() - trialStartTime);
+
+    poolLock.lock();
+    if (done) roundReachedPrecision = true;
+    numWorkersRunning--;
+    if (0 == numWorkersRunning) {
+      roundDoneCondition.broadcast();
+    }
+    poolLock.unlock();
+  }
+}
+
+// runs one trial in each worker thread and waits for all of them to
+// finish.  returns true if any of the trials reached the target
+// precision at the root.
+bool RTDPCore::doParallelTrials(MDPNode& cn)
+{
+  timeval roundStartTime = getTime();
+
+  poolLock.lock();
+  roundRoot = &cn;
+  roundReachedPrecision = false;
+  numWorkersRunning = numSearchThreads;
+  roundNumber++;
+  roundStartCondition.broadcast();
+  while (numWorkersRunning > 0) {
+    roundDoneCondition.wait(poolLock);
+  }
+  bool done = roundReachedPrecision;
+  poolLock.unlock();
+
+  parallelSeconds += timevalToSeconds(getTime() - roundStartTime);
+  return done;
+}
+
+void RTDPCore::printThreadStats(std::ostream& out) const
+{
+  char buf[256];
+  int totalTrials = 0;
+  int totalBackups = 0;
+  FOR_EACH (statsP, threadStats) {
+    totalTrials += statsP->numTrials;
+    totalBackups += statsP->numBackups;
+  }
+  double secs = std::max(parallelSeconds, 1e-6);
+  snprintf(buf, sizeof(buf),
+	   "parallel search: %d threads, %d trials (%.1f/s), %d backups (%.1f/s) in %.2f s\n",
+	   numSearchThreads, totalTrials, totalTrials / secs,
+	   totalBackups, totalBackups / secs, parallelSeconds);
+  out << buf;
+  FOR (i, threadStats.size()) {
+    const RTDPThreadStats& st = threadStats[i];
+    snprintf(buf, sizeof(buf),
+	     "  thread %2d: %d trials (%.1f/s), %d backups (%.1f/s), %.1f%% busy\n",
+	     (int) i, st.numTrials, st.numTrials / secs,
+	     st.numBackups, st.numBackups / secs,
+	     100.0 * st.trialSeconds / secs);
+    out << buf;
+  }
 }
 
 }; // namespace zmdp
@@ -29,6 +29,7 @@
 #include "MatrixUtils.h"
 #include "Solver.h"
 #include "BoundPairCore.h"
+#include "zmdpThreads.h"
 
 #define RT_CLEAR_STD_STACK(x) while (!(x).empty()) (x).pop();
 #define RT_IDX_PLUS_INFINITY (INT_MAX)
@@ -72,6 +73,22 @@ struct NodeStack {
   }
 };
 
+// per-thread statistics for parallel trial mode
+struct RTDPThreadStats {
+  int numTrials;
+  int numBackups;
+  double trialSeconds;
+
+  RTDPThreadStats(void) : numTrials(0), numBackups(0), trialSeconds(0) {}
+};
+
+struct RTDPCore;
+
+struct RTDPWorkerArgs {
+  RTDPCore* core;
+  int threadIndex;
+};
+
 struct RTDPCore : public Solver {
   MDP* problem;
   BoundPairCore* bounds;
@@ -92,7 +109,31 @@ struct RTDPCore : public Solver {
   std::string qValuesOutputFile;
   std::vector<const MDPNode*> backedUpNodes;
 
+  // parallel trial mode: if numSearchThreads > 1, each call to
+  // planFixedTime() runs one trial in each of numSearchThreads worker
+  // threads.  searchLock guards numTrials, backedUpNodes, and any trial
+  // control state in derived classes.
+  int numSearchThreads;
+  std::vector<RTDPThreadStats> threadStats;
+  ZMDPMutex searchLock;
+  std::vector<pthread_t> workers;
+  std::vector<RTDPWorkerArgs> workerArgs;
+  ZMDPMutex poolLock;
+  ZMDPCondition roundStartCondition;
+  ZMDPCondition roundDoneCondition;
+  int roundNumber;
+  int numWorkersRunning;
+  bool roundReachedPrecision;
+  bool shutdownWorkers;
+  MDPNode* roundRoot;
+  double parallelSeconds;
+
+  // if not "none", init() restores the solver state from this
+  // checkpoint instead of initializing the bounds
+  std::string resumeFrom;
+
   RTDPCore(void);
+  ~RTDPCore(void);
 
   void setBounds(BoundPairCore* _bounds);
   void init(void);
@@ -102,6 +143,29 @@ struct RTDPCore : public Solver {
   virtual bool doTrial(MDPNode& cn) = 0;
   virtual void derivedClassInit(void) {}
 
+  // derived classes with trial control state or per-node search data
+  // save and restore it with these.  readSearchCheckpoint() runs after
+  // the search graph has been restored.
+  virtual void writeSearchCheckpoint(SolverCheckpointWriter& out) {}
+  virtual void readSearchCheckpoint(SolverCheckpointReader& in) {}
+  void readCheckpoint(const std::string& fileName);
+
+  // derived classes that can run several trials concurrently override
+  // these.  doThreadTrial() must be safe to call from several threads
+  // at once (see BoundPairCore::useConcurrentUpdates).
+  virtual bool supportsParallelTrials(void) const { return false; }
+  virtual bool doThreadTrial(MDPNode& cn, RTDPThreadStats& stats) {
+    assert(0);
+    return false;
+  }
+
+  void startWorkers(void);
+  void stopWorkers(void);
+  static void* workerMain(void* args);
+  void workerLoop(int threadIndex);
+  bool doParallelTrials(MDPNode& cn);
+  void printThreadStats(std::ostream& out) const;
+
   // virtual functions from Solver that constitute the external api
   void planInit(MDP* problem, const ZMDPConfig* _config);
   bool planFixedTime(const state_vector& s,
@@ -113,6 +177,7 @@ struct RTDPCore : public Solver {
   void trackBackup(const MDPNode& backedUpNode);
   void maybeLogBackups(void);
   void finishLogging(void);
+  bool writeCheckpoint(const std::string& fileName);
 };
 
 }; // namespace zmdp
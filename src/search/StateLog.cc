@@ -64,7 +64,8 @@ StateIndex::~StateIndex(void)
 
 int StateIndex::getStateId(const state_vector& s)
 {
-  string hs = hashable(s);
+  StateKey hs;
+  getStateKey(hs, s);
   typeof(lookup.begin()) pr = lookup.find(hs);
   if (lookup.end() == pr) {
     state_vector* sCopyP = new state_vector;
@@ -30,6 +30,7 @@
 #include "zmdpCommonDefs.h"
 #include "zmdpCommonTypes.h"
 #include "BoundPairCore.h"
+#include "StateKey.h"
 
 using namespace sla;
 
@@ -38,7 +39,7 @@ namespace zmdp {
 struct StateIndex {
   int numStateDimensions;
   std::vector<state_vector*> entries;
-  EXT_NAMESPACE::hash_map<std::string, int> lookup;
+  EXT_NAMESPACE::hash_map<StateKey, int, StateKeyHash> lookup;
 
   StateIndex(int _numStateDimensions);
   ~StateIndex(void);